@@ -88,6 +88,12 @@ typedef struct OMEvaluatorValue OMEvaluatorValue;
 /// Construct an Evaluator with an IR module.
 MLIR_CAPI_EXPORTED OMEvaluator omEvaluatorNew(MlirModule mod);
 
+/// Construct an Evaluator with an IR module. If `parallel` is set, objects
+/// which do not depend on each other are evaluated concurrently on the thread
+/// pool of the module's context.
+MLIR_CAPI_EXPORTED OMEvaluator omEvaluatorNewWithParallelism(MlirModule mod,
+                                                            bool parallel);
+
 /// Use the Evaluator to Instantiate an Object from its class name and actual
 /// parameters.
 MLIR_CAPI_EXPORTED OMEvaluatorValue
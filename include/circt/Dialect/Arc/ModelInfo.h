@@ -16,6 +16,7 @@
 #include "mlir/IR/BuiltinOps.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/raw_ostream.h"
+#include <optional>
 #include <string>
 
 namespace circt {
@@ -29,6 +30,7 @@ struct StateInfo {
   unsigned numBits;
   unsigned memoryStride = 0; // byte separation between memory words
   unsigned memoryDepth = 0;  // number of words in a memory
+  std::optional<unsigned> dirtyOffset; // flag set whenever the state is written
 };
 
 /// Gathers information about a given Arc model.
@@ -36,11 +38,12 @@ struct ModelInfo {
   std::string name;
   size_t numStateBytes;
   llvm::SmallVector<StateInfo> states;
+  unsigned numLanes; // instances simulated side by side; offsets are lane 0's
 
   ModelInfo(std::string name, size_t numStateBytes,
-            llvm::SmallVector<StateInfo> states)
+            llvm::SmallVector<StateInfo> states, unsigned numLanes = 1)
       : name(std::move(name)), numStateBytes(numStateBytes),
-        states(std::move(states)) {}
+        states(std::move(states)), numLanes(numLanes) {}
 };
 
 /// Collects information about states within the provided Arc model storage
@@ -34,6 +34,16 @@ bool importAnnotationsFromJSONRaw(llvm::json::Value &value,
                                   SmallVectorImpl<Attribute> &annotations,
                                   llvm::json::Path path, MLIRContext *context);
 
+/// Deserialize a JSON array of objects into FIRRTL Annotations without building
+/// the JSON value of the whole array: each element is parsed and converted on
+/// its own.  Returns false, leaving `annotations` unchanged and without
+/// reporting anything, if `annotationsStr` is not a well-formed array of
+/// objects.  Callers should fall back to `importAnnotationsFromJSONRaw` to
+/// diagnose the problem in that case.
+bool importAnnotationsFromJSONStream(StringRef annotationsStr,
+                                     SmallVectorImpl<Attribute> &annotations,
+                                     MLIRContext *context);
+
 } // namespace firrtl
 } // namespace circt
 
@@ -20,10 +20,22 @@
 
 namespace circt {
 namespace handshake {
+
+/// The engines available to execute a top-level function.
+enum class SimulationEngine {
+  /// Interpret each operation on dynamically typed values.
+  Interpreter,
+  /// Pre-compile handshake functions into a slot-indexed value table and an
+  /// op dispatch table. Functions using ops or types which cannot be compiled
+  /// are rejected with an error.
+  Compiled,
+};
+
 bool simulate(llvm::StringRef toplevelFunction,
               llvm::ArrayRef<std::string> inputArgs,
               mlir::OwningOpRef<mlir::ModuleOp> &module,
-              mlir::MLIRContext &context);
+              mlir::MLIRContext &context,
+              SimulationEngine engine = SimulationEngine::Interpreter);
 } // namespace handshake
 } // namespace circt
 
@@ -52,6 +52,10 @@ public:
   /// Build the instance layout of the design.
   void buildLayout(ModuleOp module);
 
+  /// Evaluate the instances woken up in the same delta cycle in parallel,
+  /// using the thread pool of the module's context.
+  void setParallel(bool enable) { parallel = enable; }
+
   /// Get the MLIR module.
   const ModuleOp getModule() const { return module; }
 
@@ -73,6 +77,7 @@ private:
   std::unique_ptr<mlir::ExecutionEngine> engine;
   ModuleOp module;
   TraceMode traceMode;
+  bool parallel = false;
 };
 
 } // namespace sim
@@ -122,7 +122,16 @@ public:
     return instanceIndices;
   }
 
-  void pushInstanceIndex(unsigned i) { instanceIndices.push_back(i); }
+  /// Return the position of the signal in the sensitivity list of each
+  /// instance it triggers, in the same order as the instance indices.
+  const std::vector<unsigned> &getTriggeredSenseIndices() const {
+    return senseIndices;
+  }
+
+  void pushInstanceIndex(unsigned i, unsigned senseIndex) {
+    instanceIndices.push_back(i);
+    senseIndices.push_back(senseIndex);
+  }
 
   bool hasElement() const { return elements.size() > 0; }
 
@@ -196,11 +205,23 @@ private:
   std::string owner;
   // The list of instances this signal triggers.
   std::vector<unsigned> instanceIndices;
+  // The position of the signal in the sensitivity list of each instance.
+  std::vector<unsigned> senseIndices;
   uint64_t size;
   uint8_t *value;
   std::vector<std::pair<unsigned, unsigned>> elements;
 };
 
+/// A drive of a bit range of a signal, scheduled in a queue slot.
+struct Drive {
+  /// The bit offset into the signal.
+  unsigned offset;
+  /// The number of bits driven.
+  unsigned width;
+  /// The index of the first word holding the driven value in the slot's data.
+  unsigned data;
+};
+
 /// The simulator's internal representation of one queue slot.
 struct Slot {
   /// Create a new empty slot.
@@ -218,26 +239,43 @@ struct Slot {
   /// Insert a scheduled process wakeup.
   void insertChange(unsigned inst);
 
-  // A map from signal indexes to change buffers. Makes it easy to sort the
-  // changes such that we can process one signal at a time.
+  /// Sort the changes such that all changes to the same signal are in
+  /// succession. Does nothing if no change was added since the last sort.
+  void sortChanges();
+
+  /// Reset the internal structures such that the slot can be reused.
+  void reset();
+
+  /// Return the words holding the value of a drive, least significant first.
+  /// Bits beyond the drive's width are zero.
+  const uint64_t *getDriveData(const Drive &drive) const {
+    return &driveData[drive.data];
+  }
+
+  // A map from signal indexes to drives. Makes it easy to sort the changes
+  // such that we can process one signal at a time.
   llvm::SmallVector<std::pair<unsigned, unsigned>, 32> changes;
-  // Buffers for the signal changes.
-  llvm::SmallVector<std::pair<unsigned, llvm::APInt>, 32> buffers;
-  // The number of used change buffers in the slot.
+  // The drives of the signal changes.
+  llvm::SmallVector<Drive, 32> buffers;
+  // The driven values, stored as 64 bit words such that scheduling a drive
+  // does not allocate once the slot has been used before.
+  llvm::SmallVector<uint64_t, 32> driveData;
+  // The number of used drives in the slot.
   size_t changesSize = 0;
+  // Whether the changes are known to be sorted.
+  bool sorted = true;
 
   // Processes with scheduled wakeup.
   llvm::SmallVector<unsigned, 4> scheduled;
   Time time;
-  bool unused = false;
 };
 
-/// This is equivalent to and std::priorityQueue<Slot> ordered using the greater
-/// operator, which adds an insertion method to add changes to a slot.
-class UpdateQueue : public llvm::SmallVector<Slot, 8> {
-  unsigned topSlot = 0;
-  llvm::SmallVector<unsigned, 4> unused;
-
+/// The simulator's event queue. Slots are kept in a pool and reused once they
+/// have been popped, such that their change buffers do not have to be
+/// reallocated. The pending slots are indexed by their time in an ordered map,
+/// which provides logarithmic insertion, lookup, and removal, and gives
+/// constant time access to the earliest slot.
+class UpdateQueue {
 public:
   /// Check wheter a slot for the given time already exists. If that's the case,
   /// add the new change to it, else create a new slot and push it to the queue.
@@ -262,7 +300,52 @@ public:
   /// unused and resets its internal structures such that they can be reused.
   void pop();
 
-  unsigned events = 0;
+  /// Return true if there are no pending events.
+  bool empty() const { return pending.empty(); }
+
+  /// Return the number of pending events.
+  size_t size() const { return pending.size(); }
+
+private:
+  /// All slots, including the unused ones that are kept around for reuse.
+  llvm::SmallVector<Slot, 8> slots;
+  /// The indices of the unused slots.
+  llvm::SmallVector<unsigned, 4> unused;
+  /// The indices of the pending slots, ordered by their time.
+  std::map<Time, unsigned> pending;
+  /// The index of the most recently accessed pending slot, or an out of bounds
+  /// index if there is none. Drives tend to target the same time in bursts,
+  /// which allows us to skip the map lookup.
+  unsigned lastSlot = ~0U;
+};
+
+/// Events scheduled by one instance while the instances woken up in a delta
+/// cycle are evaluated in parallel. They are applied to the queue in instance
+/// order once all instances have run, such that the queue ends up the same as
+/// after a serial evaluation.
+class DeferredEvents {
+public:
+  /// Record a drive to be inserted into the queue later.
+  void insertOrUpdate(Time time, int index, int bitOffset, uint8_t *bytes,
+                      unsigned width);
+
+  /// Record a scheduled process wakeup to be inserted into the queue later.
+  void insertOrUpdate(Time time, unsigned inst);
+
+  /// Insert the recorded events into the queue and clear them.
+  void applyTo(UpdateQueue &queue);
+
+private:
+  struct DeferredDrive {
+    Time time;
+    int index;
+    int bitOffset;
+    unsigned width;
+    size_t data;
+  };
+  llvm::SmallVector<DeferredDrive, 4> drives;
+  llvm::SmallVector<uint8_t, 32> driveData;
+  llvm::SmallVector<std::pair<Time, unsigned>, 1> wakeups;
 };
 
 /// State structure for process persistence across suspension.
@@ -314,8 +397,9 @@ struct State {
   /// Pop the head of the queue and update the simulation time.
   Slot popQueue();
 
-  /// Push a new scheduled wakeup event in the event queue.
-  void pushQueue(Time time, unsigned inst);
+  /// Push a new scheduled wakeup event in the event queue, or record it in
+  /// `deferred` if given.
+  void pushQueue(Time time, unsigned inst, DeferredEvents *deferred = nullptr);
 
   /// Find an instance in the instances list by name and return an
   /// iterator for it.
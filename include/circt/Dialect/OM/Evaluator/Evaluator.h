@@ -23,7 +23,9 @@
 #include "mlir/Support/LogicalResult.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Allocator.h"
 
+#include <memory>
 #include <queue>
 #include <utility>
 
@@ -41,6 +43,38 @@ using EvaluatorValuePtr = std::shared_ptr<EvaluatorValue>;
 /// refinement is expected.
 using ObjectFields = SmallDenseMap<StringAttr, EvaluatorValuePtr>;
 
+/// The storage backing the values created by an Evaluator.
+using ValueArena = llvm::BumpPtrAllocator;
+
+/// An allocator which hands out memory from a ValueArena, for use with
+/// `std::allocate_shared`. Deallocation is a no-op: memory is released with the
+/// arena, which is owned by the Evaluator. Values must not outlive it.
+template <typename T>
+struct ArenaAllocator {
+  using value_type = T;
+
+  explicit ArenaAllocator(ValueArena &arena) : arena(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        arena.Allocate(n * sizeof(T), llvm::Align(alignof(T))));
+  }
+  void deallocate(T *, size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return &arena == &other.arena;
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const {
+    return &arena != &other.arena;
+  }
+
+  ValueArena &arena;
+};
+
 /// Base class for evaluator runtime values.
 /// Enables the shared_from_this functionality so Evaluator Value pointers can
 /// be passed through the CAPI and unwrapped back into C++ smart pointers with
@@ -418,8 +452,10 @@ getEvaluatorValuesFromAttributes(MLIRContext *context,
 /// An Evaluator, which is constructed with an IR module and can instantiate
 /// Objects. Further refinement is expected.
 struct Evaluator {
-  /// Construct an Evaluator with an IR module.
-  Evaluator(ModuleOp mod);
+  /// Construct an Evaluator with an IR module. If `parallel` is set, objects
+  /// which do not depend on each other are evaluated concurrently on the thread
+  /// pool of the module's context.
+  Evaluator(ModuleOp mod, bool parallel = false);
 
   /// Instantiate an Object with its class name and actual parameters.
   FailureOr<evaluator::EvaluatorValuePtr>
@@ -436,7 +472,36 @@ struct Evaluator {
 
   using ObjectKey = std::pair<Value, ActualParameters>;
 
+  /// An instantiation of a class, identified by the class name and the
+  /// identity of its actual parameters.
+  using InstanceKey =
+      std::pair<StringAttr, ArrayRef<evaluator::EvaluatorValue *>>;
+
+  /// The result of evaluating an instantiation of a class, which identical
+  /// instantiations copy.
+  struct Instance {
+    /// The evaluated object.
+    std::shared_ptr<evaluator::ObjectValue> object;
+    /// The actual parameters the object was evaluated with. These are replaced
+    /// with the parameters of the instantiation which copies the object.
+    SmallVector<evaluator::EvaluatorValuePtr> parameters;
+    /// The locations evaluation left on the parameters it used, by index.
+    SmallVector<std::pair<unsigned, Location>> parameterLocations;
+  };
+
 private:
+  /// Construct an Evaluator which shares the symbol table of another one and
+  /// allocates its values from an arena owned by that one.
+  Evaluator(std::shared_ptr<SymbolTable> symbolTable,
+            evaluator::ValueArena &arena);
+
+  /// Create a value in the arena of this Evaluator.
+  template <typename T, typename... Args>
+  std::shared_ptr<T> makeValue(Args &&...args) {
+    return std::allocate_shared<T>(evaluator::ArenaAllocator<T>(arena),
+                                   std::forward<Args>(args)...);
+  }
+
   bool isFullyEvaluated(Value value, ActualParameters key) {
     return isFullyEvaluated({value, key});
   }
@@ -475,6 +540,18 @@ private:
                          Location loc, ObjectKey instanceKey = {});
   FailureOr<EvaluatorValuePtr>
   evaluateObjectInstance(ObjectOp op, ActualParameters actualParams);
+
+  /// Return the locations which evaluating an instantiation of a class left on
+  /// the actual parameters it used, by index.
+  SmallVector<std::pair<unsigned, Location>>
+  getParameterLocations(StringAttr className, ActualParameters actualParams);
+
+  /// Copy `value` and the values reachable from it into this Evaluator. Values
+  /// in `copies` are replaced with their entry there instead, and all copies
+  /// are added to it. Return null if a value is not fully evaluated yet.
+  EvaluatorValuePtr copyValue(
+      evaluator::EvaluatorValue *value,
+      DenseMap<evaluator::EvaluatorValue *, EvaluatorValuePtr> &copies);
   FailureOr<EvaluatorValuePtr>
   evaluateObjectField(ObjectFieldOp op, ActualParameters actualParams,
                       Location loc);
@@ -499,13 +576,39 @@ private:
   evaluateEmptyPath(FrozenEmptyPathOp op, ActualParameters actualParams,
                     Location loc);
 
-  FailureOr<ActualParameters>
-  createParametersFromOperands(ValueRange range, ActualParameters actualParams,
-                               Location loc);
+  /// Evaluate the ObjectOps in the body of `cls` whose actual parameters are
+  /// already known and can be copied. They are split into one chunk per
+  /// thread, and each chunk is evaluated by an Evaluator of its own. The
+  /// results are added to `instances`, so sequential evaluation copies them
+  /// when it reaches the ObjectOps, exactly as it would copy the result of an
+  /// identical instantiation.
+  LogicalResult evaluateIndependentObjects(ClassOp cls,
+                                           ActualParameters actualParams);
+
+  /// Instantiate a class and evaluate everything it depends on, without
+  /// finalizing the result.
+  FailureOr<EvaluatorValuePtr> evaluateClass(StringAttr className,
+                                             ActualParameters actualParams,
+                                             Location loc);
+
+  ActualParameters
+  createParameters(SmallVector<evaluator::EvaluatorValuePtr> parameters);
 
   /// The symbol table for the IR module the Evaluator was constructed with.
-  /// Used to look up class definitions.
-  SymbolTable symbolTable;
+  /// Used to look up class definitions. It is shared with the Evaluators used
+  /// for parallel evaluation, which only read from it.
+  std::shared_ptr<SymbolTable> symbolTable;
+
+  /// Whether independent objects are evaluated in parallel.
+  bool parallel;
+
+  /// The arenas owned by this Evaluator: its own, if it is not used for
+  /// parallel evaluation, and one per chunk of parallel evaluation. They are
+  /// declared before any values, so they are destroyed after them.
+  SmallVector<std::unique_ptr<evaluator::ValueArena>> arenas;
+
+  /// The memory all values are allocated from.
+  evaluator::ValueArena &arena;
 
   /// This uniquely stores vectors that represent parameters.
   SmallVector<
@@ -518,6 +621,12 @@ private:
   /// Evaluator value storage. Return an evaluator value for the given
   /// instantiation context (a pair of Value and parameters).
   DenseMap<ObjectKey, std::shared_ptr<evaluator::EvaluatorValue>> objects;
+
+  /// The result of the first instantiation of a class for a set of actual leaf
+  /// parameters. Later instantiations with the same parameters copy its fields
+  /// instead of evaluating the class body again. The keys point to arrays in
+  /// `arena`.
+  DenseMap<InstanceKey, Instance> instances;
 };
 
 /// Helper to enable printing objects in Diagnostics.
@@ -259,6 +259,14 @@ delayed = evaluator.instantiate("IntegerBinaryArithmeticObjectsDelayed")
 # CHECK: 3
 print(delayed.result)
 
+# Test parallel evaluation, where both children of Test are independent.
+parallel_evaluator = om.Evaluator(evaluator.module, parallel=True)
+parallel_obj = parallel_evaluator.instantiate("Test", 42)
+
+# CHECK: 42 14 15
+print(parallel_obj.field, parallel_obj.child.foo,
+      parallel_obj.nest.list_child[1].foo)
+
 with Context() as ctx:
   circt.register_dialects(ctx)
 
@@ -0,0 +1,63 @@
+// REQUIRES: esi-runtime
+// RUN: rm -rf %t && mkdir %t && cd %t
+// RUN: circt-opt %s --esi-connect-services --esi-appid-hier=top=top --esi-build-manifest=top=top > /dev/null
+// RUN: %python -m esiaccel.codegen esi_system_manifest.json -o types.h 2> warnings.txt
+// RUN: FileCheck %s --input-file=types.h
+// RUN: FileCheck %s --check-prefix=WARN --input-file=warnings.txt
+// RUN: %host_cxx -std=c++20 -I %esi_runtime_include -I %t %s.cpp -o roundtrip
+// RUN: ./roundtrip | FileCheck %s --check-prefix=ROUNDTRIP
+
+hw.type_scope @pkg {
+  hw.typedecl @Pair : !hw.struct<x: i3, y: si5>
+  hw.typedecl @Arg : !hw.struct<a: ui16, b: si8, c: !hw.typealias<@pkg::@Pair, !hw.struct<x: i3, y: si5>>>
+  hw.typedecl @Triple : !hw.array<3xsi7>
+  hw.typedecl @Wide : ui70
+}
+
+!Pair = !hw.typealias<@pkg::@Pair, !hw.struct<x: i3, y: si5>>
+!Arg = !hw.typealias<@pkg::@Arg, !hw.struct<a: ui16, b: si8, c: !Pair>>
+!Triple = !hw.typealias<@pkg::@Triple, !hw.array<3xsi7>>
+!Wide = !hw.typealias<@pkg::@Wide, ui70>
+
+!toHW = !esi.bundle<[
+  !esi.channel<!Arg> to "arg",
+  !esi.channel<si12> to "int",
+  !esi.channel<!Triple> to "triple",
+  !esi.channel<!Wide> to "wide"]>
+!ack = !esi.bundle<[!esi.channel<i0> from "ack"]>
+
+esi.service.decl @HostComms {
+  esi.service.port @Recv : !toHW
+  esi.service.port @Ack : !ack
+}
+
+hw.module @Consumer() {
+  %bundle = esi.service.req <@HostComms::@Recv> (#esi.appid<"recv">) : !toHW
+  %arg, %int, %triple, %wide = esi.bundle.unpack from %bundle : !toHW
+
+  %c0_0 = hw.constant 0 : i0
+  %c0_1 = hw.constant 0 : i1
+  %ack, %ready = esi.wrap.vr %c0_0, %c0_1 : i0
+  esi.bundle.unpack %ack from %ackBundle : !ack
+  %ackBundle = esi.service.req <@HostComms::@Ack> (#esi.appid<"ack">) : !ack
+}
+
+hw.module @top(in %clk: !seq.clock, in %rst: i1) {
+  esi.service.instance #esi.appid<"cosim"> svc @HostComms impl as "cosim" (%clk, %rst) : (!seq.clock, i1) -> ()
+  hw.instance "consumer" @Consumer() -> ()
+}
+
+// CHECK-DAG: using Pair = Struct_{{[0-9a-f]+}};
+// CHECK-DAG: using Arg = Struct_{{[0-9a-f]+}};
+// CHECK-DAG: struct SInt12 {
+// CHECK-DAG: struct Triple {
+// CHECK-DAG: std::array<int8_t, 3> value;
+// CHECK-DAG: struct Wide {
+// CHECK-DAG: std::array<uint8_t, 9> value;
+
+// WARN: warning: no C++ type generated for i0: it has no bits
+
+// ROUNDTRIP:      arg: a=beef b=-5 c.x=5 c.y=-9
+// ROUNDTRIP-NEXT: int: fd 0f -> -3
+// ROUNDTRIP-NEXT: triple: -64 0 63
+// ROUNDTRIP-NEXT: wide: ok
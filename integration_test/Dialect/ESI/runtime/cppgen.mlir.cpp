@@ -0,0 +1,47 @@
+//===- cppgen.mlir.cpp - Round trip through the generated C++ types -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "types.h"
+
+#include <cstdio>
+
+using namespace esi_types;
+
+template <typename T>
+static T roundTrip(const T &value) {
+  uint8_t bytes[T::numBytes] = {};
+  value.pack(bytes);
+  return T::unpack(bytes);
+}
+
+int main() {
+  Arg arg;
+  arg.a = 0xbeef;
+  arg.b = -5;
+  arg.c = Pair{5, -9};
+  Arg arg2 = roundTrip(arg);
+  printf("arg: a=%x b=%d c.x=%d c.y=%d\n", arg2.a, arg2.b, arg2.c.x,
+         arg2.c.y);
+
+  // The value is laid out LSB first, sign-extended on unpacking.
+  uint8_t bytes[SInt12::numBytes] = {};
+  SInt12{-3}.pack(bytes);
+  printf("int: %02x %02x -> %d\n", bytes[0], bytes[1],
+         roundTrip(SInt12{-3}).value);
+
+  Triple triple = roundTrip(Triple{{{-64, 0, 63}}});
+  printf("triple: %d %d %d\n", triple.value[0], triple.value[1],
+         triple.value[2]);
+
+  Wide wide{};
+  for (unsigned i = 0; i < Wide::numBytes; ++i)
+    wide.value[i] = 0x11 * (i + 1);
+  wide.value[Wide::numBytes - 1] &= 0x3f;
+  printf("wide: %s\n", roundTrip(wide).value == wide.value ? "ok" : "mismatch");
+  return 0;
+}
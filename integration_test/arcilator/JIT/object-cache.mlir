@@ -0,0 +1,14 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: arcilator %s --emit-object --cache-dir=%t -o %t/adder.o
+// RUN: arcilator %s --emit-object --cache-dir=%t --until-before=llvm-lowering | FileCheck %s
+// REQUIRES: arcilator-jit
+
+// A run which stops before the end of the pipeline must print the partially
+// lowered IR instead of the cached object file.
+
+// CHECK: arc.model @adder
+
+hw.module @adder(in %a: i8, in %b: i8, out c: i8) {
+  %res = comb.add %a, %b : i8
+  hw.output %res : i8
+}
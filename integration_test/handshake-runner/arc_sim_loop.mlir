@@ -0,0 +1,33 @@
+// REQUIRES: arcilator-jit
+// RUN: circt-opt -lower-cf-to-handshake -handshake-materialize-forks-sinks %s | handshake-runner --emit-arc-sim 10 | arcilator --run --jit-entry=main_tb | FileCheck %s
+// RUN: circt-opt -lower-cf-to-handshake -handshake-materialize-forks-sinks %s | handshake-runner --emit-arc-sim --arc-sim-iterations=4 10 | arcilator --run --jit-entry=main_tb | FileCheck %s --check-prefix=ITER
+
+// RUN: circt-opt -lower-cf-to-handshake -handshake-materialize-forks-sinks %s | handshake-runner --emit-arc-sim --arc-sim-max-cycles=5 10 | not arcilator --run --jit-entry=main_tb | FileCheck %s --check-prefix=LIMIT
+
+// CHECK: out0 = 2a
+// CHECK-NEXT: cycles = {{[0-9a-f]+}}
+// CHECK-NEXT: results = 1
+
+// ITER: out0 = 2a
+// ITER-NEXT: cycles = {{[0-9a-f]+}}
+// ITER-NEXT: results = 4
+// ITER-NEXT: cycles_per_result = {{[0-9a-f]+}}
+
+// LIMIT: cycle_limit_reached = 5
+// LIMIT-NOT: out0
+
+module {
+  func.func @main(%arg0: index) -> index {
+    %c1 = arith.constant 1 : index
+    %c42 = arith.constant 42 : index
+    cf.br ^bb1(%arg0 : index)
+  ^bb1(%0: index):
+    %1 = arith.cmpi slt, %0, %c42 : index
+    cf.cond_br %1, ^bb2, ^bb3
+  ^bb2:
+    %2 = arith.addi %0, %c1 : index
+    cf.br ^bb1(%2 : index)
+  ^bb3:
+    return %0 : index
+  }
+}
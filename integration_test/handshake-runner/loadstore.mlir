@@ -1,5 +1,6 @@
 // RUN: handshake-runner %s 2 | FileCheck %s
 // RUN: circt-opt -lower-cf-to-handshake -handshake-materialize-forks-sinks %s | handshake-runner - 2 | FileCheck %s
+// RUN: circt-opt -lower-cf-to-handshake -handshake-materialize-forks-sinks %s | handshake-runner --engine=compiled - 2 | FileCheck %s
 // CHECK: 1
 
 module {
@@ -1,6 +1,12 @@
 // RUN: handshake-runner %s "(64, 32, 64)" | FileCheck %s
+// RUN: not handshake-runner --engine=compiled %s "(64, 32, 64)" 2>&1 | FileCheck %s --check-prefix=COMPILED
 // CHECK: (128, 32)
 
+// The compiled engine does not support tuples and must not silently fall back
+// to the interpreter.
+// COMPILED: error: argument type tuple<i64, i32, i64> is not supported by the compiled engine
+// COMPILED-NOT: (128, 32)
+
 module {
   handshake.func @main(%arg0: tuple<i64, i32, i64>, %ctrl: none, ...) -> (tuple<i64, i32>, none) {
     %0, %1, %2 = unpack %arg0 : tuple<i64, i32, i64>
@@ -175,6 +175,13 @@ if config.esi_runtime == "1":
                                [f"{config.esi_runtime_path}/python/"],
                                append_path=True)
 
+  # For compiling C++ generated from ESI manifests.
+  config.substitutions.append(('%host_cxx', config.host_cxx))
+  config.substitutions.append(
+      ('%esi_runtime_include',
+       os.path.join(config.circt_src_root, 'lib', 'Dialect', 'ESI', 'runtime',
+                    'cpp', 'include')))
+
   # Enable ESI cosim tests if they have been built.
   if config.esi_cosim != "OFF":
     config.available_features.add('esi-cosim')
@@ -214,7 +214,8 @@ private:
 /// Provides an Evaluator class by simply wrapping the OMEvaluator CAPI.
 struct Evaluator {
   // Instantiate an Evaluator with a reference to the underlying OMEvaluator.
-  Evaluator(MlirModule mod) : evaluator(omEvaluatorNew(mod)) {}
+  Evaluator(MlirModule mod, bool parallel)
+      : evaluator(omEvaluatorNewWithParallelism(mod, parallel)) {}
 
   // Instantiate an Object.
   Object instantiate(MlirAttribute className,
@@ -416,7 +417,8 @@ void circt::python::populateDialectOMSubmodule(py::module &m) {
 
   // Add the Evaluator class definition.
   py::class_<Evaluator>(m, "Evaluator")
-      .def(py::init<MlirModule>(), py::arg("module"))
+      .def(py::init<MlirModule, bool>(), py::arg("module"),
+           py::arg("parallel") = false)
       .def("instantiate", &Evaluator::instantiate, "Instantiate an Object",
            py::arg("class_name"), py::arg("actual_params"))
       .def_property_readonly("module", &Evaluator::getModule,
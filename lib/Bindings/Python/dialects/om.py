@@ -166,11 +166,12 @@ class Object(BaseObject):
 # Define the Evaluator class by inheriting from the base implementation in C++.
 class Evaluator(BaseEvaluator):
 
-  def __init__(self, mod: Module) -> None:
-    """Instantiate an Evaluator with a Module."""
+  def __init__(self, mod: Module, parallel: bool = False) -> None:
+    """Instantiate an Evaluator with a Module. If parallel is set, independent
+    objects are evaluated concurrently."""
 
     # Call the base constructor.
-    super().__init__(mod)
+    super().__init__(mod, parallel)
 
     # Set up logging for diagnostics.
     logging.basicConfig(
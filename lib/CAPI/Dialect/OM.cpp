@@ -107,6 +107,12 @@ OMEvaluator omEvaluatorNew(MlirModule mod) {
   return wrap(new Evaluator(unwrap(mod)));
 }
 
+/// Construct an Evaluator with an IR module, which optionally evaluates
+/// independent objects in parallel.
+OMEvaluator omEvaluatorNewWithParallelism(MlirModule mod, bool parallel) {
+  return wrap(new Evaluator(unwrap(mod), parallel));
+}
+
 /// Use the Evaluator to Instantiate an Object from its class name and actual
 /// parameters.
 OMEvaluatorValue omEvaluatorInstantiate(OMEvaluator evaluator,
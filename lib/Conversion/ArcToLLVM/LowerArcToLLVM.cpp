@@ -71,6 +71,46 @@ struct ModelOpLowering : public OpConversionPattern<arc::ModelOp> {
   }
 };
 
+/// Lowers a parallel dispatch to a call into the simulation runtime, which
+/// invokes the dispatch function once for every bit set in the task mask.
+struct ParallelDispatchOpLowering
+    : public OpConversionPattern<arc::ParallelDispatchOp> {
+  using OpConversionPattern::OpConversionPattern;
+  LogicalResult
+  matchAndRewrite(arc::ParallelDispatchOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const final {
+    Location loc = op.getLoc();
+    ModuleOp moduleOp = op->getParentOfType<ModuleOp>();
+    if (!moduleOp)
+      return failure();
+
+    auto ptrType = LLVM::LLVMPointerType::get(getContext());
+    auto i64Type = rewriter.getI64Type();
+
+    // Pack the enable conditions into a mask with one bit per task.
+    Value mask = rewriter.create<LLVM::ConstantOp>(
+        loc, i64Type, rewriter.getI64IntegerAttr(0));
+    for (auto [index, enable] : llvm::enumerate(adaptor.getEnables())) {
+      Value bit = rewriter.create<LLVM::ZExtOp>(loc, i64Type, enable);
+      if (index != 0) {
+        Value amount = rewriter.create<LLVM::ConstantOp>(
+            loc, i64Type, rewriter.getI64IntegerAttr(index));
+        bit = rewriter.create<LLVM::ShlOp>(loc, bit, amount);
+      }
+      mask = rewriter.create<LLVM::OrOp>(loc, mask, bit);
+    }
+
+    auto runtimeFunc = LLVM::lookupOrCreateFn(
+        moduleOp, "arcRuntimeParallelFor", {ptrType, ptrType, i64Type},
+        LLVM::LLVMVoidType::get(getContext()));
+    Value callee =
+        rewriter.create<LLVM::AddressOfOp>(loc, ptrType, op.getCallee());
+    rewriter.replaceOpWithNewOp<LLVM::CallOp>(
+        op, runtimeFunc, ValueRange{callee, adaptor.getStorage(), mask});
+    return success();
+  }
+};
+
 struct AllocStorageOpLowering
     : public OpConversionPattern<arc::AllocStorageOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -173,6 +213,26 @@ struct StorageGetOpLowering : public OpConversionPattern<arc::StorageGetOp> {
   }
 };
 
+struct StorageLaneOpLowering
+    : public OpConversionPattern<arc::StorageLaneOp> {
+  using OpConversionPattern::OpConversionPattern;
+  LogicalResult
+  matchAndRewrite(arc::StorageLaneOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const final {
+    auto laneType = adaptor.getLane().getType();
+    Value laneSize = rewriter.create<LLVM::ConstantOp>(
+        op.getLoc(), laneType,
+        rewriter.getIntegerAttr(laneType, op.getLaneSize()));
+    Value offset =
+        rewriter.create<LLVM::MulOp>(op.getLoc(), adaptor.getLane(), laneSize);
+    Value ptr = rewriter.create<LLVM::GEPOp>(
+        op.getLoc(), adaptor.getStorage().getType(), rewriter.getI8Type(),
+        adaptor.getStorage(), offset);
+    rewriter.replaceOp(op, ptr);
+    return success();
+  }
+};
+
 struct MemoryAccess {
   Value ptr;
   Value withinBounds;
@@ -617,6 +677,7 @@ void LowerArcToLLVMPass::runOnOperation() {
     MemoryReadOpLowering,
     MemoryWriteOpLowering,
     ModelOpLowering,
+    ParallelDispatchOpLowering,
     ReplaceOpWithInputPattern<seq::ToClockOp>,
     ReplaceOpWithInputPattern<seq::FromClockOp>,
     SeqConstClockLowering,
@@ -624,6 +685,7 @@ void LowerArcToLLVMPass::runOnOperation() {
     StateReadOpLowering,
     StateWriteOpLowering,
     StorageGetOpLowering,
+    StorageLaneOpLowering,
     ZeroCountOpLowering
   >(converter, &getContext());
   // clang-format on
@@ -271,6 +271,37 @@ LogicalResult ClockDomainOp::verifyRegions() {
                                    getInputs().getTypes(), "input");
 }
 
+//===----------------------------------------------------------------------===//
+// ParallelDispatchOp
+//===----------------------------------------------------------------------===//
+
+LogicalResult ParallelDispatchOp::verify() {
+  if (getEnables().empty())
+    return emitOpError("must dispatch at least one task");
+  if (getEnables().size() > 64)
+    return emitOpError("cannot dispatch more than 64 tasks at once");
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// StorageLaneOp
+//===----------------------------------------------------------------------===//
+
+unsigned StorageLaneOp::getLaneSize() {
+  if (auto memType = dyn_cast<MemoryType>(getType()))
+    return memType.getNumWords() * memType.getStride();
+  return cast<StateType>(getType()).getByteWidth();
+}
+
+LogicalResult StorageLaneOp::verify() {
+  unsigned laneSize = getLaneSize();
+  unsigned size = getStorage().getType().getSize();
+  if (laneSize != 0 && size % laneSize != 0)
+    return emitOpError("storage size ")
+           << size << " is not a multiple of the lane size " << laneSize;
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // RootInputOp
 //===----------------------------------------------------------------------===//
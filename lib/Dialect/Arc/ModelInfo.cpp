@@ -63,6 +63,9 @@ LogicalResult circt::arc::collectStates(Value storage, unsigned offset,
     if (!opOffset)
       return op->emitOpError(
           "without allocated offset; run state allocation first");
+    std::optional<unsigned> dirtyOffset;
+    if (auto attr = op->getAttrOfType<IntegerAttr>("dirty_offset"))
+      dirtyOffset = attr.getValue().getZExtValue() + offset;
 
     if (isa<AllocStateOp, RootInputOp, RootOutputOp>(op)) {
       auto result = op->getResult(0);
@@ -79,6 +82,7 @@ LogicalResult circt::arc::collectStates(Value storage, unsigned offset,
       stateInfo.name = opName.getValue();
       stateInfo.offset = opOffset.getValue().getZExtValue() + offset;
       stateInfo.numBits = cast<StateType>(result.getType()).getBitWidth();
+      stateInfo.dirtyOffset = dirtyOffset;
       continue;
     }
 
@@ -96,6 +100,7 @@ LogicalResult circt::arc::collectStates(Value storage, unsigned offset,
       stateInfo.numBits = intType.getWidth();
       stateInfo.memoryStride = stride.getValue().getZExtValue();
       stateInfo.memoryDepth = memType.getNumWords();
+      stateInfo.dirtyOffset = dirtyOffset;
       continue;
     }
   }
@@ -114,8 +119,12 @@ LogicalResult circt::arc::collectModels(mlir::ModuleOp module,
       return failure();
     llvm::sort(states, [](auto &a, auto &b) { return a.offset < b.offset; });
 
+    unsigned numLanes = 1;
+    if (auto lanes = modelOp->getAttrOfType<IntegerAttr>("lanes"))
+      numLanes = lanes.getValue().getZExtValue();
+
     models.emplace_back(std::string(modelOp.getName()), storageType.getSize(),
-                        std::move(states));
+                        std::move(states), numLanes);
   }
 
   return success();
@@ -130,6 +139,8 @@ void circt::arc::serializeModelInfoToJson(llvm::raw_ostream &outputStream,
       json.object([&] {
         json.attribute("name", model.name);
         json.attribute("numStateBytes", model.numStateBytes);
+        if (model.numLanes > 1)
+          json.attribute("lanes", model.numLanes);
         json.attributeArray("states", [&] {
           for (const auto &state : model.states) {
             json.object([&] {
@@ -156,6 +167,8 @@ void circt::arc::serializeModelInfoToJson(llvm::raw_ostream &outputStream,
                 json.attribute("stride", state.memoryStride);
                 json.attribute("depth", state.memoryDepth);
               }
+              if (state.dirtyOffset)
+                json.attribute("dirtyOffset", *state.dirtyOffset);
             });
           }
         });
@@ -8,6 +8,7 @@
 
 #include "circt/Dialect/Arc/ArcOps.h"
 #include "circt/Dialect/Arc/ArcPasses.h"
+#include "circt/Dialect/HW/HWOps.h"
 #include "mlir/IR/ImplicitLocOpBuilder.h"
 #include "mlir/Pass/Pass.h"
 #include "llvm/Support/Debug.h"
@@ -34,6 +35,7 @@ using llvm::SmallMapVector;
 namespace {
 struct AllocateStatePass
     : public arc::impl::AllocateStateBase<AllocateStatePass> {
+  using AllocateStateBase::AllocateStateBase;
   void runOnOperation() override;
   void allocateBlock(Block *block);
   void allocateOps(Value storage, Block *block, ArrayRef<Operation *> ops);
@@ -71,6 +73,7 @@ void AllocateStatePass::allocateBlock(Block *block) {
 void AllocateStatePass::allocateOps(Value storage, Block *block,
                                     ArrayRef<Operation *> ops) {
   SmallVector<std::tuple<Value, Value, IntegerAttr>> gettersToCreate;
+  SmallVector<std::tuple<Value, Value, IntegerAttr>> dirtyFlagsToCreate;
 
   // Helper function to allocate storage aligned to its own size, or 8 bytes at
   // most.
@@ -83,8 +86,23 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
     return offset;
   };
 
-  // Allocate storage for the operations.
+  // Helper function to allocate a dirty flag for states and memories that are
+  // visible in the model info. Inputs are written by the driver directly and
+  // are therefore not tracked.
   OpBuilder builder(block->getParentOp());
+  auto allocDirtyFlag = [&](Operation *op) {
+    if (!dirtyTracking || isa<RootInputOp>(op))
+      return;
+    auto name = op->getAttrOfType<StringAttr>("name");
+    if (!name || name.getValue().empty())
+      return;
+    auto offset = builder.getI32IntegerAttr(allocBytes(1));
+    op->setAttr("dirty_offset", offset);
+    dirtyFlagsToCreate.emplace_back(op->getResult(0), op->getOperand(0),
+                                    offset);
+  };
+
+  // Allocate storage for the operations.
   for (auto *op : ops) {
     if (isa<AllocStateOp, RootInputOp, RootOutputOp>(op)) {
       auto result = op->getResult(0);
@@ -93,6 +111,7 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
       auto offset = builder.getI32IntegerAttr(allocBytes(numBytes));
       op->setAttr("offset", offset);
       gettersToCreate.emplace_back(result, storage, offset);
+      allocDirtyFlag(op);
       continue;
     }
 
@@ -104,6 +123,7 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
       op->setAttr("offset", offset);
       op->setAttr("stride", builder.getI32IntegerAttr(stride));
       gettersToCreate.emplace_back(memOp, memOp.getStorage(), offset);
+      allocDirtyFlag(op);
       continue;
     }
 
@@ -119,12 +139,33 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
     assert("unsupported op for allocation" && false);
   }
 
+  // Set the dirty flag of a state or memory alongside every write to it, under
+  // the same condition as the write itself.
+  SmallVector<StorageGetOp> getters;
+  for (auto [result, storage, offset] : dirtyFlagsToCreate) {
+    for (auto *user : llvm::make_early_inc_range(result.getUsers())) {
+      Value condition;
+      if (auto writeOp = dyn_cast<StateWriteOp>(user);
+          writeOp && writeOp.getState() == result)
+        condition = writeOp.getCondition();
+      else if (auto memWriteOp = dyn_cast<MemoryWriteOp>(user))
+        condition = memWriteOp.getEnable();
+      else
+        continue;
+      ImplicitLocOpBuilder builder(user->getLoc(), user);
+      auto flag = builder.create<StorageGetOp>(
+          StateType::get(builder.getI1Type()), storage, offset);
+      auto one = builder.create<hw::ConstantOp>(builder.getI1Type(), 1);
+      builder.create<StateWriteOp>(flag, one, condition);
+      getters.push_back(flag);
+    }
+  }
+
   // For every user of the alloc op, create a local `StorageGetOp`.
   // First, create an ordering of operations to avoid a very expensive
   // combination of isBeforeInBlock and moveBefore calls (which can be O(n²))
   DenseMap<Operation *, unsigned> opOrder;
   block->walk([&](Operation *op) { opOrder.insert({op, opOrder.size()}); });
-  SmallVector<StorageGetOp> getters;
   for (auto [result, storage, offset] : gettersToCreate) {
     SmallDenseMap<Block *, StorageGetOp> getterForBlock;
     for (auto *user : llvm::make_early_inc_range(result.getUsers())) {
@@ -164,6 +205,7 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
   }
 }
 
-std::unique_ptr<Pass> arc::createAllocateStatePass() {
-  return std::make_unique<AllocateStatePass>();
+std::unique_ptr<Pass>
+arc::createAllocateStatePass(const AllocateStateOptions &options) {
+  return std::make_unique<AllocateStatePass>(options);
 }
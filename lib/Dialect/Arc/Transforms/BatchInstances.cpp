@@ -0,0 +1,182 @@
+//===- BatchInstances.cpp -------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Arc/ArcOps.h"
+#include "circt/Dialect/Arc/ArcPasses.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "arc-batch-instances"
+
+namespace circt {
+namespace arc {
+#define GEN_PASS_DEF_BATCHINSTANCES
+#include "circt/Dialect/Arc/ArcPasses.h.inc"
+} // namespace arc
+} // namespace circt
+
+using namespace mlir;
+using namespace circt;
+using namespace arc;
+
+//===----------------------------------------------------------------------===//
+// Pass Implementation
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct BatchInstancesPass
+    : public arc::impl::BatchInstancesBase<BatchInstancesPass> {
+  using BatchInstancesBase::BatchInstancesBase;
+  void runOnOperation() override;
+
+  Type scaleType(Type type);
+  IntegerAttr scaleOffset(IntegerAttr offset);
+  void batchFunc(func::FuncOp funcOp);
+  void batchModel(ModelOp modelOp);
+  void batchAccesses(Operation *root, Value lane);
+
+  /// The functions that have been given an additional lane argument.
+  DenseSet<StringAttr> batchedFuncs;
+};
+} // namespace
+
+void BatchInstancesPass::runOnOperation() {
+  if (numLanes <= 1)
+    return;
+  batchedFuncs.clear();
+
+  // Parallel dispatches hand the storage to the runtime without a lane, which
+  // we cannot thread through.
+  auto result = getOperation().walk([](ParallelDispatchOp op) {
+    op.emitOpError("cannot be combined with batched instances");
+    return WalkResult::interrupt();
+  });
+  if (result.wasInterrupted())
+    return signalPassFailure();
+
+  // Give every function that operates on the storage a lane argument first,
+  // such that all calls to them can be updated while rewriting the accesses.
+  SmallVector<func::FuncOp> funcOps;
+  for (auto funcOp : getOperation().getOps<func::FuncOp>()) {
+    if (funcOp.isExternal() ||
+        !llvm::any_of(funcOp.getArgumentTypes(), llvm::IsaPred<StorageType>))
+      continue;
+    batchFunc(funcOp);
+    funcOps.push_back(funcOp);
+  }
+  for (auto funcOp : funcOps)
+    batchAccesses(funcOp, funcOp.getArguments().back());
+
+  for (auto modelOp : getOperation().getOps<ModelOp>())
+    batchModel(modelOp);
+}
+
+/// Scale the size of a storage slice to hold all lanes.
+Type BatchInstancesPass::scaleType(Type type) {
+  if (auto storageType = dyn_cast<StorageType>(type))
+    return StorageType::get(&getContext(), storageType.getSize() * numLanes);
+  return type;
+}
+
+IntegerAttr BatchInstancesPass::scaleOffset(IntegerAttr offset) {
+  return IntegerAttr::get(offset.getType(),
+                          offset.getValue().getZExtValue() * numLanes);
+}
+
+/// Add a lane argument to a function and scale its storage arguments.
+void BatchInstancesPass::batchFunc(func::FuncOp funcOp) {
+  LLVM_DEBUG(llvm::dbgs() << "- Batching function `" << funcOp.getSymName()
+                          << "`\n");
+  for (auto arg : funcOp.getArguments())
+    arg.setType(scaleType(arg.getType()));
+  funcOp.getBody().addArgument(IndexType::get(&getContext()), funcOp.getLoc());
+  funcOp.setFunctionType(FunctionType::get(
+      &getContext(), funcOp.getBody().getArgumentTypes(),
+      funcOp.getResultTypes()));
+  batchedFuncs.insert(funcOp.getSymNameAttr());
+}
+
+/// Scale the model storage and wrap the model body in a loop over all lanes.
+/// The allocation ops stay outside the loop, since they only carry the layout.
+void BatchInstancesPass::batchModel(ModelOp modelOp) {
+  LLVM_DEBUG(llvm::dbgs() << "- Batching model `" << modelOp.getName()
+                          << "`\n");
+  Block &block = modelOp.getBodyBlock();
+  auto storage = block.getArgument(0);
+  storage.setType(scaleType(storage.getType()));
+  modelOp->setAttr("lanes", IntegerAttr::get(
+                                IntegerType::get(&getContext(), 32), numLanes));
+
+  SmallVector<Operation *> bodyOps;
+  for (auto &op : block)
+    if (!isa<AllocStateOp, RootInputOp, RootOutputOp, AllocMemoryOp,
+             AllocStorageOp>(&op))
+      bodyOps.push_back(&op);
+
+  auto builder = OpBuilder::atBlockEnd(&block);
+  auto loc = modelOp.getLoc();
+  auto lb = builder.create<arith::ConstantIndexOp>(loc, 0);
+  auto ub = builder.create<arith::ConstantIndexOp>(loc, numLanes);
+  auto step = builder.create<arith::ConstantIndexOp>(loc, 1);
+  auto forOp = builder.create<scf::ForOp>(loc, lb, ub, step);
+  for (auto *op : bodyOps)
+    op->moveBefore(forOp.getBody()->getTerminator());
+  batchAccesses(modelOp, forOp.getInductionVar());
+}
+
+/// Scale the allocations within `root` and redirect all storage accesses and
+/// storage-carrying calls to the given lane.
+void BatchInstancesPass::batchAccesses(Operation *root, Value lane) {
+  root->walk([&](Operation *op) {
+    if (isa<AllocStateOp, RootInputOp, RootOutputOp, AllocMemoryOp>(op)) {
+      if (auto offset = op->getAttrOfType<IntegerAttr>("offset"))
+        op->setAttr("offset", scaleOffset(offset));
+      if (auto dirtyOffset = op->getAttrOfType<IntegerAttr>("dirty_offset"))
+        op->setAttr("dirty_offset", scaleOffset(dirtyOffset));
+      return;
+    }
+
+    if (auto allocOp = dyn_cast<AllocStorageOp>(op)) {
+      if (auto offset = allocOp.getOffsetAttr())
+        allocOp.setOffsetAttr(scaleOffset(offset));
+      allocOp.getOutput().setType(
+          cast<StorageType>(scaleType(allocOp.getType())));
+      return;
+    }
+
+    if (auto callOp = dyn_cast<func::CallOp>(op)) {
+      if (batchedFuncs.contains(callOp.getCalleeAttr().getAttr()))
+        callOp.getOperandsMutable().append(lane);
+      return;
+    }
+
+    auto getOp = dyn_cast<StorageGetOp>(op);
+    if (!getOp)
+      return;
+    getOp.setOffsetAttr(scaleOffset(getOp.getOffsetAttr()));
+
+    // Storage slices cover all lanes and are accessed further down.
+    if (isa<StorageType>(getOp.getType())) {
+      getOp.getResult().setType(scaleType(getOp.getType()));
+      return;
+    }
+
+    // States and memories are accessed as a slice with one copy per lane, of
+    // which we pick the current one.
+    OpBuilder builder(getOp);
+    builder.setInsertionPointAfter(getOp);
+    auto laneOp = builder.create<StorageLaneOp>(
+        getOp.getLoc(), getOp.getType(), getOp.getResult(), lane);
+    getOp.getResult().replaceAllUsesExcept(laneOp, laneOp);
+    getOp.getResult().setType(StorageType::get(
+        &getContext(), laneOp.getLaneSize() * numLanes));
+  });
+}
@@ -0,0 +1,340 @@
+//===- ParallelizeClocks.cpp ----------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Arc/ArcOps.h"
+#include "circt/Dialect/Arc/ArcPasses.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "arc-parallelize-clocks"
+
+namespace circt {
+namespace arc {
+#define GEN_PASS_DEF_PARALLELIZECLOCKS
+#include "circt/Dialect/Arc/ArcPasses.h.inc"
+} // namespace arc
+} // namespace circt
+
+using namespace mlir;
+using namespace circt;
+using namespace arc;
+
+/// The maximum number of tasks a single `arc.parallel_dispatch` can carry. The
+/// runtime receives the enable conditions packed into a 64 bit mask.
+static constexpr unsigned maxTasksPerDispatch = 64;
+
+//===----------------------------------------------------------------------===//
+// State Access Analysis
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The byte ranges of the model storage read and written by a function. If the
+/// function uses the storage in a way we cannot track, it is marked as
+/// accessing unknown state, which conflicts with any other access.
+struct StateAccesses {
+  using Range = std::pair<uint64_t, uint64_t>;
+  SmallVector<Range> reads;
+  SmallVector<Range> writes;
+  bool unknown = false;
+
+  void canonicalize();
+  bool conflictsWith(const StateAccesses &other) const;
+};
+} // namespace
+
+/// Sort a list of half-open ranges and merge the ones that overlap.
+static void canonicalizeRanges(SmallVectorImpl<StateAccesses::Range> &ranges) {
+  llvm::sort(ranges);
+  SmallVector<StateAccesses::Range> merged;
+  for (auto range : ranges) {
+    if (!merged.empty() && range.first <= merged.back().second)
+      merged.back().second = std::max(merged.back().second, range.second);
+    else
+      merged.push_back(range);
+  }
+  ranges.assign(merged.begin(), merged.end());
+}
+
+/// Check whether two sorted and merged lists of ranges overlap anywhere.
+static bool rangesOverlap(ArrayRef<StateAccesses::Range> a,
+                          ArrayRef<StateAccesses::Range> b) {
+  const auto *itA = a.begin(), *itB = b.begin();
+  while (itA != a.end() && itB != b.end()) {
+    if (itA->second <= itB->first)
+      ++itA;
+    else if (itB->second <= itA->first)
+      ++itB;
+    else
+      return true;
+  }
+  return false;
+}
+
+void StateAccesses::canonicalize() {
+  canonicalizeRanges(reads);
+  canonicalizeRanges(writes);
+}
+
+bool StateAccesses::conflictsWith(const StateAccesses &other) const {
+  if (unknown || other.unknown)
+    return true;
+  return rangesOverlap(writes, other.writes) ||
+         rangesOverlap(writes, other.reads) ||
+         rangesOverlap(reads, other.writes);
+}
+
+/// Collect the storage ranges accessed by a clock or passthrough function. The
+/// function is expected to take the model storage as its only argument and to
+/// access it exclusively through `arc.storage.get` ops with constant offsets,
+/// which is what `arc-allocate-state` and `arc-lower-clocks-to-funcs` produce.
+static StateAccesses computeStateAccesses(func::FuncOp funcOp) {
+  StateAccesses accesses;
+  if (!funcOp || funcOp.isExternal() || funcOp.getNumArguments() != 1) {
+    accesses.unknown = true;
+    return accesses;
+  }
+
+  DenseMap<Value, uint64_t> offsets;
+  offsets.insert({funcOp.getArgument(0), 0});
+
+  auto addRange = [&](SmallVectorImpl<StateAccesses::Range> &ranges,
+                      Value value, uint64_t numBytes) {
+    auto it = offsets.find(value);
+    if (it == offsets.end())
+      return false;
+    ranges.push_back({it->second, it->second + numBytes});
+    return true;
+  };
+  auto memorySize = [](Value memory) -> uint64_t {
+    auto type = cast<MemoryType>(memory.getType());
+    return uint64_t(type.getNumWords()) * type.getStride();
+  };
+
+  auto result = funcOp.walk([&](Operation *op) {
+    bool known = true;
+    if (auto getOp = dyn_cast<StorageGetOp>(op)) {
+      auto it = offsets.find(getOp.getStorage());
+      if (it == offsets.end())
+        return WalkResult::interrupt();
+      offsets.insert({getOp.getResult(), it->second + getOp.getOffset()});
+    } else if (auto readOp = dyn_cast<StateReadOp>(op)) {
+      known = addRange(accesses.reads, readOp.getState(),
+                       readOp.getState().getType().getByteWidth());
+    } else if (auto writeOp = dyn_cast<StateWriteOp>(op)) {
+      known = addRange(accesses.writes, writeOp.getState(),
+                       writeOp.getState().getType().getByteWidth());
+    } else if (auto readOp = dyn_cast<MemoryReadOp>(op)) {
+      known = addRange(accesses.reads, readOp.getMemory(),
+                       memorySize(readOp.getMemory()));
+    } else if (auto writeOp = dyn_cast<MemoryWriteOp>(op)) {
+      known = addRange(accesses.writes, writeOp.getMemory(),
+                       memorySize(writeOp.getMemory()));
+    } else if (!isa<AllocStateOp, AllocMemoryOp, AllocStorageOp, RootInputOp,
+                    RootOutputOp>(op)) {
+      // Any other use of the storage, for example passing it on to another
+      // function, is beyond what we can track.
+      known = llvm::none_of(op->getOperandTypes(), [](Type type) {
+        return isa<StorageType, StateType, MemoryType>(type);
+      });
+    }
+    return known ? WalkResult::advance() : WalkResult::interrupt();
+  });
+
+  accesses.unknown = result.wasInterrupted();
+  accesses.canonicalize();
+  return accesses;
+}
+
+//===----------------------------------------------------------------------===//
+// Pass Implementation
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A call to a clock or passthrough function in the model body, optionally
+/// guarded by the `scf.if` created by `arc-lower-clocks-to-funcs`.
+struct Task {
+  Operation *op;
+  func::CallOp callOp;
+  Value enable;
+};
+
+struct ParallelizeClocksPass
+    : public arc::impl::ParallelizeClocksBase<ParallelizeClocksPass> {
+  void runOnOperation() override;
+  void parallelizeModel(ModelOp modelOp);
+  void parallelizeRun(ModelOp modelOp, ArrayRef<Task> run);
+  func::FuncOp createDispatchFunc(ModelOp modelOp,
+                                  ArrayRef<const Task *> tasks);
+
+  SymbolTable *symbolTable;
+};
+} // namespace
+
+/// Check whether an op in the model body is a call to a clock function that
+/// takes nothing but the model storage, optionally guarded by an enable.
+static std::optional<Task> matchTask(Operation *op, Value storage) {
+  auto isTaskCall = [&](func::CallOp callOp) {
+    return callOp.getNumResults() == 0 && callOp.getNumOperands() == 1 &&
+           callOp.getOperand(0) == storage;
+  };
+  if (auto callOp = dyn_cast<func::CallOp>(op)) {
+    if (isTaskCall(callOp))
+      return Task{op, callOp, {}};
+    return {};
+  }
+  auto ifOp = dyn_cast<scf::IfOp>(op);
+  if (!ifOp || ifOp.getNumResults() != 0 || !ifOp.getElseRegion().empty())
+    return {};
+  auto bodyOps = ifOp.thenBlock()->without_terminator();
+  if (!llvm::hasSingleElement(bodyOps))
+    return {};
+  auto callOp = dyn_cast<func::CallOp>(&*bodyOps.begin());
+  if (!callOp || !isTaskCall(callOp))
+    return {};
+  return Task{op, callOp, ifOp.getCondition()};
+}
+
+void ParallelizeClocksPass::runOnOperation() {
+  symbolTable = &getAnalysis<SymbolTable>();
+  for (auto modelOp : getOperation().getOps<ModelOp>())
+    parallelizeModel(modelOp);
+}
+
+void ParallelizeClocksPass::parallelizeModel(ModelOp modelOp) {
+  LLVM_DEBUG(llvm::dbgs() << "Parallelizing clocks in `" << modelOp.getName()
+                          << "`\n");
+
+  // Only consecutive clock calls are considered for reordering. Anything in
+  // between may observe the state the calls modify.
+  Value storage = modelOp.getBody().getArgument(0);
+  SmallVector<Task> run;
+  for (auto &op : llvm::make_early_inc_range(modelOp.getBodyBlock())) {
+    if (auto task = matchTask(&op, storage)) {
+      run.push_back(*task);
+      continue;
+    }
+    parallelizeRun(modelOp, run);
+    run.clear();
+  }
+  parallelizeRun(modelOp, run);
+}
+
+void ParallelizeClocksPass::parallelizeRun(ModelOp modelOp,
+                                           ArrayRef<Task> run) {
+  if (run.size() < 2)
+    return;
+
+  // Determine the state each call accesses.
+  SmallVector<StateAccesses> accesses;
+  for (auto &task : run)
+    accesses.push_back(computeStateAccesses(
+        symbolTable->lookup<func::FuncOp>(task.callOp.getCallee())));
+
+  // Assign each call to the earliest phase that comes after all earlier calls
+  // it conflicts with. This preserves the order of all conflicting calls.
+  SmallVector<unsigned> phases(run.size(), 0);
+  unsigned numPhases = 0;
+  for (unsigned i = 0; i < run.size(); ++i) {
+    for (unsigned j = 0; j < i; ++j)
+      if (accesses[i].conflictsWith(accesses[j]))
+        phases[i] = std::max(phases[i], phases[j] + 1);
+    numPhases = std::max(numPhases, phases[i] + 1);
+  }
+  LLVM_DEBUG(llvm::dbgs() << "- Scheduled " << run.size() << " calls into "
+                          << numPhases << " phases\n");
+  if (numPhases == run.size())
+    return;
+
+  // Materialize the phases in order after the last call of the run.
+  OpBuilder builder(modelOp);
+  builder.setInsertionPointAfter(run.back().op);
+  SmallVector<Operation *> replacedOps;
+  for (unsigned phase = 0; phase < numPhases; ++phase) {
+    SmallVector<const Task *> tasks;
+    for (auto [task, taskPhase] : llvm::zip(run, phases))
+      if (taskPhase == phase)
+        tasks.push_back(&task);
+
+    for (unsigned begin = 0; begin < tasks.size();
+         begin += maxTasksPerDispatch) {
+      auto chunk = ArrayRef<const Task *>(tasks).slice(
+          begin, std::min<size_t>(maxTasksPerDispatch, tasks.size() - begin));
+
+      // A phase with a single call simply stays a regular call.
+      if (chunk.size() == 1) {
+        chunk[0]->op->moveBefore(builder.getInsertionBlock(),
+                                 builder.getInsertionPoint());
+        continue;
+      }
+
+      auto funcOp = createDispatchFunc(modelOp, chunk);
+      SmallVector<Value> enables;
+      for (auto *task : chunk) {
+        Value enable = task->enable;
+        if (!enable)
+          enable = builder.create<hw::ConstantOp>(task->op->getLoc(),
+                                                  builder.getI1Type(), 1);
+        enables.push_back(enable);
+        replacedOps.push_back(task->op);
+      }
+      builder.create<ParallelDispatchOp>(
+          chunk[0]->op->getLoc(),
+          FlatSymbolRefAttr::get(funcOp.getSymNameAttr()), storage, enables);
+      numTasksDispatched += chunk.size();
+      ++numDispatchesCreated;
+    }
+  }
+
+  for (auto *op : replacedOps)
+    op->erase();
+}
+
+/// Create a function that takes the model storage and a task index and calls
+/// the clock function of the corresponding task.
+func::FuncOp
+ParallelizeClocksPass::createDispatchFunc(ModelOp modelOp,
+                                          ArrayRef<const Task *> tasks) {
+  auto loc = tasks[0]->op->getLoc();
+  Value storage = modelOp.getBody().getArgument(0);
+
+  OpBuilder funcBuilder(modelOp);
+  SmallString<32> funcName;
+  funcName.append(modelOp.getName());
+  funcName.append("_parallel");
+  auto funcOp = funcBuilder.create<func::FuncOp>(
+      loc, funcName,
+      funcBuilder.getFunctionType(
+          {storage.getType(), funcBuilder.getI32Type()}, {}));
+  symbolTable->insert(funcOp); // uniquifies the name
+  funcOp->setAttr("llvm.linkage",
+                  LLVM::LinkageAttr::get(&getContext(),
+                                         LLVM::linkage::Linkage::Internal));
+  LLVM_DEBUG(llvm::dbgs() << "  - Created function `" << funcOp.getSymName()
+                          << "` for " << tasks.size() << " tasks\n");
+
+  auto *block = funcOp.addEntryBlock();
+  auto builder = OpBuilder::atBlockEnd(block);
+  for (auto [index, task] : llvm::enumerate(tasks)) {
+    auto taskIndex =
+        builder.create<hw::ConstantOp>(loc, builder.getI32Type(), index);
+    auto isTask = builder.create<comb::ICmpOp>(
+        loc, comb::ICmpPredicate::eq, block->getArgument(1), taskIndex);
+    auto ifOp = builder.create<scf::IfOp>(loc, isTask, false);
+    auto thenBuilder = ifOp.getThenBodyBuilder();
+    thenBuilder.create<func::CallOp>(loc, task->callOp.getCalleeAttr(),
+                                     TypeRange{},
+                                     ValueRange{block->getArgument(0)});
+  }
+  builder.create<func::ReturnOp>(loc);
+  return funcOp;
+}
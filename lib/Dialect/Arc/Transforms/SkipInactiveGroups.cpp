@@ -0,0 +1,222 @@
+//===- SkipInactiveGroups.cpp ---------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Arc/ArcOps.h"
+#include "circt/Dialect/Arc/ArcPasses.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/ImplicitLocOpBuilder.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "arc-skip-inactive-groups"
+
+namespace circt {
+namespace arc {
+#define GEN_PASS_DEF_SKIPINACTIVEGROUPS
+#include "circt/Dialect/Arc/ArcPasses.h.inc"
+} // namespace arc
+} // namespace circt
+
+using namespace mlir;
+using namespace circt;
+using namespace arc;
+
+//===----------------------------------------------------------------------===//
+// Pass Implementation
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The states read and written by a clock tree or passthrough.
+struct GroupAccesses {
+  SmallSetVector<Value, 8> reads;
+  SmallSetVector<Value, 8> writes;
+  unsigned numOps = 0;
+};
+
+struct SkipInactiveGroupsPass
+    : public arc::impl::SkipInactiveGroupsBase<SkipInactiveGroupsPass> {
+  using SkipInactiveGroupsBase::SkipInactiveGroupsBase;
+  void runOnOperation() override;
+  void runOnModel(ModelOp modelOp);
+  void guardGroup(Operation *groupOp, const GroupAccesses &accesses,
+                  Value storage, unsigned index);
+};
+} // namespace
+
+/// Collect the states accessed by a group. Fails if the group has any side
+/// effect other than reading and writing integer states, in which case it
+/// cannot be skipped based on its inputs alone.
+static LogicalResult collectAccesses(Operation *groupOp,
+                                     GroupAccesses &accesses) {
+  auto result = groupOp->walk([&](Operation *op) {
+    if (op == groupOp)
+      return WalkResult::advance();
+    ++accesses.numOps;
+    if (auto readOp = dyn_cast<StateReadOp>(op)) {
+      if (!isa<IntegerType>(readOp.getType()))
+        return WalkResult::interrupt();
+      accesses.reads.insert(readOp.getState());
+      return WalkResult::advance();
+    }
+    if (auto writeOp = dyn_cast<StateWriteOp>(op)) {
+      accesses.writes.insert(writeOp.getState());
+      return WalkResult::advance();
+    }
+    if (op->hasTrait<OpTrait::HasRecursiveMemoryEffects>() ||
+        isMemoryEffectFree(op))
+      return WalkResult::advance();
+    return WalkResult::interrupt();
+  });
+  return failure(result.wasInterrupted());
+}
+
+void SkipInactiveGroupsPass::runOnOperation() {
+  for (auto modelOp : getOperation().getOps<ModelOp>())
+    runOnModel(modelOp);
+}
+
+void SkipInactiveGroupsPass::runOnModel(ModelOp modelOp) {
+  LLVM_DEBUG(llvm::dbgs() << "Guarding groups in `" << modelOp.getName()
+                          << "`\n");
+
+  // Determine which group writes each state. States written by more than one
+  // group, or by the model itself, may change without the group noticing.
+  DenseMap<Value, Operation *> writers;
+  DenseSet<Value> sharedStates;
+  modelOp.walk([&](StateWriteOp writeOp) {
+    Operation *writer = writeOp->getParentOp();
+    while (!isa<ClockTreeOp, PassThroughOp, ModelOp>(writer))
+      writer = writer->getParentOp();
+    auto [it, inserted] = writers.insert({writeOp.getState(), writer});
+    if (!inserted && it->second != writer)
+      sharedStates.insert(writeOp.getState());
+  });
+
+  SmallVector<Operation *> groups;
+  for (auto &op : modelOp.getBodyBlock())
+    if (isa<ClockTreeOp, PassThroughOp>(&op))
+      groups.push_back(&op);
+
+  Value storage = modelOp.getBodyBlock().getArgument(0);
+  unsigned index = 0;
+  for (auto *groupOp : groups) {
+    GroupAccesses accesses;
+    if (failed(collectAccesses(groupOp, accesses)) ||
+        llvm::any_of(accesses.writes, [&](Value state) {
+          return sharedStates.contains(state);
+        })) {
+      ++numGroupsIneligible;
+      continue;
+    }
+    if (accesses.numOps < minOpsPerRead * accesses.reads.size()) {
+      ++numGroupsTooSmall;
+      continue;
+    }
+    guardGroup(groupOp, accesses, storage, index++);
+    ++numGroupsGuarded;
+  }
+}
+
+/// Allocate shadow states for the reads of a group and only evaluate the group
+/// if one of them differs from its shadow. A `valid` flag forces the first
+/// evaluation, since the shadows are zero-initialized just like the states.
+void SkipInactiveGroupsPass::guardGroup(Operation *groupOp,
+                                        const GroupAccesses &accesses,
+                                        Value storage, unsigned index) {
+  LLVM_DEBUG(llvm::dbgs() << "- Guarding " << groupOp->getName() << " with "
+                          << accesses.reads.size() << " reads\n");
+  ImplicitLocOpBuilder builder(groupOp->getLoc(), groupOp);
+  auto i1Type = builder.getI1Type();
+  auto validState =
+      builder.create<AllocStateOp>(StateType::get(i1Type), storage, nullptr);
+  SmallVector<std::pair<Value, Value>> shadows;
+  for (auto state : accesses.reads) {
+    auto shadow = builder.create<AllocStateOp>(
+        cast<StateType>(state.getType()), storage, nullptr);
+    shadows.push_back({state, shadow});
+  }
+  AllocStateOp counterState;
+  if (skipCounters) {
+    counterState = builder.create<AllocStateOp>(
+        StateType::get(builder.getI64Type()), storage, nullptr);
+    counterState->setAttr(
+        "name", builder.getStringAttr("arc_skip_count_" + Twine(index)));
+  }
+
+  // Compare the current values against the shadows.
+  auto buildChanged = [&]() -> Value {
+    Value valid = builder.create<StateReadOp>(validState);
+    Value changed = builder.create<comb::XorOp>(
+        valid, builder.create<hw::ConstantOp>(i1Type, 1));
+    for (auto [state, shadow] : shadows) {
+      Value current = builder.create<StateReadOp>(state);
+      Value previous = builder.create<StateReadOp>(shadow);
+      changed = builder.create<comb::OrOp>(
+          changed, builder.create<comb::ICmpOp>(comb::ICmpPredicate::ne,
+                                                current, previous));
+    }
+    return changed;
+  };
+
+  // Capture the current values in the shadows at the start of an evaluation.
+  auto buildShadowUpdates = [&]() {
+    builder.create<StateWriteOp>(
+        validState, builder.create<hw::ConstantOp>(i1Type, 1), Value{});
+    for (auto [state, shadow] : shadows)
+      builder.create<StateWriteOp>(shadow, builder.create<StateReadOp>(state),
+                                   Value{});
+  };
+
+  auto buildCounterIncrement = [&]() {
+    Value count = builder.create<StateReadOp>(counterState);
+    Value one = builder.create<hw::ConstantOp>(builder.getI64Type(), 1);
+    builder.create<StateWriteOp>(
+        counterState, builder.create<comb::AddOp>(count, one), Value{});
+  };
+
+  // Clock trees only run on a clock edge, so fold the check into their clock.
+  // Skipped edges are counted in a separate clock tree.
+  if (auto clockTreeOp = dyn_cast<ClockTreeOp>(groupOp)) {
+    Value clock = clockTreeOp.getClock();
+    Value changed = buildChanged();
+    clockTreeOp.getClockMutable().assign(
+        builder.create<comb::AndOp>(clock, changed));
+    builder.setInsertionPointToStart(&clockTreeOp.getBodyBlock());
+    buildShadowUpdates();
+    if (counterState) {
+      builder.setInsertionPointAfter(clockTreeOp);
+      Value unchanged = builder.create<comb::XorOp>(
+          changed, builder.create<hw::ConstantOp>(i1Type, 1));
+      auto counterTreeOp = builder.create<ClockTreeOp>(
+          builder.create<comb::AndOp>(clock, unchanged));
+      builder.setInsertionPointToStart(
+          &counterTreeOp.getBody().emplaceBlock());
+      buildCounterIncrement();
+    }
+    return;
+  }
+
+  // Passthroughs run every time, so wrap their body in the check.
+  auto passThroughOp = cast<PassThroughOp>(groupOp);
+  Block &body = passThroughOp.getBodyBlock();
+  builder.setInsertionPointToStart(&body);
+  Value changed = buildChanged();
+  auto ifOp = builder.create<scf::IfOp>(changed, bool(counterState));
+  ifOp.thenBlock()->getOperations().splice(
+      ifOp.thenBlock()->begin(), body.getOperations(),
+      std::next(ifOp->getIterator()), body.end());
+  builder.setInsertionPointToStart(ifOp.thenBlock());
+  buildShadowUpdates();
+  if (counterState) {
+    builder.setInsertionPointToStart(ifOp.elseBlock());
+    buildCounterIncrement();
+  }
+}
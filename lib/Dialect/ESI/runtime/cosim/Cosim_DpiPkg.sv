@@ -74,6 +74,32 @@ import "DPI-C" sv2cCosimserverEpTryGet =
     inout int unsigned data_size
     );
 
+// Resolve the handle of a registered endpoint. Polling by handle avoids looking
+// up the endpoint ID on every call.
+// - return the non-negative handle on success, negative on failure
+//   (unregistered EP).
+import "DPI-C" sv2cCosimserverEpGetHandle =
+  function int cosim_ep_get_handle(
+    // The endpoint ID.
+    input string endpoint_id
+    );
+
+// Same as cosim_ep_tryput, with the endpoint given by handle.
+import "DPI-C" sv2cCosimserverEpTryPutByHandle =
+  function int cosim_ep_tryput_handle(
+    input int handle,
+    input byte unsigned data[],
+    input int data_size = -1
+    );
+
+// Same as cosim_ep_tryget, with the endpoint given by handle.
+import "DPI-C" sv2cCosimserverEpTryGetByHandle =
+  function int cosim_ep_tryget_handle(
+    input int handle,
+    inout byte unsigned data[],
+    inout int unsigned data_size
+    );
+
 // --------------------- Manifest ----------------------------------------------
 
 import "DPI-C" sv2cCosimserverSetManifest =
@@ -29,6 +29,9 @@ module Cosim_Endpoint_ToHost
   input  logic [TO_HOST_SIZE_BITS-1:0] DataIn
 );
 
+  // The endpoint handle, resolved once after registration.
+  int handle;
+
   initial begin
     int rc;
     rc = cosim_init();
@@ -38,6 +41,10 @@ module Cosim_Endpoint_ToHost
                             TO_HOST_TYPE_ID, TO_HOST_SIZE_BYTES);
     if (rc != 0)
       $error("Cosim endpoint (%d) register failed: %d", ENDPOINT_ID, rc);
+    handle = cosim_ep_get_handle(ENDPOINT_ID);
+    if (handle < 0)
+      $error("Cosim endpoint (%d) handle lookup failed: %d", ENDPOINT_ID,
+             handle);
   end
 
   /// **********************
@@ -58,7 +65,7 @@ module Cosim_Endpoint_ToHost
     if (~rst) begin
       if (DataInValid) begin
         int rc;
-        rc = cosim_ep_tryput(ENDPOINT_ID, DataInBuffer, TO_HOST_SIZE_BYTES);
+        rc = cosim_ep_tryput_handle(handle, DataInBuffer, TO_HOST_SIZE_BYTES);
         if (rc != 0)
           $error("cosim_ep_tryput(%d, *, %d) = %d Error! (Data lost)",
             ENDPOINT_ID, TO_HOST_SIZE_BYTES, rc);
@@ -106,6 +113,9 @@ module Cosim_Endpoint_FromHost
   output logic [FROM_HOST_SIZE_BITS-1:0] DataOut
 );
 
+  // The endpoint handle, resolved once after registration.
+  int handle;
+
   // Handle initialization logic.
   initial begin
     int rc;
@@ -116,6 +126,10 @@ module Cosim_Endpoint_FromHost
                             "", 0);
     if (rc != 0)
       $error("Cosim endpoint (%d) register failed: %d", ENDPOINT_ID, rc);
+    handle = cosim_ep_get_handle(ENDPOINT_ID);
+    if (handle < 0)
+      $error("Cosim endpoint (%d) handle lookup failed: %d", ENDPOINT_ID,
+             handle);
   end
 
   /// *******************
@@ -140,7 +154,7 @@ module Cosim_Endpoint_FromHost
         int rc;
 
         data_limit = FROM_HOST_SIZE_BYTES;
-        rc = cosim_ep_tryget(ENDPOINT_ID, DataOutBuffer, data_limit);
+        rc = cosim_ep_tryget_handle(handle, DataOutBuffer, data_limit);
         if (rc < 0) begin
           $error("cosim_ep_tryget(%d, *, %d -> %d) returned an error (%d)",
             ENDPOINT_ID, FROM_HOST_SIZE_BYTES, data_limit, rc);
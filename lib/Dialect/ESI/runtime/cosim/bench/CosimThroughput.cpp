@@ -0,0 +1,178 @@
+//===- CosimThroughput.cpp - Cosim RPC throughput benchmark ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measure the message throughput of the cosim RPC layer. An RPC server and
+// client run in the same process, connected over a local socket. A stand-in
+// for the simulator loops every message it receives on the server endpoint
+// straight back to the host, so the measurement covers a round trip through
+// both RPC threads without any simulation cost.
+//
+// With --latency, messages are sent one at a time instead and the round trip
+// of each is timed twice: once with the reader sleep-polling the endpoint like
+// the original ReadChannelPort::readAsync did, and once with the reader woken
+// by the endpoint's client notifier.
+//
+// Usage: esi-cosim-throughput [--latency] [messages] [message size] [port]
+//
+//===----------------------------------------------------------------------===//
+
+#include "cosim/CapnpThreads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace esi;
+using namespace esi::cosim;
+
+using Clock = std::chrono::steady_clock;
+
+/// Stream `numMessages` messages through the loopback and report the rate.
+static void measureThroughput(Endpoint *ep, size_t numMessages,
+                              const std::vector<uint8_t> &payload) {
+  auto start = Clock::now();
+  std::thread writer([&] {
+    for (size_t i = 0; i < numMessages; ++i)
+      ep->pushMessageToSim(
+          std::make_unique<MessageData>(payload.data(), payload.size()));
+  });
+  size_t numReceived = 0;
+  Endpoint::MessageDataPtr msg;
+  while (numReceived < numMessages) {
+    if (ep->getMessageToClient(msg))
+      ++numReceived;
+    else
+      std::this_thread::yield();
+  }
+  auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  writer.join();
+
+  printf("%zu messages of %zu bytes in %.3f s: %.0f messages/s, %.2f MB/s\n",
+         numMessages, payload.size(), seconds, numMessages / seconds,
+         numMessages * payload.size() / seconds / (1024 * 1024));
+}
+
+/// Send `numMessages` messages one at a time and report the distribution of
+/// their round trip times. `waitForMessage` is called whenever the reader
+/// finds the endpoint empty.
+template <typename WaitFn>
+static void measureLatency(const char *name, Endpoint *ep, size_t numMessages,
+                           const std::vector<uint8_t> &payload,
+                           WaitFn waitForMessage) {
+  std::vector<double> micros;
+  micros.reserve(numMessages);
+  Endpoint::MessageDataPtr msg;
+  for (size_t i = 0; i < numMessages; ++i) {
+    auto start = Clock::now();
+    ep->pushMessageToSim(
+        std::make_unique<MessageData>(payload.data(), payload.size()));
+    while (!ep->getMessageToClient(msg))
+      waitForMessage();
+    micros.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+  }
+
+  std::sort(micros.begin(), micros.end());
+  auto percentile = [&](double p) {
+    return micros[std::min(micros.size() - 1, size_t(p * micros.size()))];
+  };
+  printf("%s: %zu round trips of %zu bytes: median %.1f us, p99 %.1f us, "
+         "max %.1f us\n",
+         name, numMessages, payload.size(), percentile(0.5), percentile(0.99),
+         micros.back());
+}
+
+int main(int argc, const char *argv[]) {
+  bool latency = argc > 1 && std::strcmp(argv[1], "--latency") == 0;
+  if (latency) {
+    --argc;
+    ++argv;
+  }
+  size_t numMessages =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : latency ? 2000 : 100000;
+  size_t messageSize = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+  uint16_t port = argc > 3 ? std::atoi(argv[3]) : 53012;
+  if (numMessages == 0 || messageSize == 0) {
+    fprintf(stderr, "usage: %s [--latency] [messages] [message size] [port]\n",
+            argv[0]);
+    return 1;
+  }
+
+  RpcServer server;
+  server.setManifest(0, {});
+  server.registerEndpoint("loopback", "bench", "bench");
+  server.run(port);
+  // The server does not report when it starts listening.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // Stand in for the simulator, which polls the endpoint every cycle.
+  std::atomic<bool> stopSim = false;
+  std::thread sim([&] {
+    Endpoint *ep = server.getEndpoint("loopback");
+    Endpoint::MessageDataPtr msg;
+    while (!stopSim.load(std::memory_order_relaxed)) {
+      if (ep->getMessageToSim(msg))
+        ep->pushMessageToClient(std::move(msg));
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  RpcClient client;
+  client.run("localhost", port);
+  Endpoint *ep = client.getEndpoint("loopback");
+  if (!ep || !ep->setInUse()) {
+    fprintf(stderr, "could not open the loopback endpoint\n");
+    return 1;
+  }
+
+  std::vector<uint8_t> payload(messageSize, 0x5a);
+  if (!latency) {
+    measureThroughput(ep, numMessages, payload);
+  } else {
+    // The interval ReadChannelPort::readAsync used to sleep between reads.
+    measureLatency("poll", ep, numMessages, payload, [] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+
+    // Wait the way ReadChannelPort::readAsync does now: the notifier bumps a
+    // counter, which tells the reader whether it missed a notification
+    // between its failed read and starting to wait.
+    std::mutex notifyMutex;
+    std::condition_variable notifyCv;
+    uint64_t notifications = 0, seen = 0;
+    ep->setClientNotifier([&] {
+      {
+        std::lock_guard<std::mutex> lock(notifyMutex);
+        ++notifications;
+      }
+      notifyCv.notify_all();
+    });
+    measureLatency("notify", ep, numMessages, payload, [&] {
+      std::unique_lock<std::mutex> lock(notifyMutex);
+      notifyCv.wait(lock, [&] { return notifications != seen; });
+      seen = notifications;
+    });
+    ep->setClientNotifier({});
+  }
+
+  ep->returnForUse();
+  client.stop();
+  stopSim = true;
+  sim.join();
+  server.stop();
+  return 0;
+}
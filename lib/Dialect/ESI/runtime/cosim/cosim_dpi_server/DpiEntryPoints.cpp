@@ -22,6 +22,9 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
 
 using namespace esi::cosim;
 
@@ -30,10 +33,15 @@ static FILE *logFile;
 static RpcServer *server = nullptr;
 static std::mutex serverMutex;
 
+/// Endpoints resolved by `sv2cCosimserverEpGetHandle`, indexed by handle. Only
+/// accessed from the simulator thread, such that the per-tick DPI calls need
+/// neither a lock nor a string lookup.
+static std::vector<std::pair<std::string, Endpoint *>> endpointHandles;
+
 // ---- Helper functions ----
 
 /// Emit the contents of 'msg' to the log file in hex.
-static void log(char *epId, bool toClient,
+static void log(const char *epId, bool toClient,
                 const Endpoint::MessageDataPtr &msg) {
   std::lock_guard<std::mutex> g(serverMutex);
   if (!logFile)
@@ -99,40 +107,24 @@ static int validateSvOpenArray(const svOpenArrayHandle data,
   return 0;
 }
 
-// ---- Traditional cosim DPI entry points ----
-
-// Register simulated device endpoints.
-// - return 0 on success, non-zero on failure (duplicate EP registered).
-DPI int sv2cCosimserverEpRegister(char *endpointId, char *fromHostTypeId,
-                                  int fromHostTypeSize, char *toHostTypeId,
-                                  int toHostTypeSize) {
-  // Ensure the server has been constructed.
-  sv2cCosimserverInit();
-  // Then register with it.
-  if (server->registerEndpoint(endpointId, fromHostTypeId, toHostTypeId))
-    return 0;
-  return -1;
+/// Get a pointer to the bytes of a validated array if element `i` lives at
+/// offset `i`, such that it can be copied in one go. Simulators are free to lay
+/// out descending arrays the other way around, in which case this returns null.
+// NOLINTNEXTLINE(misc-misplaced-const)
+static uint8_t *getContiguousBytes(const svOpenArrayHandle data) {
+  auto *base = static_cast<uint8_t *>(svGetArrayPtr(data));
+  if (static_cast<uint8_t *>(svGetArrElemPtr1(data, 0)) != base)
+    return nullptr;
+  if (svSizeOfArray(data) > 1 &&
+      static_cast<uint8_t *>(svGetArrElemPtr1(data, 1)) != base + 1)
+    return nullptr;
+  return base;
 }
 
-// Attempt to recieve data from a client.
-//   - Returns negative when call failed (e.g. EP not registered).
-//   - If no message, return 0 with dataSize == 0.
-//   - Assumes buffer is large enough to contain entire message. Fails if not
-//     large enough. (In the future, will add support for getting the message
-//     into a fixed-size buffer over multiple calls.)
-DPI int sv2cCosimserverEpTryGet(char *endpointId,
-                                // NOLINTNEXTLINE(misc-misplaced-const)
-                                const svOpenArrayHandle data,
-                                unsigned int *dataSize) {
-  if (server == nullptr)
-    return -1;
-
-  Endpoint *ep = server->getEndpoint(endpointId);
-  if (!ep) {
-    fprintf(stderr, "Endpoint not found in registry!\n");
-    return -4;
-  }
-
+/// Poll an endpoint for a message to the simulation and copy it into 'data'.
+static int tryGet(Endpoint *ep, const char *endpointId,
+                  // NOLINTNEXTLINE(misc-misplaced-const)
+                  const svOpenArrayHandle data, unsigned int *dataSize) {
   Endpoint::MessageDataPtr msg;
   // Poll for a message.
   if (!ep->getMessageToSim(msg)) {
@@ -167,32 +159,28 @@ DPI int sv2cCosimserverEpTryGet(char *endpointId,
     return -5;
   }
 
-  // Copy the message data.
-  size_t i;
+  // Copy the message data and zero out the rest of the buffer.
   auto bytes = msg->getBytes();
-  for (i = 0; i < msgSize; ++i) {
-    auto b = bytes[i];
-    *(char *)svGetArrElemPtr1(data, i) = b;
-  }
-  // Zero out the rest of the buffer.
-  for (; i < *dataSize; ++i) {
-    *(char *)svGetArrElemPtr1(data, i) = 0;
+  if (uint8_t *buffer = getContiguousBytes(data)) {
+    if (msgSize)
+      std::memcpy(buffer, bytes, msgSize);
+    std::memset(buffer + msgSize, 0, *dataSize - msgSize);
+  } else {
+    size_t i;
+    for (i = 0; i < msgSize; ++i)
+      *(char *)svGetArrElemPtr1(data, i) = bytes[i];
+    for (; i < *dataSize; ++i)
+      *(char *)svGetArrElemPtr1(data, i) = 0;
   }
   // Set the output data size.
   *dataSize = msg->getSize();
   return 0;
 }
 
-// Attempt to send data to a client.
-// - return 0 on success, negative on failure (unregistered EP).
-// - if dataSize is negative, attempt to dynamically determine the size of
-//   'data'.
-DPI int sv2cCosimserverEpTryPut(char *endpointId,
-                                // NOLINTNEXTLINE(misc-misplaced-const)
-                                const svOpenArrayHandle data, int dataSize) {
-  if (server == nullptr)
-    return -1;
-
+/// Copy 'data' into a message and queue it to the client.
+static int tryPut(Endpoint *ep, const char *endpointId,
+                  // NOLINTNEXTLINE(misc-misplaced-const)
+                  const svOpenArrayHandle data, int dataSize) {
   if (validateSvOpenArray(data, sizeof(int8_t)) != 0) {
     printf("ERROR: DPI-func=%s line=%d event=invalid-sv-array\n", __func__,
            __LINE__);
@@ -208,22 +196,119 @@ DPI int sv2cCosimserverEpTryPut(char *endpointId,
     return -3;
   }
 
-  // Copy the message data into 'blob'.
-  std::vector<uint8_t> dataVec(dataSize);
-  for (int i = 0; i < dataSize; ++i) {
-    dataVec[i] = *(char *)svGetArrElemPtr1(data, i);
+  // Copy the message data into a pooled 'blob'.
+  Endpoint::MessageDataPtr blob;
+  if (const uint8_t *bytes = getContiguousBytes(data)) {
+    blob = std::make_unique<esi::MessageData>(bytes, dataSize);
+  } else {
+    blob = std::make_unique<esi::MessageData>(
+        esi::MessageData::create(dataSize, [&](uint8_t *bytes) {
+          for (int i = 0; i < dataSize; ++i)
+            bytes[i] = *(char *)svGetArrElemPtr1(data, i);
+        }));
   }
-  Endpoint::MessageDataPtr blob = std::make_unique<esi::MessageData>(dataVec);
 
   // Queue the blob.
+  log(endpointId, true, blob);
+  ep->pushMessageToClient(std::move(blob));
+  return 0;
+}
+
+// ---- Traditional cosim DPI entry points ----
+
+// Register simulated device endpoints.
+// - return 0 on success, non-zero on failure (duplicate EP registered).
+DPI int sv2cCosimserverEpRegister(char *endpointId, char *fromHostTypeId,
+                                  int fromHostTypeSize, char *toHostTypeId,
+                                  int toHostTypeSize) {
+  // Ensure the server has been constructed.
+  sv2cCosimserverInit();
+  // Then register with it.
+  if (server->registerEndpoint(endpointId, fromHostTypeId, toHostTypeId))
+    return 0;
+  return -1;
+}
+
+// Attempt to recieve data from a client.
+//   - Returns negative when call failed (e.g. EP not registered).
+//   - If no message, return 0 with dataSize == 0.
+//   - Assumes buffer is large enough to contain entire message. Fails if not
+//     large enough. (In the future, will add support for getting the message
+//     into a fixed-size buffer over multiple calls.)
+DPI int sv2cCosimserverEpTryGet(char *endpointId,
+                                // NOLINTNEXTLINE(misc-misplaced-const)
+                                const svOpenArrayHandle data,
+                                unsigned int *dataSize) {
+  if (server == nullptr)
+    return -1;
+
   Endpoint *ep = server->getEndpoint(endpointId);
   if (!ep) {
     fprintf(stderr, "Endpoint not found in registry!\n");
     return -4;
   }
-  log(endpointId, true, blob);
-  ep->pushMessageToClient(std::move(blob));
-  return 0;
+  return tryGet(ep, endpointId, data, dataSize);
+}
+
+// Attempt to send data to a client.
+// - return 0 on success, negative on failure (unregistered EP).
+// - if dataSize is negative, attempt to dynamically determine the size of
+//   'data'.
+DPI int sv2cCosimserverEpTryPut(char *endpointId,
+                                // NOLINTNEXTLINE(misc-misplaced-const)
+                                const svOpenArrayHandle data, int dataSize) {
+  if (server == nullptr)
+    return -1;
+
+  Endpoint *ep = server->getEndpoint(endpointId);
+  if (!ep) {
+    fprintf(stderr, "Endpoint not found in registry!\n");
+    return -4;
+  }
+  return tryPut(ep, endpointId, data, dataSize);
+}
+
+// Resolve the handle of a registered endpoint once, such that the per-tick
+// calls below can skip the registry lookup.
+// - return the non-negative handle on success, negative on failure
+//   (unregistered EP).
+DPI int sv2cCosimserverEpGetHandle(char *endpointId) {
+  if (server == nullptr)
+    return -1;
+
+  Endpoint *ep = server->getEndpoint(endpointId);
+  if (!ep) {
+    fprintf(stderr, "Endpoint not found in registry!\n");
+    return -4;
+  }
+  endpointHandles.emplace_back(endpointId, ep);
+  return endpointHandles.size() - 1;
+}
+
+// Same as `sv2cCosimserverEpTryGet`, with the endpoint given by handle.
+DPI int sv2cCosimserverEpTryGetByHandle(int handle,
+                                        // NOLINTNEXTLINE(misc-misplaced-const)
+                                        const svOpenArrayHandle data,
+                                        unsigned int *dataSize) {
+  if (server == nullptr)
+    return -1;
+  if (handle < 0 || (size_t)handle >= endpointHandles.size())
+    return -4;
+  auto &[endpointId, ep] = endpointHandles[handle];
+  return tryGet(ep, endpointId.c_str(), data, dataSize);
+}
+
+// Same as `sv2cCosimserverEpTryPut`, with the endpoint given by handle.
+DPI int sv2cCosimserverEpTryPutByHandle(int handle,
+                                        // NOLINTNEXTLINE(misc-misplaced-const)
+                                        const svOpenArrayHandle data,
+                                        int dataSize) {
+  if (server == nullptr)
+    return -1;
+  if (handle < 0 || (size_t)handle >= endpointHandles.size())
+    return -4;
+  auto &[endpointId, ep] = endpointHandles[handle];
+  return tryPut(ep, endpointId.c_str(), data, dataSize);
 }
 
 // Teardown cosimserver (disconnects from primary server port, stops connections
@@ -234,6 +319,7 @@ DPI void sv2cCosimserverFinish() {
   if (server != nullptr) {
     server->stop();
     server = nullptr;
+    endpointHandles.clear();
 
     fclose(logFile);
     logFile = nullptr;
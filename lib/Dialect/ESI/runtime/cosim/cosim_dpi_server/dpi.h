@@ -40,6 +40,20 @@ DPI int sv2cCosimserverEpTryPut(char *endpointId,
                                 // NOLINTNEXTLINE(misc-misplaced-const)
                                 const svOpenArrayHandle data, int dataLimit);
 
+/// Resolve the handle of a registered endpoint. Returns a negative value if the
+/// endpoint does not exist.
+DPI int sv2cCosimserverEpGetHandle(char *endpointId);
+/// Try to get a message from a client, addressing the endpoint by handle.
+DPI int sv2cCosimserverEpTryGetByHandle(int handle,
+                                        // NOLINTNEXTLINE(misc-misplaced-const)
+                                        const svOpenArrayHandle data,
+                                        unsigned int *sizeBytes);
+/// Send a message to a client, addressing the endpoint by handle.
+DPI int sv2cCosimserverEpTryPutByHandle(int handle,
+                                        // NOLINTNEXTLINE(misc-misplaced-const)
+                                        const svOpenArrayHandle data,
+                                        int dataLimit);
+
 /// Start the server. Not required as the first endpoint registration will do
 /// this. Provided if one wants to start the server early.
 DPI int sv2cCosimserverInit();
@@ -13,20 +13,26 @@
 #ifndef COSIM_ENDPOINT_H
 #define COSIM_ENDPOINT_H
 
+#include "cosim/Utils.h"
 #include "esi/Common.h"
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 
 namespace esi {
 namespace cosim {
 
 /// Implements a bi-directional, thread-safe bridge between the RPC server and
-/// DPI functions.
+/// DPI functions. Each direction is a single-producer, single-consumer queue.
+/// The simulation side (`getMessageToSim` and `pushMessageToClient`) is driven
+/// by a single thread and does not take a lock in the common case. The host
+/// side (`pushMessageToSim` and `getMessageToClient`) may be called from any
+/// number of threads, which are serialized by a lock per direction before
+/// they reach the queue.
 ///
 /// Several of the methods below are inline with the declaration to make them
 /// candidates for inlining during compilation. This is particularly important
@@ -56,53 +62,58 @@ public:
 
   /// Queue message to the simulation.
   void pushMessageToSim(MessageDataPtr msg) {
-    Lock g(m);
+    std::lock_guard<std::mutex> g(toCosimPushMutex);
     toCosim.push(std::move(msg));
   }
 
   /// Pop from the to-simulator queue. Return true if there was a message in the
   /// queue.
-  bool getMessageToSim(MessageDataPtr &msg) {
-    Lock g(m);
-    if (toCosim.empty())
-      return false;
-    msg = std::move(toCosim.front());
-    toCosim.pop();
-    return true;
-  }
+  bool getMessageToSim(MessageDataPtr &msg) { return toCosim.pop(msg); }
 
   /// Queue message to the RPC client.
   void pushMessageToClient(MessageDataPtr msg) {
-    Lock g(m);
     toClient.push(std::move(msg));
+    if (hasClientNotifier.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> g(notifierMutex);
+      if (clientNotifier)
+        clientNotifier();
+    }
+  }
+
+  /// Set a function to call whenever a message has been queued to the RPC
+  /// client, or clear it by passing an empty function.
+  void setClientNotifier(std::function<void()> notifier) {
+    std::lock_guard<std::mutex> g(notifierMutex);
+    clientNotifier = std::move(notifier);
+    hasClientNotifier.store(bool(clientNotifier), std::memory_order_release);
   }
 
   /// Pop from the to-RPC-client queue. Return true if there was a message in
   /// the queue.
   bool getMessageToClient(MessageDataPtr &msg) {
-    Lock g(m);
-    if (toClient.empty())
-      return false;
-    msg = std::move(toClient.front());
-    toClient.pop();
-    return true;
+    std::lock_guard<std::mutex> g(toClientPopMutex);
+    return toClient.pop(msg);
   }
 
 private:
   const std::string fromHostTypeId;
   const std::string toHostTypeId;
-  bool inUse;
+  std::atomic<bool> inUse;
 
-  using Lock = std::lock_guard<std::mutex>;
-
-  /// This class needs to be thread-safe. All of the mutable member variables
-  /// are protected with this object-wide lock. This may be a performance issue
-  /// in the future.
-  std::mutex m;
   /// Message queue from RPC client to the simulation.
-  std::queue<MessageDataPtr> toCosim;
+  SPSCQueue<MessageDataPtr> toCosim;
   /// Message queue to RPC client from the simulation.
-  std::queue<MessageDataPtr> toClient;
+  SPSCQueue<MessageDataPtr> toClient;
+  /// Serialize the host-side producers of `toCosim` and consumers of
+  /// `toClient`, such that each queue sees a single producer and consumer.
+  std::mutex toCosimPushMutex;
+  std::mutex toClientPopMutex;
+
+  /// Called after a message has been queued to the RPC client. Only set on
+  /// the client side, so the simulator does not take the lock.
+  std::atomic<bool> hasClientNotifier = false;
+  std::mutex notifierMutex;
+  std::function<void()> clientNotifier;
 };
 
 /// The Endpoint registry is where Endpoints report their existence (register)
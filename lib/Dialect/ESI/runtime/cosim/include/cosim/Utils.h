@@ -9,6 +9,10 @@
 #ifndef COSIM_UTILS_H
 #define COSIM_UTILS_H
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -22,14 +26,28 @@ class TSQueue {
   using Lock = std::lock_guard<std::mutex>;
 
   std::mutex m;
+  std::condition_variable cv;
   std::queue<T> q;
 
 public:
   /// Push onto the queue.
   template <typename... E>
   void push(E... t) {
-    Lock l(m);
-    q.emplace(t...);
+    {
+      Lock l(m);
+      q.emplace(t...);
+    }
+    cv.notify_one();
+  }
+
+  /// Pop something off the queue, waiting for something to be pushed if the
+  /// queue is empty.
+  T popWait() {
+    std::unique_lock<std::mutex> l(m);
+    cv.wait(l, [this]() { return !q.empty(); });
+    T t = std::move(q.front());
+    q.pop();
+    return t;
   }
 
   /// Pop something off the queue but return nullopt if the queue is empty. Why
@@ -44,6 +62,82 @@ public:
   }
 };
 
+/// Single-producer, single-consumer queue. At most one thread may push and at
+/// most one thread may pop at any time. Elements pass through a bounded
+/// lock-free ring of preallocated slots, so neither side takes a lock while
+/// the consumer keeps up. Should the ring fill up, the producer spills into a
+/// locked overflow queue instead of dropping or blocking. The consumer only
+/// looks at the overflow once the ring has drained, which preserves FIFO order.
+template <typename T, size_t Capacity = 256>
+class SPSCQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+  using Lock = std::lock_guard<std::mutex>;
+
+public:
+  /// Push onto the queue. Only called by the producer.
+  void push(T t) {
+    if (!spilled.load(std::memory_order_acquire) && tryPushRing(t))
+      return;
+    Lock l(overflowMutex);
+    overflow.push(std::move(t));
+    spilled.store(true, std::memory_order_release);
+  }
+
+  /// Pop something off the queue. Return false if the queue is empty. Only
+  /// called by the consumer.
+  bool pop(T &t) {
+    if (tryPopRing(t))
+      return true;
+    if (!spilled.load(std::memory_order_acquire))
+      return false;
+    // The producer may have filled the ring and spilled since we looked at the
+    // ring. It no longer pushes to the ring once it has spilled, so draining
+    // the ring first keeps the elements in order.
+    if (tryPopRing(t))
+      return true;
+    Lock l(overflowMutex);
+    if (overflow.empty())
+      return false;
+    t = std::move(overflow.front());
+    overflow.pop();
+    if (overflow.empty())
+      spilled.store(false, std::memory_order_release);
+    return true;
+  }
+
+private:
+  bool tryPushRing(T &t) {
+    size_t t0 = tail.load(std::memory_order_relaxed);
+    if (t0 - head.load(std::memory_order_acquire) == Capacity)
+      return false;
+    slots[t0 % Capacity] = std::move(t);
+    tail.store(t0 + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPopRing(T &t) {
+    size_t h0 = head.load(std::memory_order_relaxed);
+    if (h0 == tail.load(std::memory_order_acquire))
+      return false;
+    t = std::move(slots[h0 % Capacity]);
+    head.store(h0 + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::array<T, Capacity> slots;
+  /// Index of the next slot to pop. Only written by the consumer.
+  alignas(64) std::atomic<size_t> head{0};
+  /// Index of the next slot to push. Only written by the producer.
+  alignas(64) std::atomic<size_t> tail{0};
+
+  /// Set while the overflow queue holds elements. The producer bypasses the
+  /// ring until the consumer has drained the overflow.
+  alignas(64) std::atomic<bool> spilled{false};
+  std::mutex overflowMutex;
+  std::queue<T> overflow;
+};
+
 } // namespace cosim
 } // namespace esi
 
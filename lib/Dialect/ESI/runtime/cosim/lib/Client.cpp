@@ -62,6 +62,21 @@ struct esi::cosim::RpcClient::Impl {
           openReq.send().wait(waitScope).getEndpoint();
       endpointMap.emplace(ep, dpiEp);
     }
+
+    // Servers which predate the batch methods respond to them with an
+    // UNIMPLEMENTED exception. Probe once with an empty batch, which has no
+    // effect on the endpoint, and fall back to one request per message.
+    if (!endpointMap.empty()) {
+      auto req = endpointMap.begin()->second.recvToHostBatchRequest();
+      req.setMaxMsgs(0);
+      try {
+        req.send().wait(waitScope);
+      } catch (kj::Exception &e) {
+        if (e.getType() != kj::Exception::Type::UNIMPLEMENTED)
+          throw;
+        batchSupported = false;
+      }
+    }
   }
 
   RpcClient &client;
@@ -70,37 +85,83 @@ struct esi::cosim::RpcClient::Impl {
   EsiLowLevel::Client lowLevel;
   std::map<Endpoint *, EsiDpiEndpoint::Client> endpointMap;
 
+  /// The maximum number of messages moved per endpoint and direction in a
+  /// single poll.
+  static constexpr size_t maxBatchSize = 256;
+  /// Whether the server implements `sendFromHostBatch` and `recvToHostBatch`.
+  bool batchSupported = true;
+
+  void sendToSim(EsiDpiEndpoint::Client &capnpEp, Endpoint *ep);
+  void recvFromSim(EsiDpiEndpoint::Client &capnpEp, Endpoint *ep);
+
   /// Called from the event loop periodically.
   // TODO: try to reduce work in here. Ideally, eliminate polling altogether
   // though I can't figure out how with libkj's event loop.
   void pollInternal();
 };
 
-void esi::cosim::RpcClient::Impl::pollInternal() {
-  // Iterate through the endpoints checking for messages.
-  for (auto &[ep, capnpEp] : endpointMap) {
-    // Process writes to the simulation.
-    Endpoint::MessageDataPtr msg;
-    if (!ep->getSendTypeId().empty() && ep->getMessageToSim(msg)) {
+/// Send the messages queued to the simulation. Everything queued since the
+/// last poll goes out in a single request if the server supports it.
+void esi::cosim::RpcClient::Impl::sendToSim(EsiDpiEndpoint::Client &capnpEp,
+                                            Endpoint *ep) {
+  auto onError = [](kj::Exception &&e) -> void {
+    throw std::runtime_error("Error sending message to simulation: " +
+                             std::string(e.getDescription().cStr()));
+  };
+
+  Endpoint::MessageDataPtr msg;
+  if (!batchSupported) {
+    if (ep->getMessageToSim(msg)) {
       auto req = capnpEp.sendFromHostRequest();
       req.setMsg(capnp::Data::Reader(msg->getBytes(), msg->getSize()));
-      req.send().detach([](kj::Exception &&e) -> void {
-        throw std::runtime_error("Error sending message to simulation: " +
-                                 std::string(e.getDescription().cStr()));
-      });
+      req.send().detach(onError);
     }
+    return;
+  }
 
-    // Process reads from the simulation.
-    // TODO: polling for a response is horribly slow and inefficient. Rework
-    // the capnp protocol to avoid it.
-    if (!ep->getRecvTypeId().empty()) {
-      auto resp = capnpEp.recvToHostRequest().send().wait(waitScope);
-      if (resp.getHasData()) {
-        auto data = resp.getResp();
-        ep->pushMessageToClient(
-            std::make_unique<MessageData>(data.begin(), data.size()));
-      }
+  std::vector<Endpoint::MessageDataPtr> msgs;
+  while (msgs.size() < maxBatchSize && ep->getMessageToSim(msg))
+    msgs.push_back(std::move(msg));
+  if (msgs.empty())
+    return;
+  auto req = capnpEp.sendFromHostBatchRequest();
+  auto reqMsgs = req.initMsgs(msgs.size());
+  for (size_t i = 0, e = msgs.size(); i < e; ++i)
+    reqMsgs.set(i,
+                capnp::Data::Reader(msgs[i]->getBytes(), msgs[i]->getSize()));
+  req.send().detach(onError);
+}
+
+/// Fetch the messages the simulation produced since the last poll.
+// TODO: polling for a response is horribly slow and inefficient. Rework
+// the capnp protocol to avoid it.
+void esi::cosim::RpcClient::Impl::recvFromSim(EsiDpiEndpoint::Client &capnpEp,
+                                              Endpoint *ep) {
+  if (!batchSupported) {
+    auto resp = capnpEp.recvToHostRequest().send().wait(waitScope);
+    if (resp.getHasData()) {
+      auto data = resp.getResp();
+      ep->pushMessageToClient(
+          std::make_unique<MessageData>(data.begin(), data.size()));
     }
+    return;
+  }
+
+  auto req = capnpEp.recvToHostBatchRequest();
+  req.setMaxMsgs(maxBatchSize);
+  auto resp = req.send().wait(waitScope);
+  for (auto data : resp.getResps())
+    ep->pushMessageToClient(
+        std::make_unique<MessageData>(data.begin(), data.size()));
+}
+
+void esi::cosim::RpcClient::Impl::pollInternal() {
+  // Iterate through the endpoints checking for messages.
+  for (auto &[ep, capnpEp] : endpointMap) {
+    if (!ep->getSendTypeId().empty())
+      sendToSim(capnpEp, ep);
+    if (!ep->getRecvTypeId().empty())
+      recvFromSim(capnpEp, ep);
   }
 
   // Process MMIO read requests.
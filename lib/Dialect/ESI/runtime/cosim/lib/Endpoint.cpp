@@ -20,18 +20,13 @@ Endpoint::Endpoint(std::string fromHostTypeId, std::string toHostTypeId)
 Endpoint::~Endpoint() {}
 
 bool Endpoint::setInUse() {
-  Lock g(m);
-  if (inUse)
-    return false;
-  inUse = true;
-  return true;
+  bool expected = false;
+  return inUse.compare_exchange_strong(expected, true);
 }
 
 void Endpoint::returnForUse() {
-  Lock g(m);
-  if (!inUse)
+  if (!inUse.exchange(false))
     fprintf(stderr, "Warning: Returning an endpoint which was not in use.\n");
-  inUse = false;
 }
 
 bool EndpointRegistry::registerEndpoint(std::string epId,
@@ -54,6 +54,8 @@ public:
   kj::Promise<void> sendFromHost(SendFromHostContext) override;
   kj::Promise<void> recvToHost(RecvToHostContext) override;
   kj::Promise<void> close(CloseContext) override;
+  kj::Promise<void> sendFromHostBatch(SendFromHostBatchContext) override;
+  kj::Promise<void> recvToHostBatch(RecvToHostBatchContext) override;
 };
 
 /// Implement the low level cosim RPC protocol.
@@ -152,6 +154,32 @@ kj::Promise<void> EndpointServer::close(CloseContext context) {
   return kj::READY_NOW;
 }
 
+/// Queue all the messages in the batch to the simulation, in order.
+kj::Promise<void>
+EndpointServer::sendFromHostBatch(SendFromHostBatchContext context) {
+  KJ_REQUIRE(open, "EndPoint closed already");
+  for (Data::Reader msg : context.getParams().getMsgs())
+    endpoint.pushMessageToSim(std::make_unique<esi::MessageData>(
+        (const uint8_t *)msg.begin(), msg.size()));
+  return kj::READY_NOW;
+}
+
+/// Pop as many messages as the client asked for, or as there are.
+kj::Promise<void>
+EndpointServer::recvToHostBatch(RecvToHostBatchContext context) {
+  KJ_REQUIRE(open, "EndPoint closed already");
+  uint32_t maxMsgs = context.getParams().getMaxMsgs();
+  std::vector<Endpoint::MessageDataPtr> blobs;
+  Endpoint::MessageDataPtr blob;
+  while (blobs.size() < maxMsgs && endpoint.getMessageToClient(blob))
+    blobs.push_back(std::move(blob));
+
+  auto resps = context.getResults().initResps(blobs.size());
+  for (size_t i = 0, e = blobs.size(); i < e; ++i)
+    resps.set(i, Data::Reader(blobs[i]->getBytes(), blobs[i]->getSize()));
+  return kj::READY_NOW;
+}
+
 /// ------ LowLevelServer definitions.
 
 LowLevelServer::LowLevelServer(LowLevel &bridge) : bridge(bridge) {}
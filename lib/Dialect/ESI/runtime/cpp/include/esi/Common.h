@@ -16,11 +16,17 @@
 #ifndef ESI_COMMON_H
 #define ESI_COMMON_H
 
+#include <algorithm>
 #include <any>
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace esi {
@@ -79,23 +85,144 @@ struct HWClientDetail {
 using HWClientDetails = std::vector<HWClientDetail>;
 using ServiceImplDetails = std::map<std::string, std::any>;
 
-/// A logical chunk of data representing serialized data. Currently, just a
-/// wrapper for a vector of bytes, which is not efficient in terms of memory
-/// copying. This will change in the future as will the API.
+/// A process-wide pool of byte buffers backing `MessageData`. Buffers are
+/// binned by power-of-two capacity and returned to the pool once the last
+/// message referencing them goes away, such that streaming messages of similar
+/// sizes does not hit the allocator. Header-only, since the cosim libraries
+/// use `MessageData` without linking the runtime.
+class BufferPool {
+public:
+  using Buffer = std::vector<uint8_t>;
+
+  /// Get the pool. It is intentionally leaked, such that buffers released
+  /// during static destruction can still be returned to it.
+  static BufferPool &get() {
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+  }
+
+  /// Get a buffer of `size` bytes. The contents are unspecified.
+  std::shared_ptr<Buffer> allocate(size_t size) {
+    unsigned bin = getBin(size);
+    Buffer *buffer = nullptr;
+    if (bin < numBins) {
+      std::lock_guard<std::mutex> g(mutex);
+      auto &free = freeLists[bin];
+      if (!free.empty()) {
+        buffer = free.back();
+        free.pop_back();
+      }
+    }
+    if (!buffer) {
+      buffer = new Buffer();
+      if (bin < numBins)
+        buffer->reserve(size_t(1) << bin);
+    }
+    buffer->resize(size);
+    return std::shared_ptr<Buffer>(buffer,
+                                   [this](Buffer *b) { release(b); });
+  }
+
+private:
+  BufferPool() = default;
+
+  /// Buffers up to 2^(numBins-1) bytes are pooled, larger ones are not.
+  static constexpr unsigned numBins = 25;
+  /// The number of free buffers kept per bin.
+  static constexpr size_t maxFreePerBin = 64;
+
+  static unsigned getBin(size_t size) {
+    unsigned bin = 0;
+    while ((size_t(1) << bin) < size && bin < numBins)
+      ++bin;
+    return bin;
+  }
+
+  void release(Buffer *buffer) {
+    unsigned bin = getBin(buffer->capacity());
+    // Only take back buffers whose capacity matches their bin exactly, which
+    // are the ones we allocated.
+    if (bin < numBins && buffer->capacity() == (size_t(1) << bin)) {
+      std::lock_guard<std::mutex> g(mutex);
+      auto &free = freeLists[bin];
+      if (free.size() < maxFreePerBin) {
+        free.push_back(buffer);
+        return;
+      }
+    }
+    delete buffer;
+  }
+
+  std::mutex mutex;
+  std::array<std::vector<Buffer *>, numBins> freeLists;
+};
+
+/// A logical chunk of data representing serialized data. This is a reference
+/// counted, immutable view into a buffer, such that messages can be copied and
+/// handed across threads and layers without copying their bytes. New messages
+/// are written once into a buffer from the `BufferPool`.
 class MessageData {
 public:
-  /// Adopts the data vector buffer.
+  /// A contiguous chunk of bytes to be gathered into a message.
+  using Segment = std::pair<const uint8_t *, size_t>;
+
   MessageData() = default;
-  MessageData(std::vector<uint8_t> &data) : data(std::move(data)) {}
-  MessageData(const uint8_t *data, size_t size) : data(data, data + size) {}
+  /// Adopts the data vector buffer.
+  MessageData(std::vector<uint8_t> &data)
+      : buffer(std::make_shared<std::vector<uint8_t>>(std::move(data))),
+        offset(0), size(buffer->size()) {}
+  /// Copies the data into a pooled buffer.
+  MessageData(const uint8_t *data, size_t size)
+      : MessageData(create(size, [&](uint8_t *bytes) {
+          if (size)
+            std::memcpy(bytes, data, size);
+        })) {}
   ~MessageData() = default;
 
-  const uint8_t *getBytes() const { return data.data(); }
+  /// Create a message of `size` bytes in a pooled buffer, which `fill` gets to
+  /// write into before it becomes immutable.
+  template <typename FillFn>
+  static MessageData create(size_t size, FillFn fill) {
+    auto buffer = BufferPool::get().allocate(size);
+    fill(buffer->data());
+    MessageData msg;
+    msg.buffer = std::move(buffer);
+    msg.size = size;
+    return msg;
+  }
+
+  /// Gather multiple segments into a single message, copying each only once.
+  static MessageData gather(const std::vector<Segment> &segments) {
+    size_t total = 0;
+    for (auto &segment : segments)
+      total += segment.second;
+    return create(total, [&](uint8_t *bytes) {
+      for (auto [data, size] : segments) {
+        if (size)
+          std::memcpy(bytes, data, size);
+        bytes += size;
+      }
+    });
+  }
+
+  /// Get a view of a subrange of this message, sharing its buffer.
+  MessageData slice(size_t sliceOffset, size_t sliceSize) const {
+    MessageData msg(*this);
+    msg.offset = offset + std::min(sliceOffset, size);
+    msg.size = std::min(sliceSize, size - std::min(sliceOffset, size));
+    return msg;
+  }
+
+  const uint8_t *getBytes() const {
+    return buffer ? buffer->data() + offset : nullptr;
+  }
   /// Get the size of the data in bytes.
-  size_t getSize() const { return data.size(); }
+  size_t getSize() const { return size; }
 
 private:
-  std::vector<uint8_t> data;
+  std::shared_ptr<const std::vector<uint8_t>> buffer;
+  size_t offset = 0;
+  size_t size = 0;
 };
 
 } // namespace esi
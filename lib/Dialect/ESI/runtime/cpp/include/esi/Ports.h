@@ -19,7 +19,11 @@
 #include "esi/Common.h"
 #include "esi/Types.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <future>
+#include <mutex>
 
 namespace esi {
 
@@ -49,6 +53,11 @@ public:
 
   /// A very basic write API. Will likely change for performance reasons.
   virtual void write(const MessageData &) = 0;
+
+  /// Write several messages in order. Backends which can move more than one
+  /// message at a time should override this. The default writes them one by
+  /// one.
+  virtual void writeBatch(const std::vector<MessageData> &msgs);
 };
 
 /// A ChannelPort which reads data from the accelerator.
@@ -61,11 +70,32 @@ public:
   /// and functionality reasons.
   virtual bool read(MessageData &) = 0;
 
+  /// Read up to `maxMessages` messages which are already available, appending
+  /// them to `msgs`. Non-blocking. Returns the number of messages read. The
+  /// default calls `read` until it fails.
+  virtual size_t readBatch(std::vector<MessageData> &msgs, size_t maxMessages);
+
   /// Asynchronous read. Returns a future which will be set when the message is
   /// recieved. Could this subsume the synchronous read API?
-  /// The default implementation of this is really bad and should be overridden.
-  /// It simply polls `read` in a loop.
+  /// The default implementation retries `read` whenever the backend signals a
+  /// new message through `notifyMessageAvailable`. Backends which never signal
+  /// get polled every `pollInterval`.
   virtual std::future<MessageData> readAsync();
+
+protected:
+  /// Wake up readers waiting for a message. Backends should call this whenever
+  /// a message may have become available. Safe to call from any thread.
+  void notifyMessageAvailable();
+
+  /// How long `readAsync` waits for a notification before polling again.
+  static constexpr std::chrono::milliseconds pollInterval{1};
+
+private:
+  std::mutex notifyMutex;
+  std::condition_variable notifyCv;
+  /// Incremented on every notification, such that waiters can tell whether
+  /// they missed one while reading.
+  std::atomic<uint64_t> notifications = 0;
 };
 
 /// Services provide connections to 'bundles' -- collections of named,
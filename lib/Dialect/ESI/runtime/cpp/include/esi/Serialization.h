@@ -0,0 +1,168 @@
+//===- Serialization.h - ESI message (de)serialization ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// DO NOT EDIT!
+// This file is distributed as part of an ESI package. The source for this file
+// should always be modified within CIRCT.
+//
+//===----------------------------------------------------------------------===//
+//
+// Packing and unpacking of typed values into messages. Values are laid out the
+// same way as in hardware: the last struct field and the last array element
+// occupy the least significant bits, and bit 0 is the LSB of the first byte.
+//
+// The bit helpers are meant for code generated from the manifest (see
+// `esiaccel.codegen`), where all offsets and widths are compile-time constants
+// and the helpers inline into straight-line code. `BitField` does the same for
+// hand-written code. `MessageLayout` provides packing for types only known at
+// runtime, with the layout computed once per type.
+//
+//===----------------------------------------------------------------------===//
+
+// NOLINTNEXTLINE(llvm-header-guard)
+#ifndef ESI_SERIALIZATION_H
+#define ESI_SERIALIZATION_H
+
+#include "esi/Common.h"
+#include "esi/Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace esi {
+
+/// Get a mask of the low `width` bits, for `width` up to 64.
+constexpr uint64_t lowBitsMask(unsigned width) {
+  return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+}
+
+/// Sign-extend the low `width` bits of `value`.
+constexpr int64_t signExtend(uint64_t value, unsigned width) {
+  unsigned shift = 64 - width;
+  return width == 0 ? 0 : int64_t(value << shift) >> shift;
+}
+
+/// Write the low `width` bits of `value` into `bytes` starting at bit `offset`,
+/// leaving all other bits untouched. `width` must be at most 64.
+inline void insertBits(uint8_t *bytes, size_t offset, uint64_t value,
+                       unsigned width) {
+  uint64_t mask = lowBitsMask(width);
+  value &= mask;
+  bytes += offset / 8;
+  unsigned shift = offset % 8;
+  for (unsigned i = 0, e = (shift + width + 7) / 8; i < e; ++i) {
+    // Byte `i` holds bits [8*i - shift, 8*i - shift + 8) of the value.
+    int lo = int(8 * i) - int(shift);
+    uint8_t valueBits = lo < 0 ? uint8_t(value << -lo) : uint8_t(value >> lo);
+    uint8_t maskBits = lo < 0 ? uint8_t(mask << -lo) : uint8_t(mask >> lo);
+    bytes[i] = (bytes[i] & ~maskBits) | valueBits;
+  }
+}
+
+/// Read `width` bits from `bytes` starting at bit `offset`. `width` must be at
+/// most 64.
+inline uint64_t extractBits(const uint8_t *bytes, size_t offset,
+                            unsigned width) {
+  bytes += offset / 8;
+  unsigned shift = offset % 8;
+  uint64_t value = 0;
+  for (unsigned i = 0, e = (shift + width + 7) / 8; i < e; ++i) {
+    int lo = int(8 * i) - int(shift);
+    value |= lo < 0 ? uint64_t(bytes[i]) >> -lo : uint64_t(bytes[i]) << lo;
+  }
+  return value & lowBitsMask(width);
+}
+
+/// Write `width` bits from the little-endian `data` into `bytes` starting at
+/// bit `offset`. Handles arbitrary widths.
+inline void insertWideBits(uint8_t *bytes, size_t offset, const uint8_t *data,
+                           size_t width) {
+  for (size_t bit = 0; bit < width; bit += 64) {
+    unsigned chunk = width - bit < 64 ? unsigned(width - bit) : 64;
+    insertBits(bytes, offset + bit, extractBits(data, bit, chunk), chunk);
+  }
+}
+
+/// Read `width` bits from `bytes` starting at bit `offset` into the
+/// little-endian `data`, which must be zero-initialized.
+inline void extractWideBits(const uint8_t *bytes, size_t offset, uint8_t *data,
+                            size_t width) {
+  for (size_t bit = 0; bit < width; bit += 64) {
+    unsigned chunk = width - bit < 64 ? unsigned(width - bit) : 64;
+    insertBits(data, bit, extractBits(bytes, offset + bit, chunk), chunk);
+  }
+}
+
+/// A field of at most 64 bits at a fixed position within a message.
+template <size_t Offset, unsigned Width>
+struct BitField {
+  static_assert(Width <= 64, "use insertWideBits for wider fields");
+  static constexpr size_t offset = Offset;
+  static constexpr unsigned width = Width;
+
+  static void insert(uint8_t *bytes, uint64_t value) {
+    insertBits(bytes, Offset, value, Width);
+  }
+  static uint64_t extract(const uint8_t *bytes) {
+    return extractBits(bytes, Offset, Width);
+  }
+  static int64_t extractSigned(const uint8_t *bytes) {
+    return signExtend(extract(bytes), Width);
+  }
+};
+
+/// The flattened bit layout of a fixed-size type. Each leaf (integer, bits, or
+/// void) of the type becomes a field, named by its path through structs and
+/// arrays, e.g. `a.b[3]`. The root is named by the empty path if it is a leaf
+/// itself.
+class MessageLayout {
+public:
+  struct Field {
+    std::string path;
+    size_t offset;
+    size_t width;
+    bool isSigned;
+  };
+
+  /// Compute the layout of `type`. Throws if the type does not have a fixed
+  /// size.
+  MessageLayout(const Type *type);
+
+  size_t getNumBits() const { return numBits; }
+  size_t getNumBytes() const { return (numBits + 7) / 8; }
+  const std::vector<Field> &getFields() const { return fields; }
+
+  /// Get the index of the field at `path`.
+  std::optional<size_t> lookup(const std::string &path) const;
+
+  /// Read a field of at most 64 bits, sign-extending signed integers.
+  uint64_t get(const MessageData &msg, size_t field) const;
+  /// Write a field of at most 64 bits.
+  void set(uint8_t *bytes, size_t field, uint64_t value) const;
+
+  /// Pack one value per field, in field order, into a new message. Fields must
+  /// be at most 64 bits wide.
+  MessageData pack(const std::vector<uint64_t> &values) const;
+  /// Unpack all fields of a message, in field order. Fields must be at most 64
+  /// bits wide.
+  std::vector<uint64_t> unpack(const MessageData &msg) const;
+
+private:
+  void addFields(const Type *type, const std::string &path, size_t offset);
+  void checkNarrow(size_t field) const;
+
+  size_t numBits;
+  std::vector<Field> fields;
+};
+
+} // namespace esi
+
+#endif // ESI_SERIALIZATION_H
@@ -11,6 +11,8 @@
 // trace files recorded from interactions with an actual connection. It also has
 // a mode wherein it will write to a file (for sends) and produce random data
 // (for receives). Both modes are intended for debugging without a simulation.
+// Binary traces can be replayed, which allows benchmarking host software against
+// recorded accelerator behavior.
 //
 // DO NOT EDIT!
 // This file is distributed as part of an ESI package. The source for this file
@@ -39,10 +41,14 @@ public:
     // garbage data for reads from the accelerator.
     Write,
 
+    // Same as 'Write', but record both directions in the binary trace format,
+    // such that the trace can be replayed in 'Read' mode.
+    WriteBinary,
+
     // Sent data to the accelerator is compared against the trace file's record.
-    // Data read from the accelerator is read from the trace file.
-    // TODO: Full trace mode not yet supported.
-    // Read
+    // Data read from the accelerator is read from the trace file. Requires a
+    // binary trace.
+    Read
   };
 
   /// Create a trace-based accelerator backend.
@@ -54,7 +60,8 @@ public:
                    std::filesystem::path traceFile);
 
   /// Parse the connection string and instantiate the accelerator. Format is:
-  /// "<mode>:<manifest path>[:<traceFile>]".
+  /// "<mode>:<manifest path>[:<traceFile>]", where mode is 'w' (Write), 'b'
+  /// (WriteBinary), or 'r' (Read).
   static std::unique_ptr<AcceleratorConnection>
   connect(Context &, std::string connectionString);
 
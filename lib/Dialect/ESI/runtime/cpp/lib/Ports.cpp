@@ -43,14 +43,42 @@ ReadChannelPort &BundlePort::getRawRead(const string &name) const {
   return *read;
 }
 
+void WriteChannelPort::writeBatch(const std::vector<MessageData> &msgs) {
+  for (const MessageData &msg : msgs)
+    write(msg);
+}
+
+size_t ReadChannelPort::readBatch(std::vector<MessageData> &msgs,
+                                  size_t maxMessages) {
+  size_t numRead = 0;
+  MessageData msg;
+  while (numRead < maxMessages && read(msg)) {
+    msgs.push_back(std::move(msg));
+    ++numRead;
+  }
+  return numRead;
+}
+
 std::future<MessageData> ReadChannelPort::readAsync() {
   // TODO: running this deferred is a horrible idea considering that it blocks!
   // It's a hack since Capnp RPC refuses to work with multiple threads.
   return std::async(std::launch::deferred, [this]() {
     MessageData output;
-    while (!read(output)) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    while (true) {
+      uint64_t seen = notifications.load();
+      if (read(output))
+        return output;
+      std::unique_lock<std::mutex> lock(notifyMutex);
+      notifyCv.wait_for(lock, pollInterval,
+                        [&]() { return notifications.load() != seen; });
     }
-    return output;
   });
 }
+
+void ReadChannelPort::notifyMessageAvailable() {
+  notifications.fetch_add(1);
+  // Synchronize with a reader between checking the counter and starting to
+  // wait, such that the notification cannot get lost.
+  { std::lock_guard<std::mutex> lock(notifyMutex); }
+  notifyCv.notify_all();
+}
@@ -0,0 +1,109 @@
+//===- Serialization.cpp --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// DO NOT EDIT!
+// This file is distributed as part of an ESI package. The source for this file
+// should always be modified within CIRCT (lib/dialect/ESI/runtime/cpp/).
+//
+//===----------------------------------------------------------------------===//
+
+#include "esi/Serialization.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace esi;
+
+MessageLayout::MessageLayout(const Type *type) {
+  std::ptrdiff_t width = type->getBitWidth();
+  if (width < 0)
+    throw runtime_error("type '" + type->getID() + "' has no fixed size");
+  numBits = width;
+  addFields(type, "", 0);
+}
+
+void MessageLayout::addFields(const Type *type, const string &path,
+                              size_t offset) {
+  if (auto *chanType = dynamic_cast<const ChannelType *>(type))
+    return addFields(chanType->getInner(), path, offset);
+
+  // Later fields occupy the lower bits.
+  if (auto *structType = dynamic_cast<const StructType *>(type)) {
+    const auto &structFields = structType->getFields();
+    size_t fieldOffset = offset + structType->getBitWidth();
+    for (auto &[name, fieldType] : structFields) {
+      fieldOffset -= fieldType->getBitWidth();
+      addFields(fieldType, path.empty() ? name : path + "." + name,
+                fieldOffset);
+    }
+    return;
+  }
+
+  // Later elements occupy the lower bits.
+  if (auto *arrayType = dynamic_cast<const ArrayType *>(type)) {
+    const Type *elementType = arrayType->getElementType();
+    size_t elementWidth = elementType->getBitWidth();
+    for (uint64_t i = 0, e = arrayType->getSize(); i < e; ++i)
+      addFields(elementType, path + "[" + to_string(i) + "]",
+                offset + (e - 1 - i) * elementWidth);
+    return;
+  }
+
+  bool isSigned = dynamic_cast<const SIntType *>(type) != nullptr;
+  fields.push_back({path, offset, size_t(type->getBitWidth()), isSigned});
+}
+
+optional<size_t> MessageLayout::lookup(const string &path) const {
+  for (size_t i = 0, e = fields.size(); i < e; ++i)
+    if (fields[i].path == path)
+      return i;
+  return nullopt;
+}
+
+void MessageLayout::checkNarrow(size_t field) const {
+  if (fields.at(field).width > 64)
+    throw runtime_error("field '" + fields[field].path +
+                        "' is wider than 64 bits");
+}
+
+uint64_t MessageLayout::get(const MessageData &msg, size_t field) const {
+  checkNarrow(field);
+  if (msg.getSize() < getNumBytes())
+    throw runtime_error("message too small for layout");
+  const Field &f = fields[field];
+  uint64_t value = extractBits(msg.getBytes(), f.offset, f.width);
+  return f.isSigned ? uint64_t(signExtend(value, f.width)) : value;
+}
+
+void MessageLayout::set(uint8_t *bytes, size_t field, uint64_t value) const {
+  checkNarrow(field);
+  const Field &f = fields[field];
+  insertBits(bytes, f.offset, value, f.width);
+}
+
+MessageData MessageLayout::pack(const vector<uint64_t> &values) const {
+  if (values.size() != fields.size())
+    throw runtime_error("expected " + to_string(fields.size()) +
+                        " values, got " + to_string(values.size()));
+  for (size_t i = 0, e = fields.size(); i < e; ++i)
+    checkNarrow(i);
+  return MessageData::create(getNumBytes(), [&](uint8_t *bytes) {
+    memset(bytes, 0, getNumBytes());
+    for (size_t i = 0, e = fields.size(); i < e; ++i)
+      insertBits(bytes, fields[i].offset, values[i], fields[i].width);
+  });
+}
+
+vector<uint64_t> MessageLayout::unpack(const MessageData &msg) const {
+  vector<uint64_t> values;
+  values.reserve(fields.size());
+  for (size_t i = 0, e = fields.size(); i < e; ++i)
+    values.push_back(get(msg, i));
+  return values;
+}
@@ -94,12 +94,10 @@ public:
   uint32_t read(uint32_t addr) const override {
     lowLevel->readReqs.push(addr);
 
-    std::optional<std::pair<uint64_t, uint8_t>> resp;
-    while (resp = lowLevel->readResps.pop(), !resp.has_value())
-      std::this_thread::sleep_for(std::chrono::microseconds(10));
-    if (resp->second != 0)
-      throw runtime_error("MMIO read error" + to_string(resp->second));
-    return resp->first;
+    auto resp = lowLevel->readResps.popWait();
+    if (resp.second != 0)
+      throw runtime_error("MMIO read error" + to_string(resp.second));
+    return resp.first;
   }
 
   // Push the write request into the LowLevel capnp bridge and wait for the ack
@@ -107,11 +105,9 @@ public:
   void write(uint32_t addr, uint32_t data) override {
     lowLevel->writeReqs.push(make_pair(addr, data));
 
-    std::optional<uint8_t> resp;
-    while (resp = lowLevel->writeResps.pop(), !resp.has_value())
-      std::this_thread::sleep_for(std::chrono::microseconds(10));
-    if (*resp != 0)
-      throw runtime_error("MMIO write error" + to_string(*resp));
+    auto resp = lowLevel->writeResps.popWait();
+    if (resp != 0)
+      throw runtime_error("MMIO write error" + to_string(resp));
   }
 
 private:
@@ -199,10 +195,13 @@ public:
       throw runtime_error("Channel '" + name + "' has wrong type. Expected " +
                           getType()->getID() + ", got " + ep->getRecvTypeId());
     ep->setInUse();
+    ep->setClientNotifier([this]() { notifyMessageAvailable(); });
   }
   virtual void disconnect() override {
-    if (ep)
+    if (ep) {
+      ep->setClientNotifier({});
       ep->returnForUse();
+    }
   }
   virtual bool read(MessageData &) override;
 
@@ -217,7 +216,7 @@ bool ReadCosimChannelPort::read(MessageData &data) {
   esi::cosim::Endpoint::MessageDataPtr msg;
   if (!ep->getMessageToClient(msg))
     return false;
-  data = *msg;
+  data = std::move(*msg);
   return true;
 }
 
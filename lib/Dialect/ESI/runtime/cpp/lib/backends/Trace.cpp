@@ -19,11 +19,22 @@
 #include "esi/Utils.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <regex>
 #include <sstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 using namespace esi;
@@ -33,13 +44,207 @@ using namespace esi::backends::trace;
 // We only support v1.
 constexpr uint32_t ESIVersion = 1;
 
+//===----------------------------------------------------------------------===//
+// Binary trace format.
+//===----------------------------------------------------------------------===//
+//
+// A binary trace starts with the magic bytes "ESITRACE" and a 32-bit format
+// version, followed by a sequence of records. Integers are stored in host byte
+// order. Each record starts with a one-byte kind:
+// - 'C' declares a channel: u32 channel index, u8 direction (0 for data sent to
+//   the accelerator, 1 for data read from it), u32 name length, name bytes.
+// - 'M' is a message: u32 channel index, u64 nanoseconds since the start of
+//   the trace, u32 size, data bytes.
+// Channels are declared before their first message, such that the file can be
+// appended to while recording and indexed in a single pass for replay.
+//
+//===----------------------------------------------------------------------===//
+
 namespace {
-class TraceChannelPort;
-}
+constexpr char binaryTraceMagic[8] = {'E', 'S', 'I', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t binaryTraceVersion = 1;
+
+/// Appends records to a binary trace.
+class BinaryTraceWriter {
+public:
+  BinaryTraceWriter(const filesystem::path &path)
+      : start(chrono::steady_clock::now()) {
+    file = fopen(path.string().c_str(), "wb");
+    if (!file)
+      throw runtime_error("failed to open trace file '" + path.string() + "'");
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    fwrite(binaryTraceMagic, sizeof(binaryTraceMagic), 1, file);
+    put(binaryTraceVersion);
+  }
+  ~BinaryTraceWriter() { fclose(file); }
+
+  uint32_t declareChannel(const string &name, bool fromAccel) {
+    lock_guard<mutex> g(m);
+    uint32_t channel = numChannels++;
+    fputc('C', file);
+    put(channel);
+    put(uint8_t(fromAccel));
+    put(uint32_t(name.size()));
+    fwrite(name.data(), 1, name.size(), file);
+    return channel;
+  }
+
+  void writeMessage(uint32_t channel, const MessageData &msg) {
+    lock_guard<mutex> g(m);
+    fputc('M', file);
+    put(channel);
+    put(uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+                     chrono::steady_clock::now() - start)
+                     .count()));
+    put(uint32_t(msg.getSize()));
+    fwrite(msg.getBytes(), 1, msg.getSize(), file);
+  }
+
+  void flush() {
+    lock_guard<mutex> g(m);
+    fflush(file);
+  }
+
+private:
+  template <typename T>
+  void put(T value) {
+    fwrite(&value, sizeof(T), 1, file);
+  }
+
+  FILE *file;
+  mutex m;
+  chrono::steady_clock::time_point start;
+  uint32_t numChannels = 0;
+};
+
+/// A binary trace mapped into memory and indexed by channel name.
+class BinaryTraceReader {
+public:
+  struct Message {
+    const uint8_t *data;
+    uint32_t size;
+    uint64_t time;
+  };
+  struct Channel {
+    bool fromAccel;
+    vector<Message> messages;
+  };
+
+  BinaryTraceReader(const filesystem::path &path) {
+    mapFile(path);
+    index(path);
+  }
+  ~BinaryTraceReader() {
+#ifndef _WIN32
+    if (base)
+      munmap(const_cast<uint8_t *>(base), size);
+#endif
+  }
+
+  /// Get the recorded messages of a channel, or null if it never appeared in
+  /// the trace.
+  const Channel *getChannel(const string &name) const {
+    auto it = channels.find(name);
+    return it == channels.end() ? nullptr : &it->second;
+  }
+
+private:
+  void mapFile(const filesystem::path &path) {
+#ifndef _WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+      throw runtime_error("failed to open trace file '" + path.string() + "'");
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      size = st.st_size;
+      void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED)
+        base = static_cast<const uint8_t *>(addr);
+    }
+    close(fd);
+    if (!base)
+      throw runtime_error("failed to map trace file '" + path.string() + "'");
+#else
+    ifstream in(path, ios::binary);
+    if (!in.is_open())
+      throw runtime_error("failed to open trace file '" + path.string() + "'");
+    contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    base = contents.data();
+    size = contents.size();
+#endif
+  }
+
+  template <typename T>
+  T get(size_t &pos, const filesystem::path &path) const {
+    if (pos + sizeof(T) > size)
+      throw runtime_error("truncated trace file '" + path.string() + "'");
+    T value;
+    memcpy(&value, base + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  void index(const filesystem::path &path) {
+    if (size < sizeof(binaryTraceMagic) + sizeof(uint32_t) ||
+        memcmp(base, binaryTraceMagic, sizeof(binaryTraceMagic)) != 0)
+      throw runtime_error("'" + path.string() + "' is not a binary trace");
+    size_t pos = sizeof(binaryTraceMagic);
+    if (get<uint32_t>(pos, path) != binaryTraceVersion)
+      throw runtime_error("unsupported version of trace file '" +
+                          path.string() + "'");
+
+    vector<Channel *> byIndex;
+    while (pos < size) {
+      uint8_t kind = get<uint8_t>(pos, path);
+      uint32_t channel = get<uint32_t>(pos, path);
+      if (kind == 'C') {
+        bool fromAccel = get<uint8_t>(pos, path);
+        uint32_t nameSize = get<uint32_t>(pos, path);
+        if (pos + nameSize > size)
+          throw runtime_error("truncated trace file '" + path.string() + "'");
+        string name(reinterpret_cast<const char *>(base + pos), nameSize);
+        pos += nameSize;
+        if (channel >= byIndex.size())
+          byIndex.resize(channel + 1);
+        byIndex[channel] = &channels[name];
+        byIndex[channel]->fromAccel = fromAccel;
+      } else if (kind == 'M') {
+        uint64_t time = get<uint64_t>(pos, path);
+        uint32_t msgSize = get<uint32_t>(pos, path);
+        if (channel >= byIndex.size() || !byIndex[channel] ||
+            pos + msgSize > size)
+          throw runtime_error("malformed trace file '" + path.string() + "'");
+        byIndex[channel]->messages.push_back({base + pos, msgSize, time});
+        pos += msgSize;
+      } else {
+        throw runtime_error("malformed trace file '" + path.string() + "'");
+      }
+    }
+  }
+
+  const uint8_t *base = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  vector<uint8_t> contents;
+#endif
+  std::map<string, Channel> channels;
+};
+
+/// The per-channel state of the trace backend.
+struct TraceChannel {
+  AppIDPath id;
+  string portName;
+  /// The channel index in a binary trace being written.
+  uint32_t binaryIndex = 0;
+  /// The recorded messages when replaying a trace.
+  const BinaryTraceReader::Channel *replay = nullptr;
+  size_t replayPos = 0;
+};
+} // namespace
 
 struct esi::backends::trace::TraceAccelerator::Impl {
   Impl(Mode mode, filesystem::path manifestJson, filesystem::path traceFile)
-      : manifestJson(manifestJson), traceFile(traceFile) {
+      : mode(mode), manifestJson(manifestJson), traceFile(traceFile) {
     if (!filesystem::exists(manifestJson))
       throw runtime_error("manifest file '" + manifestJson.string() +
                           "' does not exist");
@@ -50,8 +255,10 @@ struct esi::backends::trace::TraceAccelerator::Impl {
       if (!traceWrite->is_open())
         throw runtime_error("failed to open trace file '" + traceFile.string() +
                             "'");
+    } else if (mode == WriteBinary) {
+      binaryWrite = make_unique<BinaryTraceWriter>(traceFile);
     } else {
-      assert(false && "not implemented");
+      binaryRead = make_unique<BinaryTraceReader>(traceFile);
     }
   }
 
@@ -74,22 +281,117 @@ struct esi::backends::trace::TraceAccelerator::Impl {
 
   void adoptChannelPort(ChannelPort *port) { channels.emplace_back(port); }
 
-  void write(const AppIDPath &id, const string &portName, const void *data,
-             size_t size);
+  /// Get the trace state of a channel.
+  TraceChannel &getChannel(const AppIDPath &id, const string &portName,
+                           bool fromAccel);
+
+  void write(TraceChannel &channel, const MessageData &msg);
+  void writeBatch(TraceChannel &channel, const vector<MessageData> &msgs);
+  bool read(TraceChannel &channel, const Type *type, MessageData &msg);
 
 private:
-  ofstream *traceWrite;
+  void writeText(const AppIDPath &id, const string &portName, const void *data,
+                 size_t size);
+  MessageData replay(TraceChannel &channel);
+
+  Mode mode;
+  ofstream *traceWrite = nullptr;
+  unique_ptr<BinaryTraceWriter> binaryWrite;
+  unique_ptr<BinaryTraceReader> binaryRead;
+  vector<unique_ptr<TraceChannel>> traceChannels;
   filesystem::path manifestJson;
   filesystem::path traceFile;
   vector<unique_ptr<ChannelPort>> channels;
 };
 
-void TraceAccelerator::Impl::write(const AppIDPath &id, const string &portName,
-                                   const void *data, size_t size) {
+TraceChannel &TraceAccelerator::Impl::getChannel(const AppIDPath &id,
+                                                 const string &portName,
+                                                 bool fromAccel) {
+  auto channel = make_unique<TraceChannel>();
+  channel->id = id;
+  channel->portName = portName;
+  string name = id.toStr() + "." + portName;
+  if (binaryWrite)
+    channel->binaryIndex = binaryWrite->declareChannel(name, fromAccel);
+  if (binaryRead) {
+    channel->replay = binaryRead->getChannel(name);
+    if (channel->replay && channel->replay->fromAccel != fromAccel)
+      throw runtime_error("channel '" + name +
+                          "' has the wrong direction in the trace");
+  }
+  traceChannels.push_back(std::move(channel));
+  return *traceChannels.back();
+}
+
+void TraceAccelerator::Impl::writeText(const AppIDPath &id,
+                                       const string &portName,
+                                       const void *data, size_t size) {
   string b64data;
   utils::encodeBase64(data, size, b64data);
 
-  *traceWrite << "write " << id << '.' << portName << ": " << b64data << endl;
+  *traceWrite << "write " << id << '.' << portName << ": " << b64data << '\n';
+}
+
+void TraceAccelerator::Impl::write(TraceChannel &channel,
+                                   const MessageData &msg) {
+  if (mode == Write) {
+    writeText(channel.id, channel.portName, msg.getBytes(), msg.getSize());
+    traceWrite->flush();
+  } else if (mode == WriteBinary) {
+    binaryWrite->writeMessage(channel.binaryIndex, msg);
+  } else {
+    // Compare against what the host sent when the trace was recorded.
+    MessageData expected = replay(channel);
+    if (expected.getSize() != msg.getSize() ||
+        memcmp(expected.getBytes(), msg.getBytes(), msg.getSize()) != 0)
+      throw runtime_error("write to '" + channel.id.toStr() + "." +
+                          channel.portName + "' differs from the trace");
+  }
+}
+
+void TraceAccelerator::Impl::writeBatch(TraceChannel &channel,
+                                        const vector<MessageData> &msgs) {
+  if (mode != Write) {
+    for (const MessageData &msg : msgs)
+      write(channel, msg);
+    return;
+  }
+  // Only flush once for the whole batch.
+  for (const MessageData &msg : msgs)
+    writeText(channel.id, channel.portName, msg.getBytes(), msg.getSize());
+  traceWrite->flush();
+}
+
+MessageData TraceAccelerator::Impl::replay(TraceChannel &channel) {
+  if (!channel.replay || channel.replayPos >= channel.replay->messages.size())
+    throw runtime_error("trace has no more messages for '" +
+                        channel.id.toStr() + "." + channel.portName + "'");
+  const auto &msg = channel.replay->messages[channel.replayPos++];
+  return MessageData(msg.data, msg.size);
+}
+
+bool TraceAccelerator::Impl::read(TraceChannel &channel, const Type *type,
+                                  MessageData &msg) {
+  if (mode == Read) {
+    if (!channel.replay || channel.replayPos >= channel.replay->messages.size())
+      return false;
+    msg = replay(channel);
+    return true;
+  }
+
+  std::ptrdiff_t numBits = type->getBitWidth();
+  if (numBits < 0)
+    // TODO: support other types.
+    throw runtime_error("unsupported type for read: " + type->getID());
+
+  std::ptrdiff_t size = (numBits + 7) / 8;
+  msg = MessageData::create(size, [&](uint8_t *bytes) {
+    for (std::ptrdiff_t i = 0; i < size; ++i)
+      bytes[i] = rand() % 256;
+  });
+  if (binaryWrite)
+    binaryWrite->writeMessage(channel.binaryIndex, msg);
+  return true;
 }
 
 unique_ptr<AcceleratorConnection>
@@ -100,13 +402,13 @@ TraceAccelerator::connect(Context &ctxt, string connectionString) {
 
   // Parse the connection string.
   // <mode>:<manifest path>[:<traceFile>]
-  regex connPattern("(\\w):([^:]+)(:(\\w+))?");
+  regex connPattern("(\\w):([^:]+)(:([^:]+))?");
   smatch match;
   if (regex_search(connectionString, match, connPattern)) {
     modeStr = match[1];
     manifestPath = match[2];
-    if (match[3].matched)
-      traceFile = match[3];
+    if (match[4].matched)
+      traceFile = match[4];
   } else {
     throw runtime_error("connection string must be of the form "
                         "'<mode>:<manifest path>[:<traceFile>]'");
@@ -116,6 +418,10 @@ TraceAccelerator::connect(Context &ctxt, string connectionString) {
   Mode mode;
   if (modeStr == "w")
     mode = Write;
+  else if (modeStr == "b")
+    mode = WriteBinary;
+  else if (modeStr == "r")
+    mode = Read;
   else
     throw runtime_error("unknown mode '" + modeStr + "'");
 
@@ -169,47 +475,66 @@ class WriteTraceChannelPort : public WriteChannelPort {
 public:
   WriteTraceChannelPort(TraceAccelerator::Impl &impl, const Type *type,
                         const AppIDPath &id, const string &portName)
-      : WriteChannelPort(type), impl(impl), id(id), portName(portName) {}
+      : WriteChannelPort(type), impl(impl),
+        channel(impl.getChannel(id, portName, /*fromAccel=*/false)) {}
 
   virtual void write(const MessageData &data) override {
-    impl.write(id, portName, data.getBytes(), data.getSize());
+    impl.write(channel, data);
+  }
+  virtual void writeBatch(const vector<MessageData> &msgs) override {
+    impl.writeBatch(channel, msgs);
   }
 
 protected:
   TraceAccelerator::Impl &impl;
-  AppIDPath id;
-  string portName;
+  TraceChannel &channel;
 };
 } // namespace
 
 namespace {
 class ReadTraceChannelPort : public ReadChannelPort {
 public:
-  ReadTraceChannelPort(TraceAccelerator::Impl &impl, const Type *type)
-      : ReadChannelPort(type) {}
+  ReadTraceChannelPort(TraceAccelerator::Impl &impl, const Type *type,
+                       const AppIDPath &id, const string &portName,
+                       bool replay)
+      : ReadChannelPort(type), impl(impl),
+        channel(impl.getChannel(id, portName, /*fromAccel=*/true)),
+        replay(replay) {}
 
   virtual bool read(MessageData &data) override;
+  virtual size_t readBatch(vector<MessageData> &msgs,
+                           size_t maxMessages) override;
 
 private:
+  TraceAccelerator::Impl &impl;
+  TraceChannel &channel;
+  bool replay;
   size_t numReads = 0;
 };
 } // namespace
 
 bool ReadTraceChannelPort::read(MessageData &data) {
-  if ((++numReads & 0x1) == 1)
+  // Recorded messages are available right away. Otherwise, only every other
+  // read succeeds to exercise the host's handling of empty reads.
+  if (!replay && (++numReads & 0x1) == 1) {
+    // The next read always succeeds, so do not let asynchronous readers wait.
+    notifyMessageAvailable();
     return false;
+  }
+  return impl.read(channel, getType(), data);
+}
 
-  std::ptrdiff_t numBits = getType()->getBitWidth();
-  if (numBits < 0)
-    // TODO: support other types.
-    throw runtime_error("unsupported type for read: " + getType()->getID());
-
-  std::ptrdiff_t size = (numBits + 7) / 8;
-  std::vector<uint8_t> bytes(size);
-  for (std::ptrdiff_t i = 0; i < size; ++i)
-    bytes[i] = rand() % 256;
-  data = MessageData(bytes);
-  return true;
+size_t ReadTraceChannelPort::readBatch(vector<MessageData> &msgs,
+                                       size_t maxMessages) {
+  if (!replay)
+    return ReadChannelPort::readBatch(msgs, maxMessages);
+  size_t numRead = 0;
+  MessageData msg;
+  while (numRead < maxMessages && impl.read(channel, getType(), msg)) {
+    msgs.push_back(std::move(msg));
+    ++numRead;
+  }
+  return numRead;
 }
 
 namespace {
@@ -231,7 +556,8 @@ TraceAccelerator::Impl::requestChannelsFor(AppIDPath idPath,
     if (BundlePort::isWrite(dir))
       port = new WriteTraceChannelPort(*this, type, idPath, name);
     else
-      port = new ReadTraceChannelPort(*this, type);
+      port = new ReadTraceChannelPort(*this, type, idPath, name,
+                                      mode == Read);
     channels.emplace(name, *port);
     adoptChannelPort(port);
   }
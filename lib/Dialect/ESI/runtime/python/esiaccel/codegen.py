@@ -0,0 +1,318 @@
+#  Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+#  See https://llvm.org/LICENSE.txt for license information.
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# Generate C++ types for the message types of the channels in an ESI manifest,
+# along with straight-line code to pack them into and unpack them from
+# `esi::MessageData`. Structs become C++ structs, aliases of structs become type
+# aliases, and integers and arrays sent on a channel are wrapped in a struct
+# with a single `value` field. The bit layout matches `esi::MessageLayout` in
+# `esi/Serialization.h`: the last struct field and the last array element
+# occupy the least significant bits.
+
+import argparse
+import json
+import re
+import sys
+import zlib
+from typing import Dict, List, Optional, TextIO, Tuple
+
+# C++ keywords which cannot be used as field names.
+_cpp_keywords = {
+    "alignas", "alignof", "and", "auto", "bool", "break", "case", "catch",
+    "char", "class", "const", "constexpr", "continue", "default", "delete",
+    "do", "double", "else", "enum", "explicit", "extern", "false", "float",
+    "for", "friend", "goto", "if", "inline", "int", "long", "namespace", "new",
+    "not", "operator", "or", "private", "protected", "public", "register",
+    "return", "short", "signed", "sizeof", "static", "struct", "switch",
+    "template", "this", "throw", "true", "try", "typedef", "union", "unsigned",
+    "using", "virtual", "void", "volatile", "while", "xor"
+}
+
+
+def _identifier(name: str) -> str:
+  ident = re.sub(r"[^A-Za-z0-9_]", "_", name)
+  if not ident or ident[0].isdigit() or ident in _cpp_keywords:
+    ident = "_" + ident
+  return ident
+
+
+class CppGenerator:
+  """Collects the message types of a manifest and emits C++ for them."""
+
+  def __init__(self, manifest: Dict):
+    # The C++ types to generate by name, in an order where nested types come
+    # first. Each is a (kind, type) pair, where kind is "struct" for a struct
+    # type, "alias" for an alias of a struct, and "message" for a wrapper
+    # around an integer or array sent on a channel.
+    self.types: Dict[str, Tuple[str, Dict]] = {}
+    # Channel message types which cannot be represented, by circt_name, along
+    # with the reason.
+    self.skipped: Dict[str, str] = {}
+    for ty in manifest.get("types", []):
+      self._collect(ty)
+
+  def _collect(self, ty: Dict):
+    mnemonic = ty.get("mnemonic")
+    if mnemonic == "bundle":
+      for chan in ty["channels"]:
+        self._collect(chan["type"])
+    elif mnemonic == "channel":
+      self._collect_message(ty["inner"])
+    else:
+      self._collect_nested(ty)
+
+  def _collect_message(self, ty: Dict):
+    """Collect the type of the messages on a channel."""
+    reason = self.unsupported_reason(ty)
+    if reason is not None:
+      self.skipped.setdefault(ty["circt_name"], reason)
+      return
+    self._collect_nested(ty)
+    inner = self.strip_alias(ty)
+    if inner["mnemonic"] == "struct":
+      return
+    name = (_identifier(ty["name"])
+            if ty["mnemonic"] == "alias" else self.message_name(inner))
+    self.types.setdefault(name, ("message", ty))
+
+  def _collect_nested(self, ty: Dict):
+    """Collect the structs and aliases of structs within a type."""
+    mnemonic = ty.get("mnemonic")
+    if mnemonic == "array":
+      self._collect_nested(ty["element"])
+    elif mnemonic == "alias":
+      self._collect_nested(ty["inner"])
+      inner = self.strip_alias(ty)
+      if (inner.get("mnemonic") == "struct" and
+          self.unsupported_reason(inner) is None):
+        self.types.setdefault(_identifier(ty["name"]), ("alias", ty))
+    elif mnemonic == "struct":
+      for field in ty["fields"]:
+        self._collect_nested(field["type"])
+      if self.unsupported_reason(ty) is None:
+        self.types.setdefault(self.struct_name(ty), ("struct", ty))
+
+  def unsupported_reason(self, ty: Dict) -> Optional[str]:
+    """Why a type cannot be represented in C++, or None if it can. Types
+    without any bits, such as void, have nothing to pack."""
+    mnemonic = ty.get("mnemonic")
+    if mnemonic == "alias":
+      return self.unsupported_reason(ty["inner"])
+    if mnemonic == "struct":
+      for field in ty["fields"]:
+        reason = self.unsupported_reason(field["type"])
+        if reason is not None:
+          return f"field '{field['name']}': {reason}"
+    elif mnemonic == "array":
+      reason = self.unsupported_reason(ty["element"])
+      if reason is not None:
+        return f"element: {reason}"
+    elif mnemonic != "int":
+      return f"{mnemonic or 'unknown'} types are not supported"
+    if self.bit_width(ty) == 0:
+      return "it has no bits"
+    return None
+
+  def bit_width(self, ty: Dict) -> int:
+    """The width of a type which can be represented in C++."""
+    ty = self.strip_alias(ty)
+    mnemonic = ty["mnemonic"]
+    if mnemonic == "struct":
+      return sum(self.bit_width(f["type"]) for f in ty["fields"])
+    if mnemonic == "array":
+      return self.bit_width(ty["element"]) * ty["size"]
+    return ty["hw_bitwidth"]
+
+  @staticmethod
+  def strip_alias(ty: Dict) -> Dict:
+    while ty.get("mnemonic") == "alias":
+      ty = ty["inner"]
+    return ty
+
+  def struct_name(self, ty: Dict) -> str:
+    """Manifest types are anonymous, so name structs after a hash of their
+    type, which is stable across regenerations."""
+    crc = zlib.crc32(ty["circt_name"].encode()) & 0xffffffff
+    return f"Struct_{crc:08x}"
+
+  def message_name(self, ty: Dict) -> str:
+    """The name of the wrapper for integers or arrays sent on a channel."""
+    if ty["mnemonic"] == "int":
+      prefix = "SInt" if ty["signedness"] == "signed" else "UInt"
+      return f"{prefix}{ty['hw_bitwidth']}"
+    crc = zlib.crc32(ty["circt_name"].encode()) & 0xffffffff
+    return f"Array_{crc:08x}"
+
+  def cpp_type(self, ty: Dict) -> str:
+    ty = self.strip_alias(ty)
+    mnemonic = ty["mnemonic"]
+    if mnemonic == "struct":
+      return self.struct_name(ty)
+    if mnemonic == "array":
+      return f"std::array<{self.cpp_type(ty['element'])}, {ty['size']}>"
+    width = ty["hw_bitwidth"]
+    if width > 64:
+      return f"std::array<uint8_t, {(width + 7) // 8}>"
+    bits = next(b for b in (8, 16, 32, 64) if width <= b)
+    prefix = "" if ty["signedness"] == "signed" else "u"
+    return f"{prefix}int{bits}_t"
+
+  def _pack(self, ty: Dict, expr: str, offset: str, depth: int) -> List[str]:
+    """Statements writing `expr` into `bytes` at bit `offset`."""
+    ty = self.strip_alias(ty)
+    mnemonic = ty["mnemonic"]
+    width = self.bit_width(ty)
+    if mnemonic == "struct":
+      return [f"{expr}.pack(bytes, {offset});"]
+    if mnemonic == "array":
+      i = f"i{depth}"
+      size = ty["size"]
+      elem_width = self.bit_width(ty["element"])
+      elem_offset = f"{offset} + ({size} - 1 - {i}) * {elem_width}"
+      body = self._pack(ty["element"], f"{expr}[{i}]", elem_offset,
+                        depth + 1)
+      return [f"for (size_t {i} = 0; {i} < {size}; ++{i}) {{"
+             ] + ["  " + line for line in body] + ["}"]
+    if width > 64:
+      return [f"esi::insertWideBits(bytes, {offset}, {expr}.data(), {width});"]
+    return [f"esi::insertBits(bytes, {offset}, uint64_t({expr}), {width});"]
+
+  def _unpack(self, ty: Dict, expr: str, offset: str,
+              depth: int) -> List[str]:
+    """Statements reading `expr` from `bytes` at bit `offset`."""
+    ty = self.strip_alias(ty)
+    mnemonic = ty["mnemonic"]
+    width = self.bit_width(ty)
+    if mnemonic == "struct":
+      return [
+          f"{expr} = {self.struct_name(ty)}::unpack(bytes, {offset});"
+      ]
+    if mnemonic == "array":
+      i = f"i{depth}"
+      size = ty["size"]
+      elem_width = self.bit_width(ty["element"])
+      elem_offset = f"{offset} + ({size} - 1 - {i}) * {elem_width}"
+      body = self._unpack(ty["element"], f"{expr}[{i}]", elem_offset,
+                          depth + 1)
+      return [f"for (size_t {i} = 0; {i} < {size}; ++{i}) {{"
+             ] + ["  " + line for line in body] + ["}"]
+    if width > 64:
+      return [
+          f"{expr} = {{}};",
+          f"esi::extractWideBits(bytes, {offset}, {expr}.data(), {width});"
+      ]
+    value = f"esi::extractBits(bytes, {offset}, {width})"
+    if ty["signedness"] == "signed":
+      value = f"esi::signExtend({value}, {width})"
+    return [f"{expr} = {self.cpp_type(ty)}({value});"]
+
+  def _emit_struct(self, name: str, ty: Dict,
+                   fields: List[Tuple[str, Dict]], out: TextIO):
+    """Emit a struct with the given fields for messages of type `ty`."""
+    num_bits = self.bit_width(ty)
+
+    # Later fields occupy the lower bits.
+    offsets = []
+    offset = num_bits
+    for _, ftype in fields:
+      offset -= self.bit_width(ftype)
+      offsets.append(offset)
+
+    type_id = ty["circt_name"].replace("\\", "\\\\").replace('"', '\\"')
+    out.write(f"/// {ty['circt_name']}\n")
+    out.write(f"struct {name} {{\n")
+    out.write(f"  static constexpr const char *typeID = \"{type_id}\";\n")
+    out.write(f"  static constexpr size_t numBits = {num_bits};\n")
+    out.write(f"  static constexpr size_t numBytes = {(num_bits + 7) // 8};\n")
+    out.write("\n")
+    for (fname, ftype), foffset in zip(fields, offsets):
+      out.write(f"  {self.cpp_type(ftype)} {fname};\n")
+    out.write("\n")
+    for (fname, ftype), foffset in zip(fields, offsets):
+      out.write(f"  static constexpr size_t {fname}Offset = {foffset};\n")
+    out.write("\n")
+
+    out.write("  void pack(uint8_t *bytes, size_t offset = 0) const {\n")
+    for fname, ftype in fields:
+      for line in self._pack(ftype, fname, f"offset + {fname}Offset", 0):
+        out.write(f"    {line}\n")
+    out.write("  }\n\n")
+
+    out.write(f"  static {name} unpack(const uint8_t *bytes, "
+              "size_t offset = 0) {\n")
+    out.write(f"    {name} value;\n")
+    for fname, ftype in fields:
+      for line in self._unpack(ftype, f"value.{fname}",
+                               f"offset + {fname}Offset", 0):
+        out.write(f"    {line}\n")
+    out.write("    return value;\n")
+    out.write("  }\n\n")
+
+    out.write("  esi::MessageData toMessage() const {\n")
+    out.write("    return esi::MessageData::create(numBytes, [&](uint8_t "
+              "*bytes) {\n")
+    out.write("      std::memset(bytes, 0, numBytes);\n")
+    out.write("      pack(bytes);\n")
+    out.write("    });\n")
+    out.write("  }\n\n")
+
+    out.write(f"  static {name} fromMessage(const esi::MessageData &msg) {{\n")
+    out.write("    if (msg.getSize() < numBytes)\n")
+    out.write("      throw std::runtime_error(\"message too small for \" + "
+              "std::string(typeID));\n")
+    out.write("    return unpack(msg.getBytes());\n")
+    out.write("  }\n")
+    out.write("};\n\n")
+
+  def emit(self, out: TextIO, namespace: str):
+    out.write("// Generated by esiaccel.codegen. Do not edit!\n\n")
+    out.write("#pragma once\n\n")
+    out.write("#include \"esi/Serialization.h\"\n\n")
+    out.write("#include <array>\n")
+    out.write("#include <cstdint>\n")
+    out.write("#include <cstring>\n")
+    out.write("#include <stdexcept>\n")
+    out.write("#include <string>\n\n")
+    out.write(f"namespace {namespace} {{\n\n")
+    for name, (kind, ty) in self.types.items():
+      if kind == "struct":
+        fields = [(_identifier(f["name"]), f["type"]) for f in ty["fields"]]
+        self._emit_struct(name, ty, fields, out)
+      elif kind == "alias":
+        out.write(f"/// {ty['circt_name']}\n")
+        out.write(f"using {name} = {self.cpp_type(ty)};\n\n")
+      else:
+        self._emit_struct(name, ty, [("value", ty)], out)
+    out.write(f"}} // namespace {namespace}\n")
+
+
+def run():
+  parser = argparse.ArgumentParser(
+      description="Generate C++ types for the messages in an ESI manifest")
+  parser.add_argument("manifest", help="the JSON manifest of the design")
+  parser.add_argument("-o",
+                      dest="output",
+                      default="-",
+                      help="output header (default: stdout)")
+  parser.add_argument("--namespace",
+                      default="esi_types",
+                      help="C++ namespace of the generated types")
+  args = parser.parse_args()
+
+  with open(args.manifest) as f:
+    manifest = json.load(f)
+  gen = CppGenerator(manifest)
+  for circt_name, reason in gen.skipped.items():
+    sys.stderr.write(
+        f"warning: no C++ type generated for {circt_name}: {reason}\n")
+  if args.output == "-":
+    gen.emit(sys.stdout, args.namespace)
+  else:
+    with open(args.output, "w") as out:
+      gen.emit(out, args.namespace)
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(run())
@@ -50,6 +50,20 @@ bool circt::firrtl::fromOMIRJSON(json::Value &value,
   return true;
 }
 
+/// Convert the fields of a JSON object into the dictionary of an annotation.
+/// Returns null if any field cannot be converted.
+static DictionaryAttr convertAnnotation(json::Object &object, json::Path path,
+                                        MLIRContext *context) {
+  NamedAttrList metadata;
+  for (auto field : object) {
+    auto value = convertJSONToAttribute(context, field.second, path);
+    if (!value)
+      return {};
+    metadata.append(field.first, value);
+  }
+  return DictionaryAttr::get(context, metadata);
+}
+
 /// Deserialize a JSON value into FIRRTL Annotations.  Annotations are
 /// represented as a Target-keyed arrays of attributes.  The input JSON value is
 /// checked, at runtime, to be an array of objects.  Returns true if successful,
@@ -77,19 +91,86 @@ bool circt::firrtl::importAnnotationsFromJSONRaw(
       return false;
     }
 
-    // Build up the Attribute to represent the Annotation
-    NamedAttrList metadata;
-
-    for (auto field : *object) {
-      if (auto value = convertJSONToAttribute(context, field.second, p)) {
-        metadata.append(field.first, value);
-        continue;
-      }
+    auto annotation = convertAnnotation(*object, p, context);
+    if (!annotation)
       return false;
-    }
-
-    annotations.push_back(DictionaryAttr::get(context, metadata));
+    annotations.push_back(annotation);
   }
 
   return true;
 }
+
+/// Return the offset of the ',' or ']' which terminates the array element
+/// starting at `pos`, skipping over nested objects, arrays, and strings.
+/// Returns `StringRef::npos` if the element is not terminated.
+static size_t findEndOfArrayElement(StringRef str, size_t pos) {
+  unsigned depth = 0;
+  for (size_t e = str.size(); pos < e; ++pos) {
+    switch (str[pos]) {
+    case '"':
+      for (++pos; pos < e && str[pos] != '"'; ++pos)
+        if (str[pos] == '\\')
+          ++pos;
+      break;
+    case '{':
+    case '[':
+      ++depth;
+      break;
+    case '}':
+    case ']':
+      if (depth == 0)
+        return str[pos] == ']' ? pos : StringRef::npos;
+      --depth;
+      break;
+    case ',':
+      if (depth == 0)
+        return pos;
+      break;
+    }
+  }
+  return StringRef::npos;
+}
+
+bool circt::firrtl::importAnnotationsFromJSONStream(
+    StringRef annotationsStr, SmallVectorImpl<Attribute> &annotations,
+    MLIRContext *context) {
+  const char *whitespace = " \t\n\r";
+  auto originalSize = annotations.size();
+  auto fail = [&] {
+    annotations.truncate(originalSize);
+    return false;
+  };
+
+  auto str = annotationsStr.ltrim(whitespace);
+  if (!str.consume_front("["))
+    return fail();
+  str = str.ltrim(whitespace);
+  if (str.consume_front("]"))
+    return str.ltrim(whitespace).empty() || fail();
+
+  // Parse and convert each element on its own, such that only the JSON value of
+  // a single annotation is alive at any point in time.
+  while (true) {
+    auto end = findEndOfArrayElement(str, 0);
+    if (end == StringRef::npos)
+      return fail();
+    auto element = json::parse(str.take_front(end));
+    if (!element) {
+      consumeError(element.takeError());
+      return fail();
+    }
+    auto *object = element->getAsObject();
+    if (!object)
+      return fail();
+    json::Path::Root root;
+    auto annotation = convertAnnotation(*object, root, context);
+    if (!annotation)
+      return fail();
+    annotations.push_back(annotation);
+
+    bool isLast = str[end] == ']';
+    str = str.drop_front(end + 1);
+    if (isLast)
+      return str.ltrim(whitespace).empty() || fail();
+  }
+}
@@ -117,6 +117,16 @@ public:
   /// Get an opaque pointer into the lexer state that can be restored later.
   FIRLexerCursor getCursor() const;
 
+  /// Return the buffer being lexed.
+  StringRef getBuffer() const { return curBuffer; }
+
+  /// Move the lexer to the specified position in the buffer, which must be
+  /// the start of a token, and lex the token there.
+  void resetPointer(const char *newPointer) {
+    curPtr = newPointer;
+    lexToken();
+  }
+
 private:
   FIRToken lexTokenImpl();
 
@@ -4585,6 +4585,82 @@ ParseResult FIRStmtParser::parseRegisterWithReset() {
 // FIRCircuitParser
 //===----------------------------------------------------------------------===//
 
+namespace {
+/// A line of the input which starts with a keyword that can begin a top-level
+/// declaration.
+struct DeclarationLine {
+  /// The keyword at the start of the line.
+  const char *keyword;
+  /// The indentation of the keyword, as per `FIRLexer::getIndentation`.
+  unsigned indent;
+};
+} // namespace
+
+/// Find all lines in `chunk`, which must start at the beginning of a line, that
+/// start with a keyword that can begin a top-level declaration. This only looks
+/// at the first word of every line, which is enough to find declarations since
+/// no token spans multiple lines.
+static void findDeclarationLinesInChunk(StringRef chunk,
+                                        SmallVectorImpl<DeclarationLine> &lines) {
+  const char *ptr = chunk.begin();
+  const char *end = chunk.end();
+  auto isVerticalWS = [](char c) {
+    return c == '\n' || c == '\r' || c == '\f' || c == '\v';
+  };
+  while (ptr != end) {
+    // Count the indentation the same way the lexer does.
+    unsigned indent = 0;
+    while (ptr != end && (*ptr == ' ' || *ptr == '\t' || *ptr == ','))
+      ++ptr, ++indent;
+
+    // Check if the first identifier on the line is one of the keywords.
+    const char *word = ptr;
+    while (ptr != end && (llvm::isAlnum(*ptr) || *ptr == '_' || *ptr == '$' ||
+                          *ptr == '-'))
+      ++ptr;
+    bool isDeclaration = llvm::StringSwitch<bool>(StringRef(word, ptr - word))
+                             .Cases("class", "declgroup", "extclass",
+                                    "extmodule", "intmodule", true)
+                             .Cases("layer", "module", "option", "public",
+                                    "type", true)
+                             .Default(false);
+    if (isDeclaration)
+      lines.push_back({word, indent});
+
+    // Move on to the next line.
+    while (ptr != end && !isVerticalWS(*ptr))
+      ++ptr;
+    if (ptr != end)
+      ++ptr;
+  }
+}
+
+/// Find all lines in `buffer` that start with a keyword that can begin a
+/// top-level declaration, ordered by their position. The buffer is split into
+/// chunks of whole lines which are scanned in parallel.
+static SmallVector<DeclarationLine, 0>
+findDeclarationLines(MLIRContext *context, StringRef buffer) {
+  constexpr size_t chunkSize = 1 << 20;
+  SmallVector<StringRef> chunks;
+  while (!buffer.empty()) {
+    auto chunkEnd = std::min(buffer.find_first_of("\n\r\f\v", chunkSize),
+                             buffer.size() - 1) +
+                    1;
+    chunks.push_back(buffer.take_front(chunkEnd));
+    buffer = buffer.drop_front(chunkEnd);
+  }
+
+  SmallVector<SmallVector<DeclarationLine, 0>> chunkLines(chunks.size());
+  mlir::parallelFor(context, 0, chunks.size(), [&](size_t index) {
+    findDeclarationLinesInChunk(chunks[index], chunkLines[index]);
+  });
+
+  SmallVector<DeclarationLine, 0> lines;
+  for (auto &linesInChunk : chunkLines)
+    lines.append(linesInChunk.begin(), linesInChunk.end());
+  return lines;
+}
+
 namespace {
 /// This class implements the outer level of the parser, including things
 /// like circuit and module.
@@ -4645,6 +4721,11 @@ private:
                               DeferredModuleToParse &deferredModule);
 
   SmallVector<DeferredModuleToParse, 0> deferredModules;
+
+  /// The lines of the input which may begin a top-level declaration. These
+  /// are used to skip over the bodies of deferred modules without lexing them.
+  SmallVector<DeclarationLine, 0> declarationLines;
+
   ModuleOp mlirModule;
 };
 
@@ -4652,6 +4733,11 @@ private:
 ParseResult
 FIRCircuitParser::importAnnotationsRaw(SMLoc loc, StringRef annotationsStr,
                                        SmallVectorImpl<Attribute> &attrs) {
+  // Well-formed annotations are converted one at a time, without building the
+  // JSON value of the whole input.  Anything else goes through the full JSON
+  // parser below, which diagnoses the problem.
+  if (importAnnotationsFromJSONStream(annotationsStr, attrs, getContext()))
+    return success();
 
   auto annotations = json::parse(annotationsStr);
   if (auto err = annotations.takeError()) {
@@ -4904,39 +4990,29 @@ ParseResult FIRCircuitParser::parseRefList(ArrayRef<PortInfo> portList,
   return success();
 }
 
-/// We're going to defer parsing this module, so just skip tokens until we
-/// get to the next module or the end of the file.
+/// We're going to defer parsing this module, so just skip ahead to the next
+/// module or the end of the file. Errors in the skipped tokens are reported
+/// when the body is parsed.
 ParseResult FIRCircuitParser::skipToModuleEnd(unsigned indent) {
-  while (true) {
-    switch (getToken().getKind()) {
-
-    // End of file or invalid token will be handled by outer level.
-    case FIRToken::eof:
-    case FIRToken::error:
+  // All module declarations should have the same indentation level. Use this
+  // fact to differentiate between module declarations and usages of "module"
+  // as identifiers.
+  const char *pos = getToken().getLoc().getPointer();
+  auto it = llvm::lower_bound(
+      declarationLines, pos,
+      [](const DeclarationLine &line, const char *pos) {
+        return line.keyword < pos;
+      });
+  for (auto end = declarationLines.end(); it != end; ++it) {
+    if (it->indent == indent) {
+      getLexer().resetPointer(it->keyword);
       return success();
-
-    // If we got to the next top-level declaration, then we're done.
-    case FIRToken::kw_class:
-    case FIRToken::kw_declgroup:
-    case FIRToken::kw_extclass:
-    case FIRToken::kw_extmodule:
-    case FIRToken::kw_intmodule:
-    case FIRToken::kw_module:
-    case FIRToken::kw_public:
-    case FIRToken::kw_layer:
-    case FIRToken::kw_option:
-    case FIRToken::kw_type:
-      // All module declarations should have the same indentation
-      // level. Use this fact to differentiate between module
-      // declarations and usages of "module" as identifiers.
-      if (getIndentation() == indent)
-        return success();
-      [[fallthrough]];
-    default:
-      consumeToken();
-      break;
     }
   }
+
+  // There are no more declarations, so skip to the end of the file.
+  getLexer().resetPointer(getLexer().getBuffer().end());
+  return success();
 }
 
 /// parameter-list ::= parameter*
@@ -5507,6 +5583,13 @@ ParseResult FIRCircuitParser::parseCircuit(
   if (!annos.empty())
     circuit->setAttr(rawAnnotations, b.getArrayAttr(annos));
 
+  // Find the lines which may begin a declaration, such that module bodies can
+  // be skipped without lexing them.
+  auto scanTimer = ts.nest("Scan declarations");
+  declarationLines =
+      findDeclarationLines(getContext(), getLexer().getBuffer());
+  scanTimer.stop();
+
   // A timer to get execution time of module parsing.
   auto parseTimer = ts.nest("Parse modules");
   deferredModules.reserve(16);
@@ -33,7 +33,6 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/Format.h"
-#include "llvm/Support/SHA256.h"
 
 using namespace circt;
 using namespace firrtl;
@@ -49,8 +48,14 @@ llvm::raw_ostream &printHex(llvm::raw_ostream &stream,
   return stream << format_bytes(bytes, std::nullopt, 32) << "\n";
 }
 
-llvm::raw_ostream &printHash(llvm::raw_ostream &stream, llvm::SHA256 &data) {
-  return printHex(stream, data.result());
+/// A structural hash of a module.
+using ModuleHash = std::array<uint64_t, 2>;
+
+llvm::raw_ostream &printHash(llvm::raw_ostream &stream,
+                             const ModuleHash &hash) {
+  ArrayRef<uint8_t> bytes(reinterpret_cast<const uint8_t *>(hash.data()),
+                          sizeof(hash));
+  return printHex(stream, bytes);
 }
 
 llvm::raw_ostream &printHash(llvm::raw_ostream &stream, std::string data) {
@@ -65,8 +70,8 @@ llvm::raw_ostream &printHash(llvm::raw_ostream &stream, std::string data) {
 // names could be replaced during dedup, it's necessary to keep names up-to-date
 // before actually combining them into structural hashes.
 struct ModuleInfo {
-  // SHA256 hash.
-  std::array<uint8_t, 32> structuralHash;
+  // Structural hash.
+  ModuleHash structuralHash;
   // Module names referred by instance op in the module.
   mlir::ArrayAttr referredModuleNames;
 };
@@ -112,27 +117,92 @@ struct StructuralHasherSharedConstants {
   DenseSet<Attribute> nonessentialAttributes;
 };
 
+/// A fast, non-cryptographic 128-bit hash over a stream of 64-bit words. This
+/// runs two independent 64-bit lanes with different seeds and constants: the
+/// xxHash64 round function and a multiply-xorshift round, avalanched with the
+/// xxHash64 and MurmurHash3 finalizers. The lanes do not share state, so the
+/// chance of two distinct modules colliding is about 2^-128, and modules with
+/// equal hashes are deduplicated without comparing them, like they were with
+/// SHA256.
+class WordHasher {
+public:
+  void update(uint64_t word) {
+    low = lowRound(low, word);
+    high = highRound(high, word);
+    ++length;
+  }
+
+  /// Return the hash of all the words seen so far and reset the hasher.
+  ModuleHash final() {
+    ModuleHash hash = {lowAvalanche(low + length * prime5),
+                       highAvalanche(high ^ length * prime4)};
+    *this = WordHasher();
+    return hash;
+  }
+
+private:
+  static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+  static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+  static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+  static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+  static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+  static constexpr uint64_t murmur1 = 0xFF51AFD7ED558CCDULL;
+  static constexpr uint64_t murmur2 = 0xC4CEB9FE1A85EC53ULL;
+
+  static uint64_t rotate(uint64_t value, unsigned amount) {
+    return (value << amount) | (value >> (64 - amount));
+  }
+
+  static uint64_t lowRound(uint64_t acc, uint64_t input) {
+    return rotate(acc + input * prime2, 31) * prime1;
+  }
+
+  static uint64_t highRound(uint64_t acc, uint64_t input) {
+    acc ^= input * murmur1;
+    acc ^= acc >> 29;
+    return rotate(acc, 27) * prime3 + prime4;
+  }
+
+  static uint64_t lowAvalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+
+  static uint64_t highAvalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= murmur1;
+    hash ^= hash >> 33;
+    hash *= murmur2;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  uint64_t low = prime1;
+  uint64_t high = prime5;
+  uint64_t length = 0;
+};
+
 struct StructuralHasher {
   explicit StructuralHasher(const StructuralHasherSharedConstants &constants)
       : constants(constants){};
 
-  std::pair<std::array<uint8_t, 32>, SmallVector<StringAttr>>
+  std::pair<ModuleHash, SmallVector<StringAttr>>
   getHashAndModuleNames(FModuleLike module) {
     update(&(*module));
-    auto hash = sha.final();
+    auto hash = hasher.final();
     return {hash, referredModuleNames};
   }
 
 private:
   void update(const void *pointer) {
-    auto *addr = reinterpret_cast<const uint8_t *>(&pointer);
-    sha.update(ArrayRef<uint8_t>(addr, sizeof pointer));
+    hasher.update(reinterpret_cast<uintptr_t>(pointer));
   }
 
-  void update(size_t value) {
-    auto *addr = reinterpret_cast<const uint8_t *>(&value);
-    sha.update(ArrayRef<uint8_t>(addr, sizeof value));
-  }
+  void update(size_t value) { hasher.update(value); }
 
   void update(TypeID typeID) { update(typeID.getAsOpaquePointer()); }
 
@@ -322,7 +392,7 @@ private:
 
   // This is the actual running hash calculation. This is a stateful element
   // that should be reinitialized after each hash is produced.
-  llvm::SHA256 sha;
+  WordHasher hasher;
 };
 
 //===----------------------------------------------------------------------===//
@@ -745,6 +815,19 @@ struct Equivalence {
     return success();
   }
 
+  /// Returns true if the two modules are structurally equivalent. This is used
+  /// to tell modules apart when testing colliding structural hashes.
+  bool isEquivalent(Operation *a, Operation *b) {
+    hw::InnerSymbolTable aTable(a);
+    hw::InnerSymbolTable bTable(b);
+    ModuleData data(aTable, bTable);
+    // Any differences are reported into a diagnostic which is dropped again.
+    auto diag = mlir::emitError(a->getLoc());
+    auto result = check(diag, data, a, b);
+    diag.abandon();
+    return succeeded(result);
+  }
+
   // NOLINTNEXTLINE(misc-no-recursion)
   void check(InFlightDiagnostic &diag, Operation *a, Operation *b) {
     hw::InnerSymbolTable aTable(a);
@@ -1530,28 +1613,27 @@ void fixupAllModules(InstanceGraph &instanceGraph) {
 
 namespace llvm {
 /// A DenseMapInfo implementation for `ModuleInfo` that is a pair of
-/// llvm::SHA256 hashes, which are represented as std::array<uint8_t, 32>, and
+/// structural hashes, which are represented as std::array<uint64_t, 2>, and
 /// an array of string attributes. This allows us to create a DenseMap with
 /// `ModuleInfo` as keys.
 template <>
 struct DenseMapInfo<ModuleInfo> {
   static inline ModuleInfo getEmptyKey() {
-    std::array<uint8_t, 32> key;
-    std::fill(key.begin(), key.end(), ~0);
+    ModuleHash key;
+    std::fill(key.begin(), key.end(), ~0ULL);
     return {key, DenseMapInfo<mlir::ArrayAttr>::getEmptyKey()};
   }
 
   static inline ModuleInfo getTombstoneKey() {
-    std::array<uint8_t, 32> key;
-    std::fill(key.begin(), key.end(), ~0 - 1);
+    ModuleHash key;
+    std::fill(key.begin(), key.end(), ~0ULL - 1);
     return {key, DenseMapInfo<mlir::ArrayAttr>::getTombstoneKey()};
   }
 
   static unsigned getHashValue(const ModuleInfo &val) {
-    // We assume SHA256 is already a good hash and just truncate down to the
-    // number of bytes we need for DenseMap.
-    unsigned hash;
-    std::memcpy(&hash, val.structuralHash.data(), sizeof(unsigned));
+    // We assume the structural hash is already a good hash and just truncate
+    // down to the number of bytes we need for DenseMap.
+    auto hash = static_cast<unsigned>(val.structuralHash[0]);
 
     // Combine module names.
     return llvm::hash_combine(hash, val.referredModuleNames);
@@ -1586,8 +1668,10 @@ class DedupPass : public DedupBase<DedupPass> {
     // Only modules within the same group may be deduplicated.
     auto dedupGroupClass = StringAttr::get(context, dedupGroupAnnoClass);
 
-    // A map of all the module moduleInfo that we have calculated so far.
-    llvm::DenseMap<ModuleInfo, Operation *> moduleInfoToModule;
+    // A map of all the module moduleInfo that we have calculated so far. When
+    // testing hash collisions, all modules share one hash, and there is one
+    // representative for each group of equivalent modules.
+    llvm::DenseMap<ModuleInfo, SmallVector<Operation *, 1>> moduleInfoToModule;
 
     // We track the name of the module that each module is deduped into, so that
     // we can make sure all modules which are marked "must dedup" with each
@@ -1602,8 +1686,7 @@ class DedupPass : public DedupBase<DedupPass> {
           return cast<FModuleLike>(*node->getModule());
         }));
 
-    SmallVector<std::optional<
-        std::pair<std::array<uint8_t, 32>, SmallVector<StringAttr>>>>
+    SmallVector<std::optional<std::pair<ModuleHash, SmallVector<StringAttr>>>>
         hashesAndModuleNames(modules.size());
     StructuralHasherSharedConstants hasherConstants(&getContext());
 
@@ -1658,6 +1741,8 @@ class DedupPass : public DedupBase<DedupPass> {
           StructuralHasher hasher(hasherConstants);
           // Calculate the hash of the module and referred module names.
           hashesAndModuleNames[idx] = hasher.getHashAndModuleNames(module);
+          if (testHashCollisions)
+            hashesAndModuleNames[idx]->first = {};
           return success();
         });
 
@@ -1688,10 +1773,16 @@ class DedupPass : public DedupBase<DedupPass> {
       ModuleInfo moduleInfo{hashAndModuleNamesOpt->first,
                             mlir::ArrayAttr::get(module.getContext(), names)};
 
-      // Check if there a module with the same hash.
-      auto it = moduleInfoToModule.find(moduleInfo);
-      if (it != moduleInfoToModule.end()) {
-        auto original = cast<FModuleLike>(it->second);
+      // Check if there a module with the same hash. Colliding hashes are only
+      // expected when testing, where the modules are compared to find the one
+      // which is actually the same.
+      auto &candidates = moduleInfoToModule[moduleInfo];
+      auto *it = llvm::find_if(candidates, [&](Operation *candidate) {
+        return !testHashCollisions ||
+               equiv.isEquivalent(cast<FModuleLike>(candidate), module);
+      });
+      if (it != candidates.end()) {
+        auto original = cast<FModuleLike>(*it);
         // Record the group ID of the other module.
         dedupMap[moduleName] = original.getModuleNameAttr();
         deduper.dedup(original, module);
@@ -1704,7 +1795,7 @@ class DedupPass : public DedupBase<DedupPass> {
       // Add the module to a new dedup group.
       dedupMap[moduleName] = moduleName;
       // Record the module info.
-      moduleInfoToModule[moduleInfo] = module;
+      candidates.push_back(module);
     }
 
     // This part verifies that all modules marked by "MustDedup" have been
@@ -9,6 +9,10 @@
 // This implements SCCP:
 // https://www.cs.wustl.edu/~cytron/531Pages/f11/Resources/Papers/cprop.pdf
 //
+// Modules are solved independently and in parallel. In between, the lattice
+// values of ports which changed are propagated across instances, until no
+// module has pending changes anymore.
+//
 //===----------------------------------------------------------------------===//
 
 #include "PassDetails.h"
@@ -174,14 +178,46 @@ static llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
 }
 
 namespace {
-struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
+/// The propagation state of a single module. The lattice values of a module
+/// only depend on the rest of the circuit through its ports, and the ports of
+/// the instances in its body. This allows all modules to be solved in parallel,
+/// while the pass exchanges the changed port lattice values between instances
+/// and the modules they instantiate in between.
+class ModuleSolver {
+public:
+  ModuleSolver(FModuleOp module, InstanceGraph &instanceGraph)
+      : module(module), instanceGraph(instanceGraph) {}
 
-  void runOnOperation() override;
-  void rewriteModuleBody(FModuleOp module);
+  FModuleOp getModule() const { return module; }
+
+  /// Returns true if the body of this module is known to execute.
+  bool isExecutable() const { return executable; }
+
+  /// Mark the body of this module as executable. The body is scanned the next
+  /// time the module is solved. Returns true if it wasn't executable before.
+  bool markExecutable() {
+    if (executable)
+      return false;
+    executable = true;
+    return true;
+  }
+
+  /// Returns true if there are lattice value changes which have not been
+  /// propagated through the module yet.
+  bool hasPendingChanges() const {
+    return !changedLatticeValueWorklist.empty();
+  }
+
+  /// Propagate all pending lattice value changes through the module, until the
+  /// lattice values in it only depend on changes of its ports from outside.
+  void solve();
 
-  /// Returns true if the given block is executable.
-  bool isBlockExecutable(Block *block) const {
-    return executableBlocks.count(block);
+  /// Return the lattice value of the given field, without extending it.
+  LatticeValue getLatticeValue(FieldRef value) const {
+    auto it = latticeValues.find(value);
+    if (it == latticeValues.end())
+      return LatticeValue();
+    return it->second;
   }
 
   bool isOverdefined(FieldRef value) const {
@@ -248,19 +284,22 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
     mergeLatticeValue(result, it->second);
   }
 
-  void mergeLatticeValue(Value result, Value from) {
-    FieldRef fieldRefFrom = getOrCacheFieldRefFromValue(from);
-    FieldRef fieldRefResult = getOrCacheFieldRefFromValue(result);
-    if (!type_isa<FIRRTLType>(result.getType()))
-      return mergeLatticeValue(fieldRefResult, fieldRefFrom);
+  /// Merge the lattice values of the port `from` of another module into the
+  /// instance result `result` which corresponds to it.
+  void mergePortLatticeValue(Value result, const ModuleSolver &fromSolver,
+                             BlockArgument from) {
+    FieldRef fieldRefFrom(from, 0);
+    FieldRef fieldRefResult(result, 0);
+    auto firrtlType = type_dyn_cast<FIRRTLType>(result.getType());
     // Special-handle PropertyType's, walkGroundType's doesn't support.
-    if (type_isa<PropertyType>(result.getType()))
-      return mergeLatticeValue(fieldRefResult, fieldRefFrom);
-    walkGroundTypes(type_cast<FIRRTLType>(result.getType()),
-                    [&](uint64_t fieldID, auto, auto) {
-                      mergeLatticeValue(fieldRefResult.getSubField(fieldID),
-                                        fieldRefFrom.getSubField(fieldID));
-                    });
+    if (!firrtlType || type_isa<PropertyType>(firrtlType))
+      return mergeLatticeValue(fieldRefResult,
+                               fromSolver.getLatticeValue(fieldRefFrom));
+    walkGroundTypes(firrtlType, [&](uint64_t fieldID, auto, auto) {
+      mergeLatticeValue(
+          fieldRefResult.getSubField(fieldID),
+          fromSolver.getLatticeValue(fieldRefFrom.getSubField(fieldID)));
+    });
   }
 
   /// setLatticeValue - This is used when a new LatticeValue is computed for
@@ -299,8 +338,24 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
   LatticeValue getExtendedLatticeValue(FieldRef value, FIRRTLType destType,
                                        bool allowTruncation = false);
 
-  /// Mark the given block as executable.
-  void markBlockExecutable(Block *block);
+  /// The instances of other FModuleOps which were found when the body was
+  /// scanned, and have not been hooked up with the module they instantiate.
+  SmallVector<InstanceOp, 4> newInstances;
+
+  /// The instances of this module in executable modules, together with the
+  /// solver of the module containing them.
+  SmallVector<std::pair<InstanceOp, ModuleSolver *>, 4> instances;
+
+  /// The fields of output ports of this module, and of input ports of
+  /// instances in it, whose lattice values changed since they were last
+  /// propagated to the other side of the instance.
+  SetVector<FieldRef> changedOutputPorts;
+  SetVector<FieldRef> changedInstanceInputs;
+
+private:
+  /// Scan the body of the module, processing nullary operations like wires,
+  /// instances, and constants that only get processed once.
+  void scanBody();
   void markWireOp(WireOp wireOrReg);
   void markMemOp(MemOp mem);
 
@@ -311,6 +366,10 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
   template <typename OpTy>
   void markConstantValueOp(OpTy op);
 
+  /// Remember the given field if it is a port which connects this module to
+  /// another one.
+  void recordPortChange(FieldRef value);
+
   void visitConnectLike(FConnectLike connect, FieldRef changedFieldRef);
   void visitRefSend(RefSendOp send, FieldRef changedFieldRef);
   void visitRefResolve(RefResolveOp resolve, FieldRef changedFieldRef);
@@ -319,16 +378,20 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
   void visitNode(NodeOp node, FieldRef changedFieldRef);
   void visitOperation(Operation *op, FieldRef changedFieldRef);
 
-private:
+  /// The module this solver is working on.
+  FModuleOp module;
+
   /// This is the current instance graph for the Circuit.
-  InstanceGraph *instanceGraph = nullptr;
+  InstanceGraph &instanceGraph;
+
+  /// Whether the body of the module is known to execute, and whether it has
+  /// been scanned already.
+  bool executable = false;
+  bool scanned = false;
 
   /// This keeps track of the current state of each tracked value.
   DenseMap<FieldRef, LatticeValue> latticeValues;
 
-  /// The set of blocks that are known to execute, or are intrinsically live.
-  SmallPtrSet<Block *, 16> executableBlocks;
-
   /// A worklist of values whose LatticeValue recently changed, indicating the
   /// users need to be reprocessed.
   SmallVector<FieldRef, 64> changedLatticeValueWorklist;
@@ -340,10 +403,33 @@ private:
   // the IR.
   llvm::DenseMap<Value, FieldRef> valueToFieldRef;
 
-  /// This keeps track of users the instance results that correspond to output
-  /// ports.
-  DenseMap<BlockArgument, llvm::TinyPtrVector<Value>>
-      resultPortToInstanceResultMapping;
+#ifndef NDEBUG
+  /// A logger used to emit information during the application process.
+  llvm::ScopedPrinter logger{llvm::dbgs()};
+#endif
+};
+
+struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
+
+  void runOnOperation() override;
+  void exchangePortValues(ModuleSolver &solver);
+  void rewriteModuleBody(ModuleSolver &solver);
+
+private:
+  /// Return the solver of the given module, which must be an FModuleOp.
+  ModuleSolver &getSolver(Operation *module) {
+    return *solvers.find(module)->second;
+  }
+
+  /// This is the current instance graph for the Circuit.
+  InstanceGraph *instanceGraph = nullptr;
+
+  /// The solver of each FModuleOp in the circuit.
+  DenseMap<Operation *, std::unique_ptr<ModuleSolver>> solvers;
+
+  /// The modules with pending lattice value changes, which are solved in the
+  /// next round.
+  SetVector<ModuleSolver *> dirtySolvers;
 
 #ifndef NDEBUG
   /// A logger used to emit information during the application process.
@@ -359,46 +445,133 @@ void IMConstPropPass::runOnOperation() {
       { logger.startLine() << "IMConstProp : " << circuit.getName() << "\n"; });
 
   instanceGraph = &getAnalysis<InstanceGraph>();
+  auto modules = circuit.getBodyBlock()->getOps<FModuleOp>();
+  for (auto module : modules)
+    solvers.try_emplace(module,
+                        std::make_unique<ModuleSolver>(module, *instanceGraph));
 
   // Mark the input ports of public modules as being overdefined.
-  for (auto module : circuit.getBodyBlock()->getOps<FModuleOp>()) {
+  for (auto module : modules) {
     if (module.isPublic()) {
-      markBlockExecutable(module.getBodyBlock());
+      auto &solver = getSolver(module);
+      solver.markExecutable();
       for (auto port : module.getBodyBlock()->getArguments())
-        markOverdefined(port);
+        solver.markOverdefined(port);
+      dirtySolvers.insert(&solver);
     }
   }
 
-  // If a value changed lattice state then reprocess any of its users.
-  while (!changedLatticeValueWorklist.empty()) {
-    FieldRef changedFieldRef = changedLatticeValueWorklist.pop_back_val();
-    for (Operation *user : fieldRefToUsers[changedFieldRef]) {
-      if (isBlockExecutable(user->getBlock()))
-        visitOperation(user, changedFieldRef);
-    }
+  // Solve all modules with pending changes in parallel, then propagate the
+  // changed port lattice values across instances. Only the modules whose port
+  // lattice values changed as a result are solved again in the next round.
+  while (!dirtySolvers.empty()) {
+    auto round = dirtySolvers.takeVector();
+    mlir::parallelForEach(circuit.getContext(), round,
+                          [](ModuleSolver *solver) { solver->solve(); });
+    for (auto *solver : round)
+      exchangePortValues(*solver);
   }
 
   // Rewrite any constants in the modules.
-  mlir::parallelForEach(circuit.getContext(),
-                        circuit.getBodyBlock()->getOps<FModuleOp>(),
-                        [&](auto op) { rewriteModuleBody(op); });
+  mlir::parallelForEach(circuit.getContext(), modules,
+                        [&](auto op) { rewriteModuleBody(getSolver(op)); });
 
   // Clean up our state for next time.
   instanceGraph = nullptr;
-  latticeValues.clear();
-  executableBlocks.clear();
-  assert(changedLatticeValueWorklist.empty());
-  fieldRefToUsers.clear();
-  valueToFieldRef.clear();
-  resultPortToInstanceResultMapping.clear();
+  solvers.clear();
+  assert(dirtySolvers.empty());
+}
+
+/// Propagate the port lattice values of `solver` which changed while it was
+/// solved to the other side of the instances they belong to, and queue the
+/// modules affected by this for the next round.
+void IMConstPropPass::exchangePortValues(ModuleSolver &solver) {
+  // Hook up new instances with the module they instantiate, which becomes
+  // executable, and forward the values already known for its output ports.
+  for (auto instance : solver.newInstances) {
+    auto &child = getSolver(instance.getReferencedModule(*instanceGraph));
+    if (child.markExecutable())
+      dirtySolvers.insert(&child);
+    child.instances.push_back({instance, &solver});
+    auto childModule = child.getModule();
+    for (auto port : childModule.getBodyBlock()->getArguments())
+      if (childModule.getPortDirection(port.getArgNumber()) == Direction::Out)
+        solver.mergePortLatticeValue(instance.getResult(port.getArgNumber()),
+                                     child, port);
+  }
+  solver.newInstances.clear();
+  if (solver.hasPendingChanges())
+    dirtySolvers.insert(&solver);
+
+  // Driving an instance input port drives the corresponding port of the
+  // instantiated module.
+  for (auto fieldRef : solver.changedInstanceInputs) {
+    auto result = cast<OpResult>(fieldRef.getValue());
+    auto instance = cast<InstanceOp>(result.getOwner());
+    auto it = solvers.find(instance.getReferencedModule(*instanceGraph));
+    if (it == solvers.end())
+      continue;
+    auto &child = *it->second;
+    child.mergeLatticeValue(
+        FieldRef(child.getModule().getArgument(result.getResultNumber()),
+                 fieldRef.getFieldID()),
+        solver.getLatticeValue(fieldRef));
+    if (child.hasPendingChanges())
+      dirtySolvers.insert(&child);
+  }
+  solver.changedInstanceInputs.clear();
+
+  // Driving an output port propagates the value to each instance of the
+  // module.
+  for (auto fieldRef : solver.changedOutputPorts) {
+    auto portNo = cast<BlockArgument>(fieldRef.getValue()).getArgNumber();
+    auto value = solver.getLatticeValue(fieldRef);
+    for (auto [instance, parent] : solver.instances) {
+      parent->mergeLatticeValue(
+          FieldRef(instance.getResult(portNo), fieldRef.getFieldID()), value);
+      if (parent->hasPendingChanges())
+        dirtySolvers.insert(parent);
+    }
+  }
+  solver.changedOutputPorts.clear();
+}
+
+void ModuleSolver::solve() {
+  assert(executable && "only executable modules can be solved");
+  if (!scanned) {
+    scanned = true;
+    scanBody();
+  }
+
+  // If a value changed lattice state then reprocess any of its users.
+  while (!changedLatticeValueWorklist.empty()) {
+    FieldRef changedFieldRef = changedLatticeValueWorklist.pop_back_val();
+    recordPortChange(changedFieldRef);
+    for (Operation *user : fieldRefToUsers[changedFieldRef])
+      visitOperation(user, changedFieldRef);
+  }
+}
+
+void ModuleSolver::recordPortChange(FieldRef value) {
+  if (auto arg = dyn_cast<BlockArgument>(value.getValue())) {
+    if (arg.getOwner() == module.getBodyBlock() &&
+        module.getPortDirection(arg.getArgNumber()) == Direction::Out)
+      changedOutputPorts.insert(value);
+    return;
+  }
+
+  auto result = cast<OpResult>(value.getValue());
+  if (auto instance = dyn_cast<InstanceOp>(result.getOwner()))
+    if (instance.getPortDirection(result.getResultNumber()) == Direction::In)
+      changedInstanceInputs.insert(value);
 }
 
 /// Return the lattice value for the specified SSA value, extended to the width
 /// of the specified destType.  If allowTruncation is true, then this allows
 /// truncating the lattice value to the specified type.
-LatticeValue IMConstPropPass::getExtendedLatticeValue(FieldRef value,
-                                                      FIRRTLType destType,
-                                                      bool allowTruncation) {
+LatticeValue ModuleSolver::getExtendedLatticeValue(FieldRef value,
+                                                   FIRRTLType destType,
+                                                   bool allowTruncation) {
   // If 'value' hasn't been computed yet, then it is unknown.
   auto it = latticeValues.find(value);
   if (it == latticeValues.end())
@@ -443,13 +616,8 @@ LatticeValue IMConstPropPass::getExtendedLatticeValue(FieldRef value,
   return LatticeValue(IntegerAttr::get(destType.getContext(), resultConstant));
 }
 
-// NOLINTBEGIN(misc-no-recursion)
-/// Mark a block executable if it isn't already.  This does an initial scan of
-/// the block, processing nullary operations like wires, instances, and
-/// constants that only get processed once.
-void IMConstPropPass::markBlockExecutable(Block *block) {
-  if (!executableBlocks.insert(block).second)
-    return; // Already executable.
+void ModuleSolver::scanBody() {
+  auto *block = module.getBodyBlock();
 
   // Mark block arguments, which are module ports, with don't touch as
   // overdefined.
@@ -525,9 +693,8 @@ void IMConstPropPass::markBlockExecutable(Block *block) {
     }
   }
 }
-// NOLINTEND(misc-no-recursion)
 
-void IMConstPropPass::markWireOp(WireOp wire) {
+void ModuleSolver::markWireOp(WireOp wire) {
   auto type = type_dyn_cast<FIRRTLType>(wire.getResult().getType());
   if (!type || hasDontTouch(wire.getResult()) || wire.isForceable()) {
     for (auto result : wire.getResults())
@@ -538,18 +705,18 @@ void IMConstPropPass::markWireOp(WireOp wire) {
   // Otherwise, this starts out as unknown and is upgraded by connects.
 }
 
-void IMConstPropPass::markMemOp(MemOp mem) {
+void ModuleSolver::markMemOp(MemOp mem) {
   for (auto result : mem.getResults())
     markOverdefined(result);
 }
 
 template <typename OpTy>
-void IMConstPropPass::markConstantValueOp(OpTy op) {
+void ModuleSolver::markConstantValueOp(OpTy op) {
   mergeLatticeValue(getOrCacheFieldRefFromValue(op),
                     LatticeValue(op.getValueAttr()));
 }
 
-void IMConstPropPass::markAggregateConstantOp(AggregateConstantOp constant) {
+void ModuleSolver::markAggregateConstantOp(AggregateConstantOp constant) {
   walkGroundTypes(constant.getType(), [&](uint64_t fieldID, auto, auto) {
     mergeLatticeValue(FieldRef(constant, fieldID),
                       LatticeValue(cast<IntegerAttr>(
@@ -557,25 +724,25 @@ void IMConstPropPass::markAggregateConstantOp(AggregateConstantOp constant) {
   });
 }
 
-void IMConstPropPass::markInvalidValueOp(InvalidValueOp invalid) {
+void ModuleSolver::markInvalidValueOp(InvalidValueOp invalid) {
   markOverdefined(invalid.getResult());
 }
 
 /// Instances have no operands, so they are visited exactly once when their
 /// enclosing block is marked live.  This sets up the def-use edges for ports.
-void IMConstPropPass::markInstanceOp(InstanceOp instance) {
+void ModuleSolver::markInstanceOp(InstanceOp instance) {
   // Get the module being reference or a null pointer if this is an extmodule.
-  Operation *op = instance.getReferencedModule(*instanceGraph);
+  Operation *op = instance.getReferencedModule(instanceGraph);
 
   // If this is an extmodule, just remember that any results and inouts are
   // overdefined.
   if (!isa<FModuleOp>(op)) {
-    auto module = dyn_cast<FModuleLike>(op);
+    auto extModule = dyn_cast<FModuleLike>(op);
     for (size_t resultNo = 0, e = instance.getNumResults(); resultNo != e;
          ++resultNo) {
       auto portVal = instance.getResult(resultNo);
       // If this is an input to the extmodule, we can ignore it.
-      if (module.getPortDirection(resultNo) == Direction::In)
+      if (extModule.getPortDirection(resultNo) == Direction::In)
         continue;
 
       // Otherwise this is a result from it or an inout, mark it as overdefined.
@@ -584,33 +751,13 @@ void IMConstPropPass::markInstanceOp(InstanceOp instance) {
     return;
   }
 
-  // Otherwise this is a defined module.
-  auto fModule = cast<FModuleOp>(op);
-  markBlockExecutable(fModule.getBodyBlock());
-
-  // Ok, it is a normal internal module reference.  Populate
-  // resultPortToInstanceResultMapping, and forward any already-computed values.
-  for (size_t resultNo = 0, e = instance.getNumResults(); resultNo != e;
-       ++resultNo) {
-    auto instancePortVal = instance.getResult(resultNo);
-    // If this is an input to the instance, it will
-    // get handled when any connects to it are processed.
-    if (fModule.getPortDirection(resultNo) == Direction::In)
-      continue;
-
-    // Otherwise we have a result from the instance.  We need to forward results
-    // from the body to this instance result's SSA value, so remember it.
-    BlockArgument modulePortVal = fModule.getArgument(resultNo);
-
-    resultPortToInstanceResultMapping[modulePortVal].push_back(instancePortVal);
-
-    // If there is already a value known for modulePortVal make sure to forward
-    // it here.
-    mergeLatticeValue(instancePortVal, modulePortVal);
-  }
+  // Otherwise this is a defined module. It becomes executable and gets its
+  // output ports forwarded to the results of this instance once the pass hooks
+  // up the instance with it, after this module has been solved.
+  newInstances.push_back(instance);
 }
 
-void IMConstPropPass::markObjectOp(ObjectOp obj) {
+void ModuleSolver::markObjectOp(ObjectOp obj) {
   // Mark overdefined for now, not supported.
   markOverdefined(obj);
 }
@@ -629,8 +776,8 @@ getFieldIDOffset(FieldRef changedFieldRef, Type connectionType,
   return {};
 }
 
-void IMConstPropPass::mergeOnlyChangedLatticeValue(Value dest, Value src,
-                                                   FieldRef changedFieldRef) {
+void ModuleSolver::mergeOnlyChangedLatticeValue(Value dest, Value src,
+                                                FieldRef changedFieldRef) {
 
   // Operate on inner type for refs.
   auto destType = dest.getType();
@@ -661,8 +808,8 @@ void IMConstPropPass::mergeOnlyChangedLatticeValue(Value dest, Value src,
                       fieldRefSrc.getSubField(*destOffset));
 }
 
-void IMConstPropPass::visitConnectLike(FConnectLike connect,
-                                       FieldRef changedFieldRef) {
+void ModuleSolver::visitConnectLike(FConnectLike connect,
+                                    FieldRef changedFieldRef) {
   // Operate on inner type for refs.
   auto destType = connect.getDest().getType();
   if (auto refType = type_dyn_cast<RefType>(destType))
@@ -699,15 +846,10 @@ void IMConstPropPass::visitConnectLike(FConnectLike connect,
       return;
 
     // Driving result ports propagates the value to each instance using the
-    // module.
-    if (auto blockArg = dyn_cast<BlockArgument>(fieldRefDest.getValue())) {
-      for (auto userOfResultPort : resultPortToInstanceResultMapping[blockArg])
-        mergeLatticeValue(
-            FieldRef(userOfResultPort, fieldRefDestConnected.getFieldID()),
-            srcValue);
-      // Output ports are wire-like and may have users.
+    // module, once the pass exchanges the changed port values. Output ports
+    // are wire-like and may have users.
+    if (isa<BlockArgument>(fieldRefDest.getValue()))
       return mergeLatticeValue(fieldRefDestConnected, srcValue);
-    }
 
     auto dest = cast<mlir::OpResult>(fieldRefDest.getValue());
 
@@ -717,20 +859,10 @@ void IMConstPropPass::visitConnectLike(FConnectLike connect,
       return mergeLatticeValue(fieldRefDestConnected, srcValue);
 
     // Driving an instance argument port drives the corresponding argument
-    // of the referenced module.
-    if (auto instance = dest.getDefiningOp<InstanceOp>()) {
-      // Update the dest, when its an instance op.
-      mergeLatticeValue(fieldRefDestConnected, srcValue);
-      auto mod = instance.getReferencedModule<FModuleOp>(*instanceGraph);
-      if (!mod)
-        return;
-
-      BlockArgument modulePortVal = mod.getArgument(dest.getResultNumber());
-
-      return mergeLatticeValue(
-          FieldRef(modulePortVal, fieldRefDestConnected.getFieldID()),
-          srcValue);
-    }
+    // of the referenced module, once the pass exchanges the changed port
+    // values.
+    if (dest.getDefiningOp<InstanceOp>())
+      return mergeLatticeValue(fieldRefDestConnected, srcValue);
 
     // Driving a memory result is ignored because these are always treated
     // as overdefined.
@@ -760,21 +892,21 @@ void IMConstPropPass::visitConnectLike(FConnectLike connect,
             hw::FieldIdImpl::getFinalTypeByFieldID(destType, *relativeDest)));
 }
 
-void IMConstPropPass::visitRefSend(RefSendOp send, FieldRef changedFieldRef) {
+void ModuleSolver::visitRefSend(RefSendOp send, FieldRef changedFieldRef) {
   // Send connects the base value (source) to the result (dest).
   return mergeOnlyChangedLatticeValue(send.getResult(), send.getBase(),
                                       changedFieldRef);
 }
 
-void IMConstPropPass::visitRefResolve(RefResolveOp resolve,
-                                      FieldRef changedFieldRef) {
+void ModuleSolver::visitRefResolve(RefResolveOp resolve,
+                                   FieldRef changedFieldRef) {
   // Resolve connects the ref value (source) to result (dest).
   // If writes are ever supported, this will need to work differently!
   return mergeOnlyChangedLatticeValue(resolve.getResult(), resolve.getRef(),
                                       changedFieldRef);
 }
 
-void IMConstPropPass::visitNode(NodeOp node, FieldRef changedFieldRef) {
+void ModuleSolver::visitNode(NodeOp node, FieldRef changedFieldRef) {
   if (hasDontTouch(node.getResult()) || node.isForceable()) {
     for (auto result : node.getResults())
       markOverdefined(result);
@@ -791,7 +923,7 @@ void IMConstPropPass::visitNode(NodeOp node, FieldRef changedFieldRef) {
 ///
 /// This should update the lattice value state for any result values.
 ///
-void IMConstPropPass::visitOperation(Operation *op, FieldRef changedField) {
+void ModuleSolver::visitOperation(Operation *op, FieldRef changedField) {
   // If this is a operation with special handling, handle it specially.
   if (auto connectLikeOp = dyn_cast<FConnectLike>(op))
     return visitConnectLike(connectLikeOp, changedField);
@@ -915,12 +1047,14 @@ void IMConstPropPass::visitOperation(Operation *op, FieldRef changedField) {
   }
 }
 
-void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
-  auto *body = module.getBodyBlock();
+void IMConstPropPass::rewriteModuleBody(ModuleSolver &solver) {
   // If a module is unreachable, just ignore it.
-  if (!executableBlocks.count(body))
+  if (!solver.isExecutable())
     return;
 
+  auto module = solver.getModule();
+  auto *body = module.getBodyBlock();
+
   auto builder = OpBuilder::atBlockBegin(body);
 
   // Separate the constants we insert from the instructions we are folding and
@@ -974,9 +1108,8 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
     };
 
     // TODO: Replace entire aggregate.
-    auto it = latticeValues.find(getFieldRefFromValue(value));
-    if (it == latticeValues.end() || it->second.isOverdefined() ||
-        it->second.isUnknown())
+    auto lattice = solver.getLatticeValue(getFieldRefFromValue(value));
+    if (!lattice.isConstant())
       return false;
 
     // Cannot materialize constants for certain types.
@@ -987,7 +1120,7 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
       return false;
 
     auto cstValue =
-        getConst(it->second.getValue(), value.getType(), value.getLoc());
+        getConst(lattice.getValue(), value.getType(), value.getLoc());
 
     replaceIfNotConnect(cstValue);
     return true;
@@ -1032,7 +1165,7 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
     // Connects to values that we found to be constant can be dropped.
     if (auto connect = dyn_cast<FConnectLike>(op)) {
       if (auto *destOp = connect.getDest().getDefiningOp()) {
-        auto fieldRef = getOrCacheFieldRefFromValue(connect.getDest());
+        auto fieldRef = solver.getOrCacheFieldRefFromValue(connect.getDest());
         // Don't remove a field-level connection even if the src value is
         // constant. If other elements of the aggregate value are not constant,
         // the aggregate value cannot be replaced. We can forward the constant
@@ -1044,7 +1177,8 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
         auto baseType = type_dyn_cast<FIRRTLBaseType>(type);
         if (baseType && !baseType.isGround())
           continue;
-        if (isDeletableWireOrRegOrNode(destOp) && !isOverdefined(fieldRef)) {
+        if (isDeletableWireOrRegOrNode(destOp) &&
+            !solver.isOverdefined(fieldRef)) {
           connect.erase();
           ++numErasedOp;
         }
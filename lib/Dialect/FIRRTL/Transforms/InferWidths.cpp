@@ -27,6 +27,7 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -310,6 +311,40 @@ void Expr::print(llvm::raw_ostream &os) const {
 
 } // namespace
 
+/// Return the expressions an expression depends on. The root depends on all
+/// expressions, and a variable on its constraint.
+static ArrayRef<Expr *> getDependencies(Expr *expr) {
+  return TypeSwitch<Expr *, ArrayRef<Expr *>>(expr)
+      .Case<RootExpr>([](auto *expr) { return ArrayRef(expr->exprs); })
+      .Case<VarExpr>([](auto *expr) -> ArrayRef<Expr *> {
+        if (!expr->constraint)
+          return {};
+        return ArrayRef(&expr->constraint, 1);
+      })
+      .Case<IdExpr, PowExpr>(
+          [](auto *expr) { return ArrayRef(&expr->arg, 1); })
+      .Case<AddExpr, MaxExpr, MinExpr>(
+          [](auto *expr) { return ArrayRef(expr->args); })
+      .Default([](auto) { return ArrayRef<Expr *>(); });
+}
+
+// Allow the dependencies between expressions to be traversed as a graph.
+namespace llvm {
+template <>
+struct GraphTraits<Expr *> {
+  using NodeRef = Expr *;
+  using ChildIteratorType = ArrayRef<Expr *>::iterator;
+
+  static NodeRef getEntryNode(NodeRef node) { return node; }
+  static ChildIteratorType child_begin(NodeRef node) {
+    return getDependencies(node).begin();
+  }
+  static ChildIteratorType child_end(NodeRef node) {
+    return getDependencies(node).end();
+  }
+};
+} // namespace llvm
+
 //===----------------------------------------------------------------------===//
 // Fast bump allocator with optional interning
 //===----------------------------------------------------------------------===//
@@ -642,7 +677,7 @@ public:
   }
 
   void dumpConstraints(llvm::raw_ostream &os);
-  LogicalResult solve();
+  LogicalResult solve(MLIRContext *context);
 
   using ContextInfo = DenseMap<Expr *, llvm::SmallSetVector<FieldRef, 1>>;
   const ContextInfo &getContextInfo() const { return info; }
@@ -696,6 +731,16 @@ private:
                       SmallPtrSetImpl<Expr *> &seenVars,
                       InFlightDiagnostic *reportInto = nullptr,
                       unsigned indent = 1);
+
+  /// The strongly connected component of the dependency graph of expressions
+  /// each expression belongs to, numbered such that the components an
+  /// expression depends on have smaller numbers.
+  DenseMap<Expr *, unsigned> sccIndices;
+
+  /// The inequalities computed by `checkCycles` for expressions which are
+  /// reached from a different SCC, and are thus independent of the variable
+  /// being checked.
+  DenseMap<Expr *, LinIneq> checkedExprs;
 };
 
 } // namespace
@@ -733,6 +778,20 @@ LinIneq ConstraintSolver::checkCycles(VarExpr *var, Expr *expr,
                                       SmallPtrSetImpl<Expr *> &seenVars,
                                       InFlightDiagnostic *reportInto,
                                       unsigned indent) {
+  // An operand in a different SCC than `expr` can neither reach `var` nor any
+  // of the `seenVars`, which all reach `expr`. Its inequality is the same for
+  // every variable, so compute it only once.
+  auto recurse = [&](Expr *operand) {
+    if (reportInto || sccIndices.lookup(operand) == sccIndices.lookup(expr))
+      return checkCycles(var, operand, seenVars, reportInto, indent + 1);
+    auto it = checkedExprs.find(operand);
+    if (it != checkedExprs.end())
+      return it->second;
+    auto ineq = checkCycles(var, operand, seenVars, reportInto, indent + 1);
+    checkedExprs.try_emplace(operand, ineq);
+    return ineq;
+  };
+
   auto ineq =
       TypeSwitch<Expr *, LinIneq>(expr)
           .Case<KnownExpr>([&](auto *expr) { return LinIneq(*expr->solution); })
@@ -749,40 +808,29 @@ LinIneq ConstraintSolver::checkCycles(VarExpr *var, Expr *expr,
             if (!expr->constraint)
               // Count unconstrained variables as `x >= 0`.
               return LinIneq(0);
-            auto l = checkCycles(var, expr->constraint, seenVars, reportInto,
-                                 indent + 1);
+            auto l = recurse(expr->constraint);
             seenVars.erase(expr);
             return l;
           })
-          .Case<IdExpr>([&](auto *expr) {
-            return checkCycles(var, expr->arg, seenVars, reportInto,
-                               indent + 1);
-          })
+          .Case<IdExpr>([&](auto *expr) { return recurse(expr->arg); })
           .Case<PowExpr>([&](auto *expr) {
             // If we can evaluate `2**arg` to a sensible constant, do
             // so. This is the case if a == 0 and c < 31 such that 2**c is
             // representable.
-            auto arg =
-                checkCycles(var, expr->arg, seenVars, reportInto, indent + 1);
+            auto arg = recurse(expr->arg);
             if (arg.rec_scale != 0 || arg.nonrec_bias < 0 ||
                 arg.nonrec_bias >= 31)
               return LinIneq::unsat();
             return LinIneq(1 << arg.nonrec_bias); // x >= 2**arg
           })
           .Case<AddExpr>([&](auto *expr) {
-            return LinIneq::add(
-                checkCycles(var, expr->lhs(), seenVars, reportInto, indent + 1),
-                checkCycles(var, expr->rhs(), seenVars, reportInto,
-                            indent + 1));
+            return LinIneq::add(recurse(expr->lhs()), recurse(expr->rhs()));
           })
           .Case<MaxExpr, MinExpr>([&](auto *expr) {
             // Combine the inequalities of the LHS and RHS into a single overly
             // pessimistic inequality. We treat `MinExpr` the same as `MaxExpr`,
             // since `max(a,b)` is an upper bound to `min(a,b)`.
-            return LinIneq::max(
-                checkCycles(var, expr->lhs(), seenVars, reportInto, indent + 1),
-                checkCycles(var, expr->rhs(), seenVars, reportInto,
-                            indent + 1));
+            return LinIneq::max(recurse(expr->lhs()), recurse(expr->rhs()));
           })
           .Default([](auto) { return LinIneq::unsat(); });
 
@@ -843,8 +891,11 @@ computeBinary(ExprSolution lhs, ExprSolution rhs,
 /// and a boolean indicating whether a recursion was detected. This may be used
 /// to memoize the result of expressions in case they were not involved in a
 /// cycle (which may alter their value from the perspective of a variable).
+/// Expressions for which `isSolved` returns true are taken as they are, even if
+/// they have no solution.
 static ExprSolution solveExpr(Expr *expr, SmallPtrSetImpl<Expr *> &seenVars,
-                              unsigned defaultWorklistSize) {
+                              unsigned defaultWorklistSize,
+                              llvm::function_ref<bool(Expr *)> isSolved) {
 
   struct Frame {
     Expr *expr;
@@ -885,13 +936,14 @@ static ExprSolution solveExpr(Expr *expr, SmallPtrSetImpl<Expr *> &seenVars,
     };
 
     // See if we have a memoized result we can return.
-    if (frame.expr->solution) {
+    if (frame.expr->solution || isSolved(frame.expr)) {
       LLVM_DEBUG({
         if (!isa<KnownExpr>(frame.expr))
           llvm::dbgs().indent(indent * 2) << "- Cached " << *frame.expr << " = "
-                                          << *frame.expr->solution << "\n";
+                                          << frame.expr->solution << "\n";
       });
-      setSolution(ExprSolution{*frame.expr->solution, false});
+      solvedExprs[frame.expr] = ExprSolution{frame.expr->solution, false};
+      worklist.pop_back();
       continue;
     }
 
@@ -909,14 +961,6 @@ static ExprSolution solveExpr(Expr *expr, SmallPtrSetImpl<Expr *> &seenVars,
         .Case<VarExpr>([&](auto *expr) {
           if (solvedExprs.contains(expr->constraint)) {
             auto solution = solvedExprs[expr->constraint];
-            // If we've solved the upper bound already, store the solution.
-            // This will be explicitly solved for later if not computed as
-            // part of the solving that resolved this constraint.
-            // This should only happen if somehow the constraint is
-            // solved before visiting this expression, so that our upperBound
-            // was not added to the worklist such that it was handled first.
-            if (expr->upperBound && solvedExprs.contains(expr->upperBound))
-              expr->upperBoundSolution = solvedExprs[expr->upperBound].first;
             seenVars.erase(expr);
             // Constrain variables >= 0.
             if (solution.first && *solution.first < 0)
@@ -934,8 +978,6 @@ static ExprSolution solveExpr(Expr *expr, SmallPtrSetImpl<Expr *> &seenVars,
             return setSolution(ExprSolution{std::nullopt, true});
 
           worklist.push_back({expr->constraint, indent + 1});
-          if (expr->upperBound)
-            worklist.push_back({expr->upperBound, indent + 1});
         })
         .Case<IdExpr>([&](auto *expr) {
           if (solvedExprs.contains(expr->arg))
@@ -987,16 +1029,105 @@ static ExprSolution solveExpr(Expr *expr, SmallPtrSetImpl<Expr *> &seenVars,
   return solvedExprs[expr];
 }
 
-/// Solve the constraint problem. This is a very simple implementation that
-/// does not fully solve the problem if there are weird dependency cycles
-/// present.
-LogicalResult ConstraintSolver::solve() {
+/// Compute the value of an expression which is not part of a cycle, once all of
+/// its operands have been solved. This matches what `solveExpr` computes for
+/// the expression, without traversing its operands again.
+static void solveAcyclicExpr(Expr *expr) {
+  auto operand = [](Expr *expr) { return ExprSolution{expr->solution, false}; };
+  auto solution =
+      TypeSwitch<Expr *, ExprSolution>(expr)
+          .Case<VarExpr>([&](auto *expr) {
+            // Unconstrained variables produce no solution.
+            if (!expr->constraint)
+              return ExprSolution{std::nullopt, false};
+            // Constrain variables >= 0.
+            auto solution = operand(expr->constraint);
+            if (solution.first && *solution.first < 0)
+              solution.first = 0;
+            return solution;
+          })
+          .Case<IdExpr>([&](auto *expr) { return operand(expr->arg); })
+          .Case<PowExpr>([&](auto *expr) {
+            return computeUnary(operand(expr->arg),
+                                [](int32_t arg) { return 1 << arg; });
+          })
+          .Case<AddExpr>([&](auto *expr) {
+            return computeBinary(
+                operand(expr->lhs()), operand(expr->rhs()),
+                [](int32_t lhs, int32_t rhs) { return lhs + rhs; });
+          })
+          .Case<MaxExpr>([&](auto *expr) {
+            return computeBinary(
+                operand(expr->lhs()), operand(expr->rhs()),
+                [](int32_t lhs, int32_t rhs) { return std::max(lhs, rhs); });
+          })
+          .Case<MinExpr>([&](auto *expr) {
+            return computeBinary(
+                operand(expr->lhs()), operand(expr->rhs()),
+                [](int32_t lhs, int32_t rhs) { return std::min(lhs, rhs); });
+          })
+          .Default([&](auto *expr) { return operand(expr); });
+  expr->solution = solution.first;
+}
+
+/// Solve the constraint problem. The dependency graph of the expressions is
+/// decomposed into strongly connected components. Acyclic parts are solved in a
+/// single pass in dependency order, and only the variables on a cycle are
+/// solved by breaking the recursion, which does not fully solve the problem if
+/// there are weird dependency cycles present. Components which do not depend on
+/// each other are solved in parallel.
+LogicalResult ConstraintSolver::solve(MLIRContext *context) {
   LLVM_DEBUG({
     llvm::dbgs() << "\n";
     debugHeader("Constraints") << "\n\n";
     dumpConstraints(llvm::dbgs());
   });
 
+  // Number the SCCs such that every SCC comes after the ones it depends on, and
+  // group them into levels of SCCs which do not depend on each other. The root
+  // depends on all expressions and comes last, in an SCC of its own.
+  struct SCC {
+    /// The expression of an acyclic SCC.
+    Expr *expr;
+    bool hasCycle;
+  };
+  SmallVector<SCC> sccs;
+  SmallVector<unsigned> sccLevels;
+  SmallVector<SmallVector<unsigned>> levels;
+  for (auto it = llvm::scc_begin(static_cast<Expr *>(&root)); !it.isAtEnd();
+       ++it) {
+    const auto &nodes = *it;
+    if (nodes.front() == &root)
+      break;
+    unsigned index = sccs.size();
+    for (auto *expr : nodes)
+      sccIndices[expr] = index;
+    unsigned level = 0;
+    for (auto *expr : nodes)
+      for (auto *operand : getDependencies(expr)) {
+        unsigned operandIndex = sccIndices.lookup(operand);
+        if (operandIndex != index)
+          level = std::max(level, sccLevels[operandIndex] + 1);
+      }
+    sccs.push_back({nodes.front(), it.hasCycle()});
+    sccLevels.push_back(level);
+    if (levels.size() <= level)
+      levels.resize(level + 1);
+    levels[level].push_back(index);
+  }
+
+  // Collect the expressions on each cycle in the order they were created.
+  DenseMap<unsigned, SmallVector<Expr *>> cycles;
+  for (auto *expr : exprs) {
+    unsigned index = sccIndices.lookup(expr);
+    if (sccs[index].hasCycle)
+      cycles[index].push_back(expr);
+  }
+  LLVM_DEBUG(llvm::dbgs() << "\nDecomposed " << exprs.size()
+                          << " expressions into " << sccs.size() << " SCCs ("
+                          << cycles.size() << " cyclic) in " << levels.size()
+                          << " levels\n");
+
   // Ensure that there are no adverse cycles around.
   LLVM_DEBUG({
     llvm::dbgs() << "\n";
@@ -1015,7 +1146,9 @@ LogicalResult ConstraintSolver::solve() {
 
     // Canonicalize the variable's constraint expression into a form that allows
     // us to easily determine if any recursion leads to an unsatisfiable
-    // constraint. The `seenVars` set acts as a recursion breaker.
+    // constraint. The `seenVars` set acts as a recursion breaker. Variables
+    // which are not on a cycle only need this to catch constraints which
+    // cannot be evaluated, and mostly hit the inequalities computed before.
     seenVars.insert(var);
     auto ineq = checkCycles(var, var->constraint, seenVars);
     seenVars.clear();
@@ -1053,18 +1186,61 @@ LogicalResult ConstraintSolver::solve() {
       seenVars.clear();
     }
   }
+  checkedExprs.clear();
 
   // If there were cycles, return now to avoid complaining to the user about
   // dependent widths not being inferred.
   if (anyFailed)
     return failure();
 
-  // Iterate over the constraint variables and solve each.
+  // Solve the SCCs level by level. Every SCC only writes the solutions of its
+  // own expressions, and only reads those of SCCs on lower levels.
   LLVM_DEBUG({
     llvm::dbgs() << "\n";
     debugHeader("Solving constraints") << "\n\n";
   });
-  unsigned defaultWorklistSize = exprs.size() / 2;
+  auto solveSCC = [&](unsigned index) {
+    if (!sccs[index].hasCycle)
+      return solveAcyclicExpr(sccs[index].expr);
+
+    // Solve the variables on the cycle one after the other, each of them by
+    // breaking the recursion on itself. The expressions outside of the cycle
+    // are already solved.
+    const auto &cycle = cycles.find(index)->second;
+    auto isSolved = [&](Expr *expr) {
+      return sccIndices.lookup(expr) != index;
+    };
+    SmallPtrSet<Expr *, 16> visitedVars;
+    for (auto *expr : cycle) {
+      auto *var = dyn_cast<VarExpr>(expr);
+      if (!var)
+        continue;
+      LLVM_DEBUG(llvm::dbgs() << "- Solving " << *var << " >= "
+                              << *var->constraint << "\n");
+      visitedVars.insert(var);
+      auto solution =
+          solveExpr(var->constraint, visitedVars, cycle.size(), isSolved);
+      visitedVars.clear();
+
+      // Constrain variables >= 0.
+      if (solution.first && *solution.first < 0)
+        solution.first = 0;
+      var->solution = solution.first;
+    }
+
+    // Solve the remaining expressions on the cycle, which may be used outside
+    // of it, now that the variables are known.
+    for (auto *expr : cycle) {
+      if (isa<VarExpr>(expr) || expr->solution)
+        continue;
+      solveExpr(expr, visitedVars, cycle.size(), isSolved);
+      visitedVars.clear();
+    }
+  };
+  for (auto &level : levels)
+    mlir::parallelForEach(context, level, solveSCC);
+
+  // Check the solutions of the variables.
   for (auto *expr : exprs) {
     // Only work on variables.
     auto *var = dyn_cast<VarExpr>(expr);
@@ -1079,36 +1255,27 @@ LogicalResult ConstraintSolver::solve() {
       continue;
     }
 
-    // Compute the value for the variable.
-    LLVM_DEBUG(llvm::dbgs()
-               << "- Solving " << *var << " >= " << *var->constraint << "\n");
-    seenVars.insert(var);
-    auto solution = solveExpr(var->constraint, seenVars, defaultWorklistSize);
-    // Compute the upperBound if there is one and haven't already.
-    if (var->upperBound && !var->upperBoundSolution)
-      var->upperBoundSolution =
-          solveExpr(var->upperBound, seenVars, defaultWorklistSize).first;
-    seenVars.clear();
-
-    // Constrain variables >= 0.
-    if (solution.first && *solution.first < 0)
-      solution.first = 0;
-    var->solution = solution.first;
+    // Evaluate the upper bound for the solution.
+    if (var->upperBound)
+      var->upperBoundSolution = var->upperBound->solution;
 
     // In case the width could not be inferred, complain to the user. This might
     // be the case if the width depends on an unconstrained variable.
-    if (!solution.first) {
-      LLVM_DEBUG(llvm::dbgs() << "  - UNSOLVED " << *var << "\n");
+    if (!var->solution) {
+      LLVM_DEBUG(llvm::dbgs() << "- UNSOLVED " << *var << "\n");
       emitUninferredWidthError(var);
       anyFailed = true;
       continue;
     }
-    LLVM_DEBUG(llvm::dbgs()
-               << "  = Solved " << *var << " = " << solution.first << " ("
-               << (solution.second ? "cycle broken" : "unique") << ")\n");
+    LLVM_DEBUG(llvm::dbgs() << "- Solved " << *var << " = " << var->solution
+                            << " ("
+                            << (sccs[sccIndices.lookup(var)].hasCycle
+                                    ? "cycle broken"
+                                    : "unique")
+                            << ")\n");
 
     // Check if the solution we have found violates an upper bound.
-    if (var->upperBoundSolution && var->upperBoundSolution < *solution.first) {
+    if (var->upperBoundSolution && var->upperBoundSolution < *var->solution) {
       LLVM_DEBUG(llvm::dbgs() << "  ! Unsatisfiable " << *var
                               << " <= " << var->upperBoundSolution << "\n");
       emitUninferredWidthError(var);
@@ -2355,7 +2522,7 @@ void InferWidthsPass::runOnOperation() {
   }
 
   // Solve the constraints.
-  if (failed(solver.solve())) {
+  if (failed(solver.solve(&getContext()))) {
     signalPassFailure();
     return;
   }
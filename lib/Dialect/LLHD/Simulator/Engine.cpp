@@ -12,14 +12,34 @@
 
 #include "circt/Dialect/LLHD/Simulator/Engine.h"
 #include "circt/Conversion/LLHDToLLVM.h"
+#include "signals-runtime-wrappers.h"
 
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Threading.h"
 
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/TargetSelect.h"
 
 using namespace circt::llhd::sim;
 
+/// Insert `width` bits from `data` into `words` at the given bit offset. Works
+/// one 64 bit word of the drive at a time, such that no intermediate APInt has
+/// to be materialized.
+static void insertBits(uint64_t *words, unsigned offset, const uint64_t *data,
+                       unsigned width) {
+  for (unsigned i = 0, e = llvm::divideCeil(width, 64); i < e; ++i) {
+    unsigned numBits = std::min(width - i * 64, 64U);
+    uint64_t mask = llvm::maskTrailingOnes<uint64_t>(numBits);
+    unsigned pos = offset + i * 64;
+    unsigned index = pos / 64, shift = pos % 64;
+    words[index] = (words[index] & ~(mask << shift)) | (data[i] << shift);
+    if (shift != 0 && shift + numBits > 64)
+      words[index + 1] = (words[index + 1] & ~(mask >> (64 - shift))) |
+                         (data[i] >> (64 - shift));
+  }
+}
+
 Engine::Engine(
     llvm::raw_ostream &out, ModuleOp module,
     llvm::function_ref<mlir::LogicalResult(mlir::ModuleOp)> mlirTransformer,
@@ -87,12 +107,17 @@ int Engine::simulate(int n, uint64_t maxTime) {
   }
 
   // Add a dummy event to get the simulation started.
-  state->queue.push_back(Slot(Time()));
-  ++state->queue.events;
+  state->queue.getOrCreateSlot(Time());
 
   // Keep track of the instances that need to wakeup.
   llvm::SmallVector<unsigned, 8> wakeupQueue;
 
+  // Scratch space for applying the changes to a signal's value.
+  llvm::SmallVector<uint64_t, 4> buffer;
+
+  // The events scheduled by each instance when running them in parallel.
+  std::vector<DeferredEvents> deferredEvents;
+
   // Add all instances to the wakeup queue for the first run and add the jitted
   // function pointers to all of the instances to make them readily available.
   for (size_t i = 0, e = state->instances.size(); i < e; ++i) {
@@ -107,7 +132,7 @@ int Engine::simulate(int n, uint64_t maxTime) {
   }
 
   int cycle = 0;
-  while (state->queue.events > 0) {
+  while (!state->queue.empty()) {
     const auto &pop = state->queue.top();
 
     // Interrupt the simulation if a stop condition is met.
@@ -127,37 +152,28 @@ int Engine::simulate(int n, uint64_t maxTime) {
     while (i < e) {
       const auto sigIndex = pop.changes[i].first;
       auto &curr = state->signals[sigIndex];
-      APInt buff(curr.getSize() * 8, 0);
-      llvm::LoadIntFromMemory(buff, curr.getValue(), curr.getSize());
+      buffer.assign(llvm::divideCeil(curr.getSize(), 8), 0);
+      std::memcpy(buffer.data(), curr.getValue(), curr.getSize());
 
       // Apply the changes to the buffer until we reach the next signal.
       while (i < e && pop.changes[i].first == sigIndex) {
-        const auto &change = pop.buffers[pop.changes[i].second];
-        const auto offset = change.first;
-        const auto &drive = change.second;
-        if (drive.getBitWidth() < buff.getBitWidth())
-          buff.insertBits(drive, offset);
-        else
-          buff = drive;
-
+        const auto &drive = pop.buffers[pop.changes[i].second];
+        insertBits(buffer.data(), drive.offset, pop.getDriveData(drive),
+                   drive.width);
         ++i;
       }
 
-      if (!curr.updateWhenChanged(buff.getRawData()))
+      if (!curr.updateWhenChanged(buffer.data()))
         continue;
 
       // Add sensitive instances.
-      for (auto inst : curr.getTriggeredInstanceIndices()) {
+      const auto &triggered = curr.getTriggeredInstanceIndices();
+      const auto &senseIndices = curr.getTriggeredSenseIndices();
+      for (size_t j = 0, je = triggered.size(); j < je; ++j) {
+        auto inst = triggered[j];
         // Skip if the process is not currently sensible to the signal.
         if (!state->instances[inst].isEntity) {
-          const auto &sensList = state->instances[inst].sensitivityList;
-          auto it = std::find_if(sensList.begin(), sensList.end(),
-                                 [sigIndex](const SignalDetail &sig) {
-                                   return sig.globalIndex == sigIndex;
-                                 });
-          if (sensList.end() != it &&
-              state->instances[inst].procState->senses[it - sensList.begin()] ==
-                  0)
+          if (state->instances[inst].procState->senses[senseIndices[j]] == 0)
             continue;
 
           // Invalidate scheduled wakeup
@@ -184,7 +200,7 @@ int Engine::simulate(int n, uint64_t maxTime) {
                       wakeupQueue.end());
 
     // Run the instances present in the wakeup queue.
-    for (auto i : wakeupQueue) {
+    auto runInstance = [&](unsigned i) {
       auto &inst = state->instances[i];
       auto signalTable = inst.sensitivityList.data();
 
@@ -197,6 +213,24 @@ int Engine::simulate(int n, uint64_t maxTime) {
       }
       // Run the unit.
       (*inst.unitFPtr)(args.data());
+    };
+    if (parallel && wakeupQueue.size() > 1) {
+      // Instances only read the current signal values and schedule future
+      // events, so they can run concurrently as long as the events they
+      // schedule are applied in the order of a serial run.
+      if (deferredEvents.size() < wakeupQueue.size())
+        deferredEvents.resize(wakeupQueue.size());
+      mlir::parallelFor(module.getContext(), 0, wakeupQueue.size(),
+                        [&](size_t i) {
+                          setDeferredEvents(&deferredEvents[i]);
+                          runInstance(wakeupQueue[i]);
+                          setDeferredEvents(nullptr);
+                        });
+      for (size_t i = 0, e = wakeupQueue.size(); i < e; ++i)
+        deferredEvents[i].applyTo(state->queue);
+    } else {
+      for (auto i : wakeupQueue)
+        runInstance(i);
     }
 
     // Clear wakeup queue.
@@ -236,9 +270,8 @@ void Engine::buildLayout(ModuleOp module) {
   // Add triggers to signals.
   for (size_t i = 0, e = state->instances.size(); i < e; ++i) {
     auto &inst = state->instances[i];
-    for (auto trigger : inst.sensitivityList) {
-      state->signals[trigger.globalIndex].pushInstanceIndex(i);
-    }
+    for (auto [senseIndex, trigger] : llvm::enumerate(inst.sensitivityList))
+      state->signals[trigger.globalIndex].pushInstanceIndex(i, senseIndex);
   }
 }
 
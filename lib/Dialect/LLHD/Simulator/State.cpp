@@ -14,8 +14,10 @@
 #include "circt/Dialect/LLHD/Simulator/State.h"
 
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstring>
 #include <string>
 
 using namespace llvm;
@@ -72,33 +74,46 @@ bool Slot::operator>(const Slot &rhs) const { return rhs.time < time; }
 
 void Slot::insertChange(int index, int bitOffset, uint8_t *bytes,
                         unsigned width) {
-  // Get the amount of 64 bit words required to store the value in an APInt.
-  auto size = llvm::divideCeil(width, 8);
-
-  APInt buffer(width, 0);
-  llvm::LoadIntFromMemory(buffer, bytes, size);
-  auto offsetBufferPair = std::make_pair(bitOffset, buffer);
-
-  if (changesSize >= buffers.size()) {
-    // Create a new change buffer if we don't have any unused one available for
-    // reuse.
-    buffers.push_back(offsetBufferPair);
-  } else {
-    // Reuse the first available buffer.
-    buffers[changesSize] = offsetBufferPair;
-  }
-
-  // Map the signal index to the change buffer so we can retrieve
-  // it after sorting.
+  // Copy the driven bytes into zero-initialized words and clear the bits
+  // beyond the drive's width.
+  auto numWords = llvm::divideCeil(width, 64);
+  auto data = driveData.size();
+  driveData.append(numWords, 0);
+  std::memcpy(&driveData[data], bytes, llvm::divideCeil(width, 8));
+  if (width % 64 != 0)
+    driveData.back() &= llvm::maskTrailingOnes<uint64_t>(width % 64);
+  buffers.push_back({static_cast<unsigned>(bitOffset), width,
+                     static_cast<unsigned>(data)});
+
+  // Map the signal index to the drive so we can retrieve it after sorting.
   changes.push_back(std::make_pair(index, changesSize));
   ++changesSize;
+  sorted = false;
 }
 
 void Slot::insertChange(unsigned inst) { scheduled.push_back(inst); }
 
+void Slot::sortChanges() {
+  if (sorted)
+    return;
+  llvm::sort(changes.begin(), changes.begin() + changesSize);
+  sorted = true;
+}
+
+void Slot::reset() {
+  changesSize = 0;
+  sorted = true;
+  scheduled.clear();
+  changes.clear();
+  buffers.clear();
+  driveData.clear();
+  time = Time();
+}
+
 //===----------------------------------------------------------------------===//
 // UpdateQueue
 //===----------------------------------------------------------------------===//
+
 void UpdateQueue::insertOrUpdate(Time time, int index, int bitOffset,
                                  uint8_t *bytes, unsigned width) {
   auto &slot = getOrCreateSlot(time);
@@ -111,84 +126,73 @@ void UpdateQueue::insertOrUpdate(Time time, unsigned inst) {
 }
 
 Slot &UpdateQueue::getOrCreateSlot(Time time) {
-  auto &top = begin()[topSlot];
-
-  // Directly add to top slot.
-  if (!top.unused && time == top.time) {
-    return top;
-  }
-
-  // We need to search through the queue for an existing slot only if we're
-  // spawning an event later than the top slot. Adding to an existing slot
-  // scheduled earlier than the top slot should never happens, as then it should
-  // be the top.
-  if (events > 0 && top.time < time) {
-    for (size_t i = 0, e = size(); i < e; ++i) {
-      if (time == begin()[i].time) {
-        return begin()[i];
-      }
-    }
+  // Directly add to the most recently accessed slot if it is still pending.
+  if (lastSlot < slots.size() && slots[lastSlot].time == time)
+    return slots[lastSlot];
+
+  auto [it, inserted] = pending.try_emplace(time, 0);
+  if (!inserted) {
+    lastSlot = it->second;
+    return slots[lastSlot];
   }
 
-  // Spawn new event using an existing slot.
+  // Spawn the new event using an existing slot if one is available, or
+  // generate a new one otherwise.
   if (!unused.empty()) {
-    auto firstUnused = unused.pop_back_val();
-    auto &newSlot = begin()[firstUnused];
-    newSlot.unused = false;
-    newSlot.time = time;
-
-    // Update the top of the queue either if it is currently unused or the new
-    // timestamp is earlier than it.
-    if (top.unused || time < top.time)
-      topSlot = firstUnused;
-
-    ++events;
-    return newSlot;
+    lastSlot = unused.pop_back_val();
+    slots[lastSlot].time = time;
+  } else {
+    lastSlot = slots.size();
+    slots.push_back(Slot(time));
   }
-
-  // We do not have pre-allocated slots available, generate a new one.
-  push_back(Slot(time));
-
-  // Update the top of the queue either if it is currently unused or the new
-  // timestamp is earlier than it.
-  if (top.unused || time < top.time)
-    topSlot = size() - 1;
-
-  ++events;
-  return back();
+  it->second = lastSlot;
+  return slots[lastSlot];
 }
 
 const Slot &UpdateQueue::top() {
-  assert(topSlot < size() && "top is pointing out of bounds!");
-
-  // Sort the changes of the top slot such that all changes to the same signal
-  // are in succession.
-  auto &top = begin()[topSlot];
-  llvm::sort(top.changes.begin(), top.changes.begin() + top.changesSize);
+  assert(!pending.empty() && "the event queue is empty");
+  auto &top = slots[pending.begin()->second];
+  top.sortChanges();
   return top;
 }
 
 void UpdateQueue::pop() {
-  // Reset internal structures and decrease the event counter.
-  auto &curr = begin()[topSlot];
-  curr.unused = true;
-  curr.changesSize = 0;
-  curr.scheduled.clear();
-  curr.changes.clear();
-  curr.time = Time();
-  --events;
-
-  // Add to unused slots list for easy retrieval.
-  unused.push_back(topSlot);
-
-  // Update the current top of the queue.
-  topSlot = std::distance(
-      begin(),
-      std::min_element(begin(), end(), [](const auto &a, const auto &b) {
-        // a is "smaller" than b if either a's timestamp is earlier than b's, or
-        // b is unused (i.e. b has no actual meaning).
-        return !a.unused && (a < b || b.unused);
-      }));
+  assert(!pending.empty() && "the event queue is empty");
+  auto index = pending.begin()->second;
+  pending.erase(pending.begin());
+  if (index == lastSlot)
+    lastSlot = ~0U;
+
+  // Reset internal structures and add the slot to the unused list for easy
+  // retrieval.
+  slots[index].reset();
+  unused.push_back(index);
+}
+
+//===----------------------------------------------------------------------===//
+// DeferredEvents
+//===----------------------------------------------------------------------===//
+
+void DeferredEvents::insertOrUpdate(Time time, int index, int bitOffset,
+                                    uint8_t *bytes, unsigned width) {
+  auto data = driveData.size();
+  driveData.append(bytes, bytes + llvm::divideCeil(width, 8));
+  drives.push_back({time, index, bitOffset, width, data});
+}
+
+void DeferredEvents::insertOrUpdate(Time time, unsigned inst) {
+  wakeups.push_back({time, inst});
+}
+
+void DeferredEvents::applyTo(UpdateQueue &queue) {
+  for (auto &drive : drives)
+    queue.insertOrUpdate(drive.time, drive.index, drive.bitOffset,
+                         &driveData[drive.data], drive.width);
+  for (auto [time, inst] : wakeups)
+    queue.insertOrUpdate(time, inst);
+  drives.clear();
+  driveData.clear();
+  wakeups.clear();
 }
 
 //===----------------------------------------------------------------------===//
@@ -221,9 +225,12 @@ Slot State::popQueue() {
   return pop;
 }
 
-void State::pushQueue(Time t, unsigned inst) {
+void State::pushQueue(Time t, unsigned inst, DeferredEvents *deferred) {
   Time newTime = time + t;
-  queue.insertOrUpdate(newTime, inst);
+  if (deferred)
+    deferred->insertOrUpdate(newTime, inst);
+  else
+    queue.insertOrUpdate(newTime, inst);
   instances[inst].expectedWakeup = newTime;
 }
 
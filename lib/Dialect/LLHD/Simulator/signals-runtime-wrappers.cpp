@@ -18,6 +18,10 @@
 using namespace llvm;
 using namespace circt::llhd::sim;
 
+/// The events recorded for the instance evaluated on the current thread, if
+/// instances are evaluated in parallel.
+static thread_local DeferredEvents *deferredEvents = nullptr;
+
 //===----------------------------------------------------------------------===//
 // Runtime interface
 //===----------------------------------------------------------------------===//
@@ -64,8 +68,13 @@ void driveSignal(State *state, SignalDetail *detail, uint8_t *value,
       (detail->value - state->signals[globalIndex].getValue()) * 8 + offset;
 
   // Spawn a new event.
-  state->queue.insertOrUpdate(state->time + Time(time, delta, eps), globalIndex,
-                              bitOffset, value, width);
+  auto driveTime = state->time + Time(time, delta, eps);
+  if (deferredEvents)
+    deferredEvents->insertOrUpdate(driveTime, globalIndex, bitOffset, value,
+                                   width);
+  else
+    state->queue.insertOrUpdate(driveTime, globalIndex, bitOffset, value,
+                                width);
 }
 
 void llhdSuspend(State *state, ProcState *procState, int time, int delta,
@@ -73,6 +82,12 @@ void llhdSuspend(State *state, ProcState *procState, int time, int delta,
   // Add a new scheduled wake up if a time is specified.
   if (time || delta || eps) {
     Time sTime(time, delta, eps);
-    state->pushQueue(sTime, procState->inst);
+    state->pushQueue(sTime, procState->inst, deferredEvents);
   }
 }
+
+//===----------------------------------------------------------------------===//
+// Engine interface
+//===----------------------------------------------------------------------===//
+
+void setDeferredEvents(DeferredEvents *events) { deferredEvents = events; }
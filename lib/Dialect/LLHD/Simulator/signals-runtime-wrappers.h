@@ -53,6 +53,15 @@ void driveSignal(circt::llhd::sim::State *state,
 void llhdSuspend(circt::llhd::sim::State *state,
                  circt::llhd::sim::ProcState *procState, int time, int delta,
                  int eps);
+
+//===----------------------------------------------------------------------===//
+// Engine interfaces
+//===----------------------------------------------------------------------===//
+
+/// Record the drives and wakeups scheduled on the calling thread in `events`
+/// instead of inserting them into the queue. Passing null restores the
+/// default behavior.
+void setDeferredEvents(circt::llhd::sim::DeferredEvents *events);
 }
 
 #endif // CIRCT_DIALECT_LLHD_SIMULATOR_SIGNALS_RUNTIME_WRAPPERS_H
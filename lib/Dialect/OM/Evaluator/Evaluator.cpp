@@ -14,6 +14,7 @@
 #include "mlir/IR/BuiltinAttributeInterfaces.h"
 #include "mlir/IR/Location.h"
 #include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/Debug.h"
 
@@ -23,11 +24,17 @@ using namespace mlir;
 using namespace circt::om;
 
 /// Construct an Evaluator with an IR module.
-circt::om::Evaluator::Evaluator(ModuleOp mod) : symbolTable(mod) {}
+circt::om::Evaluator::Evaluator(ModuleOp mod, bool parallel)
+    : symbolTable(std::make_shared<SymbolTable>(mod)), parallel(parallel),
+      arena(*arenas.emplace_back(std::make_unique<evaluator::ValueArena>())) {}
+
+circt::om::Evaluator::Evaluator(std::shared_ptr<SymbolTable> symbolTable,
+                                evaluator::ValueArena &arena)
+    : symbolTable(std::move(symbolTable)), parallel(false), arena(arena) {}
 
 /// Get the Module this Evaluator is built from.
 ModuleOp circt::om::Evaluator::getModule() {
-  return cast<ModuleOp>(symbolTable.getOp());
+  return cast<ModuleOp>(symbolTable->getOp());
 }
 
 SmallVector<evaluator::EvaluatorValuePtr>
@@ -75,30 +82,30 @@ circt::om::Evaluator::getPartiallyEvaluatedValue(Type type, Location loc) {
   return TypeSwitch<mlir::Type, FailureOr<evaluator::EvaluatorValuePtr>>(type)
       .Case([&](circt::om::MapType type) {
         evaluator::EvaluatorValuePtr result =
-            std::make_shared<evaluator::MapValue>(type, loc);
+            makeValue<evaluator::MapValue>(type, loc);
         return success(result);
       })
       .Case([&](circt::om::ListType type) {
         evaluator::EvaluatorValuePtr result =
-            std::make_shared<evaluator::ListValue>(type, loc);
+            makeValue<evaluator::ListValue>(type, loc);
         return success(result);
       })
       .Case([&](mlir::TupleType type) {
         evaluator::EvaluatorValuePtr result =
-            std::make_shared<evaluator::TupleValue>(type, loc);
+            makeValue<evaluator::TupleValue>(type, loc);
         return success(result);
       })
 
       .Case([&](circt::om::ClassType type)
                 -> FailureOr<evaluator::EvaluatorValuePtr> {
         ClassOp cls =
-            symbolTable.lookup<ClassOp>(type.getClassName().getValue());
+            symbolTable->lookup<ClassOp>(type.getClassName().getValue());
         if (!cls)
-          return symbolTable.getOp()->emitError("unknown class name ")
+          return symbolTable->getOp()->emitError("unknown class name ")
                  << type.getClassName();
 
         evaluator::EvaluatorValuePtr result =
-            std::make_shared<evaluator::ObjectValue>(cls, loc);
+            makeValue<evaluator::ObjectValue>(cls, loc);
 
         return success(result);
       })
@@ -132,7 +139,7 @@ FailureOr<evaluator::EvaluatorValuePtr> circt::om::Evaluator::getOrCreateValue(
                   // Create a partially evaluated AttributeValue of
                   // om::IntegerType in case we need to delay evaluation.
                   evaluator::EvaluatorValuePtr result =
-                      std::make_shared<evaluator::AttributeValue>(
+                      makeValue<evaluator::AttributeValue>(
                           op.getResult().getType(), loc);
                   return success(result);
                 })
@@ -140,8 +147,8 @@ FailureOr<evaluator::EvaluatorValuePtr> circt::om::Evaluator::getOrCreateValue(
                   // Create a reference value since the value pointed by object
                   // field op is not created yet.
                   evaluator::EvaluatorValuePtr result =
-                      std::make_shared<evaluator::ReferenceValue>(
-                          value.getType(), loc);
+                      makeValue<evaluator::ReferenceValue>(value.getType(),
+                                                           loc);
                   return success(result);
                 })
                 .Case<AnyCastOp>([&](AnyCastOp op) {
@@ -149,13 +156,13 @@ FailureOr<evaluator::EvaluatorValuePtr> circt::om::Evaluator::getOrCreateValue(
                 })
                 .Case<FrozenBasePathCreateOp>([&](FrozenBasePathCreateOp op) {
                   evaluator::EvaluatorValuePtr result =
-                      std::make_shared<evaluator::BasePathValue>(
-                          op.getPathAttr(), loc);
+                      makeValue<evaluator::BasePathValue>(op.getPathAttr(),
+                                                          loc);
                   return success(result);
                 })
                 .Case<FrozenPathCreateOp>([&](FrozenPathCreateOp op) {
                   evaluator::EvaluatorValuePtr result =
-                      std::make_shared<evaluator::PathValue>(
+                      makeValue<evaluator::PathValue>(
                           op.getTargetKindAttr(), op.getPathAttr(),
                           op.getModuleAttr(), op.getRefAttr(),
                           op.getFieldAttr(), loc);
@@ -163,7 +170,7 @@ FailureOr<evaluator::EvaluatorValuePtr> circt::om::Evaluator::getOrCreateValue(
                 })
                 .Case<FrozenEmptyPathOp>([&](FrozenEmptyPathOp op) {
                   evaluator::EvaluatorValuePtr result =
-                      std::make_shared<evaluator::PathValue>(
+                      makeValue<evaluator::PathValue>(
                           evaluator::PathValue::getEmptyPath(loc));
                   return success(result);
                 })
@@ -189,9 +196,9 @@ circt::om::Evaluator::evaluateObjectInstance(StringAttr className,
                                              ActualParameters actualParams,
                                              Location loc,
                                              ObjectKey instanceKey) {
-  ClassOp cls = symbolTable.lookup<ClassOp>(className);
+  ClassOp cls = symbolTable->lookup<ClassOp>(className);
   if (!cls)
-    return symbolTable.getOp()->emitError("unknown class name ") << className;
+    return symbolTable->getOp()->emitError("unknown class name ") << className;
 
   auto formalParamNames = cls.getFormalParamNames().getAsRange<StringAttr>();
   auto formalParamTypes = cls.getBodyBlock()->getArgumentTypes();
@@ -243,7 +250,12 @@ circt::om::Evaluator::evaluateObjectInstance(StringAttr className,
   evaluator::ObjectFields fields;
 
   auto *context = cls.getContext();
-  for (auto &op : cls.getOps())
+  for (auto &op : cls.getOps()) {
+    // Constants are fully evaluated as soon as they are created, so there is
+    // no need to allocate them up front. They are created on first use, and
+    // like all other values there is one per op and instantiation.
+    if (isa<ConstantOp>(op))
+      continue;
     for (auto result : op.getResults()) {
       // Allocate the value, with unknown loc. It will be later set when
       // evaluating the fields.
@@ -253,6 +265,10 @@ circt::om::Evaluator::evaluateObjectInstance(StringAttr className,
       // Add to the worklist.
       worklist.push({result, actualParams});
     }
+  }
+
+  if (parallel && failed(evaluateIndependentObjects(cls, actualParams)))
+    return failure();
 
   for (auto field : cls.getOps<ClassFieldOp>()) {
     StringAttr name = field.getNameAttr();
@@ -276,7 +292,7 @@ circt::om::Evaluator::evaluateObjectInstance(StringAttr className,
 
   // If it's external call, just allocate new ObjectValue.
   evaluator::EvaluatorValuePtr result =
-      std::make_shared<evaluator::ObjectValue>(cls, fields, loc);
+      makeValue<evaluator::ObjectValue>(cls, fields, loc);
   return result;
 }
 
@@ -284,20 +300,29 @@ circt::om::Evaluator::evaluateObjectInstance(StringAttr className,
 FailureOr<std::shared_ptr<evaluator::EvaluatorValue>>
 circt::om::Evaluator::instantiate(
     StringAttr className, ArrayRef<evaluator::EvaluatorValuePtr> actualParams) {
-  ClassOp cls = symbolTable.lookup<ClassOp>(className);
+  ClassOp cls = symbolTable->lookup<ClassOp>(className);
   if (!cls)
-    return symbolTable.getOp()->emitError("unknown class name ") << className;
-
-  auto parameters =
-      std::make_unique<SmallVector<std::shared_ptr<evaluator::EvaluatorValue>>>(
-          actualParams);
+    return symbolTable->getOp()->emitError("unknown class name ") << className;
 
-  actualParametersBuffers.push_back(std::move(parameters));
+  auto result = evaluateClass(
+      className, createParameters(llvm::to_vector(actualParams)), cls.getLoc());
+  if (failed(result))
+    return failure();
 
-  auto loc = cls.getLoc();
-  auto result = evaluateObjectInstance(
-      className, actualParametersBuffers.back().get(), loc);
+  auto &object = result.value();
+  // Finalize the value. This will eliminate intermidiate ReferenceValue used as
+  // a placeholder in the initialization.
+  if (failed(object->finalize()))
+    return cls.emitError() << "failed to finalize evaluation. Probably the "
+                              "class contains a dataflow cycle";
+  return object;
+}
 
+FailureOr<evaluator::EvaluatorValuePtr>
+circt::om::Evaluator::evaluateClass(StringAttr className,
+                                    ActualParameters actualParams,
+                                    Location loc) {
+  auto result = evaluateObjectInstance(className, actualParams, loc);
   if (failed(result))
     return failure();
 
@@ -317,13 +342,160 @@ circt::om::Evaluator::instantiate(
       worklist.push({value, args});
   }
 
-  auto &object = result.value();
-  // Finalize the value. This will eliminate intermidiate ReferenceValue used as
-  // a placeholder in the initialization.
-  if (failed(object->finalize()))
-    return cls.emitError() << "failed to finalize evaluation. Probably the "
-                              "class contains a dataflow cycle";
-  return object;
+  return result;
+}
+
+LogicalResult circt::om::Evaluator::evaluateIndependentObjects(
+    ClassOp cls, ActualParameters actualParams) {
+  struct Task {
+    ObjectOp op;
+    SmallVector<evaluator::EvaluatorValuePtr> parameters;
+    ArrayRef<evaluator::EvaluatorValue *> parameterIds;
+    Instance instance;
+  };
+  SmallVector<Task> tasks;
+  DenseSet<InstanceKey> scheduled;
+
+  // Look up the value of an operand. Unlike getOrCreateValue, this does not
+  // set the location of parameters or existing values to that of the object,
+  // so scanning the body leaves them as sequential evaluation would. Values
+  // created on first use, like constants, are created with an unknown
+  // location, which their first use in sequential order then sets.
+  auto *context = cls.getContext();
+  auto lookupOperand = [&](Value input) -> FailureOr<EvaluatorValuePtr> {
+    if (auto arg = dyn_cast<BlockArgument>(input))
+      return (*actualParams)[arg.getArgNumber()];
+    auto it = objects.find({input, actualParams});
+    if (it != objects.end())
+      return it->second;
+    return getOrCreateValue(input, actualParams, UnknownLoc::get(context));
+  };
+
+  // An object can be evaluated on its own if its operands are fully evaluated
+  // leaf values. These are copied, since evaluation updates the location of
+  // parameters and the copies must not be shared between threads. Objects and
+  // aggregates may still be under construction by this Evaluator.
+  for (auto op : cls.getOps<ObjectOp>()) {
+    if (isFullyEvaluated(op, actualParams))
+      continue;
+    Task task{op, {}, {}, {}};
+    SmallVector<evaluator::EvaluatorValue *> parameterIds;
+    bool independent = true;
+    for (auto input : op.getOperands()) {
+      auto inputResult = lookupOperand(input);
+      if (failed(inputResult))
+        return failure();
+      auto *value = inputResult.value().get();
+      if (!value->isFullyEvaluated() ||
+          !isa<evaluator::AttributeValue, evaluator::BasePathValue,
+               evaluator::PathValue>(value)) {
+        independent = false;
+        break;
+      }
+      task.parameters.push_back(inputResult.value());
+      parameterIds.push_back(value);
+    }
+    if (!independent)
+      continue;
+
+    // Identical instantiations are evaluated once, and the others copy the
+    // result from `instances` when they are evaluated sequentially.
+    InstanceKey key{op.getClassNameAttr(), parameterIds};
+    if (instances.contains(key) || scheduled.contains(key))
+      continue;
+    task.parameterIds = ArrayRef(parameterIds).copy(arena);
+    scheduled.insert({op.getClassNameAttr(), task.parameterIds});
+    tasks.push_back(std::move(task));
+  }
+  if (tasks.size() < 2)
+    return success();
+
+  // Diagnostics are emitted from the worker threads. Report them in program
+  // order once all of them are done.
+  ParallelDiagnosticHandler diagHandler(context);
+
+  // Split the objects into one contiguous chunk per thread, so diagnostics
+  // are still reported in program order. Each chunk is evaluated by an
+  // Evaluator of its own, which only shares the read-only symbol table with
+  // this one. The objects of a chunk share its memo tables, so instantiations
+  // within a chunk with identical parameters are evaluated once. Chunks do not
+  // share values with each other, so such instantiations in different chunks
+  // are evaluated once per chunk. The chunks already occupy the threads, so
+  // their Evaluators do not split off further ones.
+  size_t numChunks = std::min<size_t>(tasks.size(), context->getNumThreads());
+
+  // Each chunk allocates from an arena of its own. The arenas are owned by
+  // this Evaluator, since the results are published here.
+  size_t firstArena = arenas.size();
+  for (size_t chunk = 0; chunk < numChunks; ++chunk)
+    arenas.push_back(std::make_unique<evaluator::ValueArena>());
+
+  auto evaluateChunk = [&](size_t chunk) -> LogicalResult {
+    size_t begin = chunk * tasks.size() / numChunks;
+    size_t end = (chunk + 1) * tasks.size() / numChunks;
+    auto chunkTasks = MutableArrayRef(tasks).slice(begin, end - begin);
+    Evaluator subEvaluator(symbolTable, *arenas[firstArena + chunk]);
+
+    // Copy each parameter once per chunk, so that it keeps its identity.
+    DenseMap<evaluator::EvaluatorValue *, EvaluatorValuePtr> copies;
+    auto copy = [&](evaluator::EvaluatorValue *parameter) {
+      auto &result = copies[parameter];
+      if (!result)
+        result = TypeSwitch<evaluator::EvaluatorValue *, EvaluatorValuePtr>(
+                     parameter)
+                     .Case<evaluator::AttributeValue, evaluator::BasePathValue,
+                           evaluator::PathValue>([&](auto *value) {
+                       using ValueT = std::remove_pointer_t<decltype(value)>;
+                       return subEvaluator.makeValue<ValueT>(*value);
+                     });
+      return result;
+    };
+
+    // The copies start out with the locations of the parameters, and the
+    // locations evaluation leaves on them are recorded for each object, to be
+    // set on the parameters when the object is copied.
+    for (auto &task : chunkTasks) {
+      auto className = task.op.getClassNameAttr();
+      for (auto &parameter : task.parameters)
+        task.instance.parameters.push_back(copy(parameter.get()));
+      auto *parameters =
+          subEvaluator.createParameters(task.instance.parameters);
+      auto result =
+          subEvaluator.evaluateClass(className, parameters, task.op.getLoc());
+      if (failed(result))
+        return failure();
+      task.instance.object =
+          std::static_pointer_cast<evaluator::ObjectValue>(result.value());
+      task.instance.parameterLocations =
+          subEvaluator.getParameterLocations(className, parameters);
+    }
+
+    // Finalize the objects once the whole chunk is complete, since they may
+    // share values.
+    for (auto &task : chunkTasks)
+      if (failed(task.instance.object->finalize()))
+        return task.op.emitError()
+               << "failed to finalize evaluation. Probably the class contains "
+                  "a dataflow cycle";
+    return success();
+  };
+
+  if (failed(failableParallelForEach(
+          context, llvm::seq<size_t>(0, numChunks), [&](size_t chunk) {
+            diagHandler.setOrderIDForThread(chunk);
+            auto result = evaluateChunk(chunk);
+            diagHandler.eraseOrderIDForThread();
+            return result;
+          })))
+    return failure();
+
+  // Publish the results in this Evaluator. They still refer to the copies of
+  // the parameters, which are replaced with the originals when the objects are
+  // copied.
+  for (auto &task : tasks)
+    instances.try_emplace({task.op.getClassNameAttr(), task.parameterIds},
+                          std::move(task.instance));
+  return success();
 }
 
 FailureOr<evaluator::EvaluatorValuePtr>
@@ -399,8 +571,7 @@ FailureOr<circt::om::evaluator::EvaluatorValuePtr>
 circt::om::Evaluator::evaluateConstant(ConstantOp op,
                                        ActualParameters actualParams,
                                        Location loc) {
-  return success(std::make_shared<circt::om::evaluator::AttributeValue>(
-      op.getValue(), loc));
+  return success(makeValue<evaluator::AttributeValue>(op.getValue(), loc));
 }
 
 // Evaluator dispatch function for integer binary arithmetic.
@@ -482,23 +653,12 @@ circt::om::Evaluator::evaluateIntegerBinaryArithmetic(
   return handle;
 }
 
-/// Evaluator dispatch function for Object instances.
-FailureOr<circt::om::Evaluator::ActualParameters>
-circt::om::Evaluator::createParametersFromOperands(
-    ValueRange range, ActualParameters actualParams, Location loc) {
-  // Create an unique storage to store parameters.
-  auto parameters = std::make_unique<
-      SmallVector<std::shared_ptr<evaluator::EvaluatorValue>>>();
-
-  // Collect operands' evaluator values in the current instantiation context.
-  for (auto input : range) {
-    auto inputResult = getOrCreateValue(input, actualParams, loc);
-    if (failed(inputResult))
-      return failure();
-    parameters->push_back(inputResult.value());
-  }
-
-  actualParametersBuffers.push_back(std::move(parameters));
+/// Create an unique storage for a list of actual parameters.
+circt::om::Evaluator::ActualParameters circt::om::Evaluator::createParameters(
+    SmallVector<evaluator::EvaluatorValuePtr> parameters) {
+  actualParametersBuffers.push_back(
+      std::make_unique<SmallVector<evaluator::EvaluatorValuePtr>>(
+          std::move(parameters)));
   return actualParametersBuffers.back().get();
 }
 
@@ -510,12 +670,173 @@ circt::om::Evaluator::evaluateObjectInstance(ObjectOp op,
   if (isFullyEvaluated({op, actualParams}))
     return getOrCreateValue(op, actualParams, loc);
 
-  auto params =
-      createParametersFromOperands(op.getOperands(), actualParams, loc);
-  if (failed(params))
+  // Collect operands' evaluator values in the current instantiation context.
+  SmallVector<evaluator::EvaluatorValuePtr> parameters;
+  SmallVector<evaluator::EvaluatorValue *> parameterIds;
+  bool leafParameters = true;
+  for (auto input : op.getOperands()) {
+    auto inputResult = getOrCreateValue(input, actualParams, loc);
+    if (failed(inputResult))
+      return failure();
+    parameters.push_back(inputResult.value());
+    parameterIds.push_back(inputResult.value().get());
+    leafParameters &=
+        isa<evaluator::AttributeValue, evaluator::BasePathValue,
+            evaluator::PathValue>(inputResult.value().get());
+  }
+
+  // Evaluating a class body is deterministic in the actual parameters, so
+  // another instantiation with identical parameters yields equal fields. Copy
+  // them rather than evaluating the whole subtree of objects again. The copy
+  // only shares the parameters with the original, so each instantiation still
+  // has objects of its own. Memoization is limited to leaf parameters, as the
+  // fields may refer to values reachable from other parameters, which must be
+  // shared as well.
+  auto className = op.getClassNameAttr();
+  if (leafParameters) {
+    auto it = instances.find({className, parameterIds});
+    if (it != instances.end()) {
+      auto &instance = it->second;
+      DenseMap<evaluator::EvaluatorValue *, EvaluatorValuePtr> copies;
+      for (auto [original, parameter] :
+           llvm::zip(instance.parameters, parameters))
+        copies[original.get()] = parameter;
+      evaluator::ObjectFields fields;
+      bool copied = true;
+      for (auto &[name, field] : instance.object->getFields()) {
+        auto copy = copyValue(field.get(), copies);
+        if (!copy) {
+          copied = false;
+          break;
+        }
+        fields[name] = std::move(copy);
+      }
+      // Evaluate the class body if the original is not complete yet.
+      if (copied) {
+        // Leave the parameters with the locations evaluating the class body
+        // would have.
+        for (auto [index, parameterLoc] : instance.parameterLocations)
+          parameters[index]->setLoc(parameterLoc);
+        auto result = getOrCreateValue(op, actualParams, loc);
+        if (succeeded(result))
+          llvm::cast<evaluator::ObjectValue>(result.value().get())
+              ->setFields(std::move(fields));
+        return result;
+      }
+    }
+  }
+
+  auto *instanceParams = createParameters(std::move(parameters));
+  auto result = evaluateObjectInstance(className, instanceParams, loc,
+                                       {op, actualParams});
+  if (failed(result))
     return failure();
-  return evaluateObjectInstance(op.getClassNameAttr(), params.value(), loc,
-                                {op, actualParams});
+  if (leafParameters)
+    instances.try_emplace(
+        {className, ArrayRef(parameterIds).copy(arena)},
+        Instance{
+            std::static_pointer_cast<evaluator::ObjectValue>(result.value()),
+            llvm::to_vector(*instanceParams),
+            getParameterLocations(className, instanceParams)});
+  return result;
+}
+
+SmallVector<std::pair<unsigned, Location>>
+circt::om::Evaluator::getParameterLocations(StringAttr className,
+                                            ActualParameters actualParams) {
+  // Every use of a parameter goes through getOrCreateValue, which records it
+  // in `objects`.
+  SmallVector<std::pair<unsigned, Location>> locations;
+  ClassOp cls = symbolTable->lookup<ClassOp>(className);
+  for (auto arg : cls.getBodyBlock()->getArguments())
+    if (objects.contains({arg, actualParams}))
+      locations.push_back({arg.getArgNumber(),
+                           (*actualParams)[arg.getArgNumber()]->getLoc()});
+  return locations;
+}
+
+EvaluatorValuePtr circt::om::Evaluator::copyValue(
+    evaluator::EvaluatorValue *value,
+    DenseMap<evaluator::EvaluatorValue *, EvaluatorValuePtr> &copies) {
+  using namespace evaluator;
+  if (!value->isFullyEvaluated())
+    return nullptr;
+  if (auto copy = copies.lookup(value))
+    return copy;
+
+  // Composite values are registered before their elements are copied, so
+  // cycles through them end at the copy.
+  auto copyElements = [&](const auto &elements, auto &result) -> bool {
+    for (auto &element : elements) {
+      auto copy = copyValue(element.get(), copies);
+      if (!copy)
+        return false;
+      result.push_back(std::move(copy));
+    }
+    return true;
+  };
+  return TypeSwitch<EvaluatorValue *, EvaluatorValuePtr>(value)
+      .Case<AttributeValue, BasePathValue, PathValue>(
+          [&](auto *leaf) -> EvaluatorValuePtr {
+            using ValueT = std::remove_pointer_t<decltype(leaf)>;
+            return copies[value] = makeValue<ValueT>(*leaf);
+          })
+      .Case([&](ReferenceValue *ref) -> EvaluatorValuePtr {
+        auto copy = makeValue<ReferenceValue>(ref->getValueType(),
+                                              ref->getLoc());
+        copies[value] = copy;
+        auto target = copyValue(ref->getValue().get(), copies);
+        if (!target)
+          return nullptr;
+        copy->setValue(std::move(target));
+        return copy;
+      })
+      .Case([&](ObjectValue *object) -> EvaluatorValuePtr {
+        auto copy =
+            makeValue<ObjectValue>(object->getClassOp(), object->getLoc());
+        copies[value] = copy;
+        ObjectFields fields;
+        for (auto &[name, field] : object->getFields()) {
+          auto fieldCopy = copyValue(field.get(), copies);
+          if (!fieldCopy)
+            return nullptr;
+          fields[name] = std::move(fieldCopy);
+        }
+        copy->setFields(std::move(fields));
+        return copy;
+      })
+      .Case([&](ListValue *list) -> EvaluatorValuePtr {
+        auto copy = makeValue<ListValue>(list->getListType(), list->getLoc());
+        copies[value] = copy;
+        SmallVector<EvaluatorValuePtr> elements;
+        if (!copyElements(list->getElements(), elements))
+          return nullptr;
+        copy->setElements(std::move(elements));
+        return copy;
+      })
+      .Case([&](TupleValue *tuple) -> EvaluatorValuePtr {
+        auto copy =
+            makeValue<TupleValue>(tuple->getTupleType(), tuple->getLoc());
+        copies[value] = copy;
+        TupleValue::TupleElements elements;
+        if (!copyElements(tuple->getElements(), elements))
+          return nullptr;
+        copy->setElements(std::move(elements));
+        return copy;
+      })
+      .Case([&](MapValue *map) -> EvaluatorValuePtr {
+        auto copy = makeValue<MapValue>(map->getMapType(), map->getLoc());
+        copies[value] = copy;
+        DenseMap<Attribute, EvaluatorValuePtr> elements;
+        for (auto &[key, element] : map->getElements()) {
+          auto elementCopy = copyValue(element.get(), copies);
+          if (!elementCopy)
+            return nullptr;
+          elements[key] = std::move(elementCopy);
+        }
+        copy->setElements(std::move(elements));
+        return copy;
+      });
 }
 
 /// Evaluator dispatch function for Object fields.
@@ -1,4 +1,5 @@
 // RUN: circt-opt %s --arc-allocate-state | FileCheck %s
+// RUN: circt-opt %s --arc-allocate-state=dirty-tracking | FileCheck %s --check-prefix=DIRTY
 
 // CHECK-LABEL: arc.model @test
 arc.model @test io !hw.modty<input x : i1, output y : i1> {
@@ -79,3 +80,37 @@ arc.model @test io !hw.modty<input x : i1, output y : i1> {
   }
   // CHECK-NEXT: }
 }
+
+// DIRTY-LABEL: arc.model @dirty
+arc.model @dirty io !hw.modty<> {
+^bb0(%arg0: !arc.storage):
+  arc.passthrough {
+    // DIRTY: arc.alloc_state {{%.+}} {dirty_offset = 1 : i32, name = "r", offset = 0 : i32}
+    // DIRTY-NEXT: arc.alloc_state {{%.+}} {offset = 2 : i32}
+    // DIRTY-NEXT: arc.alloc_memory {{%.+}} {dirty_offset = 8 : i32, name = "m", offset = 4 : i32, stride = 1 : i32}
+    %0 = arc.alloc_state %arg0 {name = "r"} : (!arc.storage) -> !arc.state<i8>
+    %1 = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i8>
+    %2 = arc.alloc_memory %arg0 {name = "m"} : (!arc.storage) -> !arc.memory<4 x i8, i2>
+    %true = hw.constant true
+    %c0_i2 = hw.constant 0 : i2
+    %c0_i8 = hw.constant 0 : i8
+
+    // DIRTY: [[FLAG:%.+]] = arc.storage.get [[SUBPTR:%.+]][1] : !arc.storage<9> -> !arc.state<i1>
+    // DIRTY-NEXT: [[ONE:%.+]] = hw.constant true
+    // DIRTY-NEXT: arc.state_write [[FLAG]] = [[ONE]] if %true : <i1>
+    // DIRTY-NEXT: [[STATE:%.+]] = arc.storage.get [[SUBPTR]][0] : !arc.storage<9> -> !arc.state<i8>
+    // DIRTY-NEXT: arc.state_write [[STATE]] = %c0_i8 if %true : <i8>
+    arc.state_write %0 = %c0_i8 if %true : <i8>
+
+    // DIRTY-NEXT: [[STATE:%.+]] = arc.storage.get [[SUBPTR]][2] : !arc.storage<9> -> !arc.state<i8>
+    // DIRTY-NEXT: arc.state_write [[STATE]] = %c0_i8 : <i8>
+    arc.state_write %1 = %c0_i8 : <i8>
+
+    // DIRTY-NEXT: [[FLAG:%.+]] = arc.storage.get [[SUBPTR]][8] : !arc.storage<9> -> !arc.state<i1>
+    // DIRTY-NEXT: [[ONE:%.+]] = hw.constant true
+    // DIRTY-NEXT: arc.state_write [[FLAG]] = [[ONE]] : <i1>
+    // DIRTY-NEXT: [[MEM:%.+]] = arc.storage.get [[SUBPTR]][4] : !arc.storage<9> -> !arc.memory<4 x i8, i2>
+    // DIRTY-NEXT: arc.memory_write [[MEM]][%c0_i2], %c0_i8 : <4 x i8, i2>
+    arc.memory_write %2[%c0_i2], %c0_i8 : <4 x i8, i2>
+  }
+}
@@ -524,3 +524,19 @@ hw.module @vectorize(in %in0: i4, in %in1: i4, out out0: i4) {
 
 // expected-error @below {{state type must have a known bit width}}
 func.func @InvalidStateType(%arg0: !arc.state<index>)
+
+// -----
+
+arc.model @EmptyParallelDispatch io !hw.modty<> {
+^bb0(%arg0: !arc.storage<42>):
+  // expected-error @below {{must dispatch at least one task}}
+  arc.parallel_dispatch @Foo(%arg0) if [] : !arc.storage<42>
+}
+
+// -----
+
+func.func @StorageLaneSizeMismatch(%arg0: !arc.storage<10>, %arg1: index) {
+  // expected-error @below {{storage size 10 is not a multiple of the lane size 4}}
+  %0 = arc.storage.lane %arg0[%arg1] : !arc.storage<10> -> !arc.state<i32>
+  return
+}
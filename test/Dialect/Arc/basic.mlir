@@ -65,6 +65,15 @@ func.func @StorageAccess(%arg0: !arc.storage<10000>) {
   return
 }
 
+// CHECK-LABEL: func.func @StorageLaneAccess
+func.func @StorageLaneAccess(%arg0: !arc.storage<64>, %arg1: index) {
+  // CHECK-NEXT: arc.storage.lane %arg0[%arg1] : !arc.storage<64> -> !arc.state<i9>
+  // CHECK-NEXT: arc.storage.lane %arg0[%arg1] : !arc.storage<64> -> !arc.memory<4 x i19, i32>
+  %0 = arc.storage.lane %arg0[%arg1] : !arc.storage<64> -> !arc.state<i9>
+  %1 = arc.storage.lane %arg0[%arg1] : !arc.storage<64> -> !arc.memory<4 x i19, i32>
+  return
+}
+
 // CHECK-LABEL: func.func @zeroCount
 func.func @zeroCount(%arg0 : i32) {
   // CHECK-NEXT: {{%.+}} = arc.zero_count leading %arg0  : i32
@@ -368,3 +377,14 @@ func.func @with_attr() {
   arc.sim.instantiate @sim_test as %model attributes {foo = "foo"} {}
   return
 }
+
+// -----
+
+// CHECK-LABEL: arc.model @ParallelDispatch
+arc.model @ParallelDispatch io !hw.modty<> {
+^bb0(%arg0: !arc.storage<42>):
+  %true = hw.constant true
+  %false = hw.constant false
+  // CHECK: arc.parallel_dispatch @ParallelDispatch_parallel(%arg0) if [%true, %false] : !arc.storage<42>
+  arc.parallel_dispatch @ParallelDispatch_parallel(%arg0) if [%true, %false] : !arc.storage<42>
+}
@@ -0,0 +1,58 @@
+// RUN: circt-opt %s --arc-batch-instances=num-lanes=4 | FileCheck %s
+
+// CHECK-LABEL: func.func @Foo_clock
+// CHECK-SAME:    (%arg0: !arc.storage<96>, %arg1: index) {
+// CHECK-NEXT:    [[TMP:%.+]] = arc.storage.get %arg0[8] : !arc.storage<96> -> !arc.storage<8>
+// CHECK-NEXT:    [[X:%.+]] = arc.storage.lane [[TMP]][%arg1] : !arc.storage<8> -> !arc.state<i16>
+// CHECK-NEXT:    [[VALUE:%.+]] = arc.state_read [[X]] : <i16>
+// CHECK-NEXT:    [[SUB:%.+]] = arc.storage.get %arg0[32] : !arc.storage<96> -> !arc.storage<64>
+// CHECK-NEXT:    [[TMP:%.+]] = arc.storage.get [[SUB]][16] : !arc.storage<64> -> !arc.storage<8>
+// CHECK-NEXT:    [[Y:%.+]] = arc.storage.lane [[TMP]][%arg1] : !arc.storage<8> -> !arc.state<i16>
+// CHECK-NEXT:    arc.state_write [[Y]] = [[VALUE]] : <i16>
+// CHECK-NEXT:    [[TMP:%.+]] = arc.storage.get %arg0[64] : !arc.storage<96> -> !arc.storage<32>
+// CHECK-NEXT:    arc.storage.lane [[TMP]][%arg1] : !arc.storage<32> -> !arc.memory<4 x i16, i2>
+// CHECK-NEXT:    return
+func.func @Foo_clock(%arg0: !arc.storage<24>) {
+  %0 = arc.storage.get %arg0[2] : !arc.storage<24> -> !arc.state<i16>
+  %1 = arc.state_read %0 : <i16>
+  %2 = arc.storage.get %arg0[8] : !arc.storage<24> -> !arc.storage<16>
+  %3 = arc.storage.get %2[4] : !arc.storage<16> -> !arc.state<i16>
+  arc.state_write %3 = %1 : <i16>
+  %4 = arc.storage.get %arg0[16] : !arc.storage<24> -> !arc.memory<4 x i16, i2>
+  return
+}
+
+// Functions that do not access the storage remain untouched.
+// CHECK-LABEL: func.func @Foo_arc
+// CHECK-SAME:    (%arg0: i16) -> i16 {
+func.func @Foo_arc(%arg0: i16) -> i16 {
+  return %arg0 : i16
+}
+
+// CHECK-LABEL: arc.model @Foo
+// CHECK-SAME:    attributes {lanes = 4 : i32}
+// CHECK-NEXT:  ^bb0(%arg0: !arc.storage<96>):
+// CHECK-NEXT:    arc.root_input "clk", %arg0 {offset = 0 : i32} : (!arc.storage<96>) -> !arc.state<i1>
+// CHECK-NEXT:    arc.alloc_state %arg0 {name = "x", offset = 8 : i32} : (!arc.storage<96>) -> !arc.state<i16>
+// CHECK-NEXT:    [[C0:%.+]] = arith.constant 0 : index
+// CHECK-NEXT:    [[C4:%.+]] = arith.constant 4 : index
+// CHECK-NEXT:    [[C1:%.+]] = arith.constant 1 : index
+// CHECK-NEXT:    scf.for [[LANE:%.+]] = [[C0]] to [[C4]] step [[C1]] {
+// CHECK-NEXT:      [[TMP:%.+]] = arc.storage.get %arg0[0] : !arc.storage<96> -> !arc.storage<4>
+// CHECK-NEXT:      [[CLK:%.+]] = arc.storage.lane [[TMP]]{{\[}}[[LANE]]{{\]}} : !arc.storage<4> -> !arc.state<i1>
+// CHECK-NEXT:      [[TMP:%.+]] = arc.state_read [[CLK]] : <i1>
+// CHECK-NEXT:      scf.if [[TMP]] {
+// CHECK-NEXT:        func.call @Foo_clock(%arg0, [[LANE]]) : (!arc.storage<96>, index) -> ()
+// CHECK-NEXT:      }
+// CHECK-NEXT:    }
+// CHECK-NEXT:  }
+arc.model @Foo io !hw.modty<input clk : i1> {
+^bb0(%arg0: !arc.storage<24>):
+  %in_clk = arc.root_input "clk", %arg0 {offset = 0 : i32} : (!arc.storage<24>) -> !arc.state<i1>
+  %0 = arc.alloc_state %arg0 {name = "x", offset = 2 : i32} : (!arc.storage<24>) -> !arc.state<i16>
+  %1 = arc.storage.get %arg0[0] : !arc.storage<24> -> !arc.state<i1>
+  %2 = arc.state_read %1 : <i1>
+  scf.if %2 {
+    func.call @Foo_clock(%arg0) : (!arc.storage<24>) -> ()
+  }
+}
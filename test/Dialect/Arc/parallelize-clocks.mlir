@@ -0,0 +1,101 @@
+// RUN: circt-opt %s --arc-parallelize-clocks | FileCheck %s
+
+// Two clock trees that touch disjoint state can be evaluated concurrently. The
+// passthrough reads what they write and has to wait for both of them.
+
+func.func @Independent_clock(%arg0: !arc.storage<3>) {
+  %0 = arc.storage.get %arg0[0] : !arc.storage<3> -> !arc.state<i8>
+  %1 = arc.state_read %0 : <i8>
+  arc.state_write %0 = %1 : <i8>
+  return
+}
+
+func.func @Independent_clock_0(%arg0: !arc.storage<3>) {
+  %0 = arc.storage.get %arg0[1] : !arc.storage<3> -> !arc.state<i8>
+  %1 = arc.state_read %0 : <i8>
+  arc.state_write %0 = %1 : <i8>
+  return
+}
+
+func.func @Independent_passthrough(%arg0: !arc.storage<3>) {
+  %0 = arc.storage.get %arg0[0] : !arc.storage<3> -> !arc.state<i8>
+  %1 = arc.storage.get %arg0[1] : !arc.storage<3> -> !arc.state<i8>
+  %2 = arc.storage.get %arg0[2] : !arc.storage<3> -> !arc.state<i8>
+  %3 = arc.state_read %0 : <i8>
+  %4 = arc.state_read %1 : <i8>
+  %5 = comb.add %3, %4 : i8
+  arc.state_write %2 = %5 : <i8>
+  return
+}
+
+// CHECK-LABEL: func.func @Independent_parallel(%arg0: !arc.storage<3>, %arg1: i32)
+// CHECK-SAME:    attributes {llvm.linkage = #llvm.linkage<internal>}
+// CHECK-NEXT:    [[C0:%.+]] = hw.constant 0 : i32
+// CHECK-NEXT:    [[EQ0:%.+]] = comb.icmp eq %arg1, [[C0]] : i32
+// CHECK-NEXT:    scf.if [[EQ0]] {
+// CHECK-NEXT:      func.call @Independent_clock(%arg0)
+// CHECK-NEXT:    }
+// CHECK-NEXT:    [[C1:%.+]] = hw.constant 1 : i32
+// CHECK-NEXT:    [[EQ1:%.+]] = comb.icmp eq %arg1, [[C1]] : i32
+// CHECK-NEXT:    scf.if [[EQ1]] {
+// CHECK-NEXT:      func.call @Independent_clock_0(%arg0)
+// CHECK-NEXT:    }
+// CHECK-NEXT:    return
+// CHECK-NEXT:  }
+
+// CHECK-LABEL: arc.model @Independent
+arc.model @Independent io !hw.modty<> {
+^bb0(%arg0: !arc.storage<3>):
+  // CHECK-NEXT: ^bb0(%arg0: !arc.storage<3>):
+  // CHECK-NEXT: [[EN0:%.+]] = hw.constant true
+  // CHECK-NEXT: [[EN1:%.+]] = hw.constant false
+  // CHECK-NEXT: arc.parallel_dispatch @Independent_parallel(%arg0) if {{\[}}[[EN0]], [[EN1]]{{\]}} : !arc.storage<3>
+  // CHECK-NEXT: func.call @Independent_passthrough(%arg0)
+  // CHECK-NEXT: }
+  %true = hw.constant true
+  %false = hw.constant false
+  scf.if %true {
+    func.call @Independent_clock(%arg0) : (!arc.storage<3>) -> ()
+  }
+  scf.if %false {
+    func.call @Independent_clock_0(%arg0) : (!arc.storage<3>) -> ()
+  }
+  func.call @Independent_passthrough(%arg0) : (!arc.storage<3>) -> ()
+}
+
+//===----------------------------------------------------------------------===//
+
+// Clock trees that read state written by an earlier one keep their order.
+
+func.func @Dependent_clock(%arg0: !arc.storage<2>) {
+  %0 = arc.storage.get %arg0[0] : !arc.storage<2> -> !arc.state<i8>
+  %1 = arc.state_read %0 : <i8>
+  arc.state_write %0 = %1 : <i8>
+  return
+}
+
+func.func @Dependent_clock_0(%arg0: !arc.storage<2>) {
+  %0 = arc.storage.get %arg0[0] : !arc.storage<2> -> !arc.state<i8>
+  %1 = arc.storage.get %arg0[1] : !arc.storage<2> -> !arc.state<i8>
+  %2 = arc.state_read %0 : <i8>
+  arc.state_write %1 = %2 : <i8>
+  return
+}
+
+// CHECK-NOT: func.func @Dependent_parallel
+// CHECK-LABEL: arc.model @Dependent
+arc.model @Dependent io !hw.modty<> {
+^bb0(%arg0: !arc.storage<2>):
+  // CHECK-NOT: arc.parallel_dispatch
+  // CHECK: scf.if
+  // CHECK-NEXT: func.call @Dependent_clock(%arg0)
+  // CHECK: scf.if
+  // CHECK-NEXT: func.call @Dependent_clock_0(%arg0)
+  %true = hw.constant true
+  scf.if %true {
+    func.call @Dependent_clock(%arg0) : (!arc.storage<2>) -> ()
+  }
+  scf.if %true {
+    func.call @Dependent_clock_0(%arg0) : (!arc.storage<2>) -> ()
+  }
+}
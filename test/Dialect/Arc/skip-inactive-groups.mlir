@@ -0,0 +1,120 @@
+// RUN: circt-opt %s --arc-skip-inactive-groups=min-ops-per-read=1 | FileCheck %s
+// RUN: circt-opt %s --arc-skip-inactive-groups="min-ops-per-read=1 skip-counters" | FileCheck %s --check-prefix=COUNT
+// RUN: circt-opt %s --arc-skip-inactive-groups | FileCheck %s --check-prefix=SMALL
+
+// CHECK-LABEL: arc.model @Basic
+// COUNT-LABEL: arc.model @Basic
+// SMALL-LABEL: arc.model @Basic
+arc.model @Basic io !hw.modty<input a : i4, output b : i4> {
+^bb0(%arg0: !arc.storage):
+  // CHECK:      [[STATE:%.+]] = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i4>
+  // CHECK-NEXT: [[CLK:%.+]] = hw.constant true
+  %in_a = arc.root_input "a", %arg0 : (!arc.storage) -> !arc.state<i4>
+  %out_b = arc.root_output "b", %arg0 : (!arc.storage) -> !arc.state<i4>
+  %0 = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i4>
+  %clk = hw.constant true
+
+  // CHECK-NEXT: [[VALID:%.+]] = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i1>
+  // CHECK-NEXT: [[SHADOW:%.+]] = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i4>
+  // CHECK-NEXT: [[TMP0:%.+]] = arc.state_read [[VALID]] : <i1>
+  // CHECK-NEXT: [[TRUE:%.+]] = hw.constant true
+  // CHECK-NEXT: [[TMP1:%.+]] = comb.xor [[TMP0]], [[TRUE]] : i1
+  // CHECK-NEXT: [[CUR:%.+]] = arc.state_read %in_a : <i4>
+  // CHECK-NEXT: [[OLD:%.+]] = arc.state_read [[SHADOW]] : <i4>
+  // CHECK-NEXT: [[TMP2:%.+]] = comb.icmp ne [[CUR]], [[OLD]] : i4
+  // CHECK-NEXT: [[CHANGED:%.+]] = comb.or [[TMP1]], [[TMP2]] : i1
+  // CHECK-NEXT: [[EN:%.+]] = comb.and [[CLK]], [[CHANGED]] : i1
+  // CHECK-NEXT: arc.clock_tree [[EN]] {
+  // CHECK-NEXT:   [[TRUE:%.+]] = hw.constant true
+  // CHECK-NEXT:   arc.state_write [[VALID]] = [[TRUE]] : <i1>
+  // CHECK-NEXT:   [[TMP:%.+]] = arc.state_read %in_a : <i4>
+  // CHECK-NEXT:   arc.state_write [[SHADOW]] = [[TMP]] : <i4>
+  // CHECK-NEXT:   [[TMP0:%.+]] = arc.state_read %in_a : <i4>
+  // CHECK-NEXT:   [[TMP1:%.+]] = comb.add [[TMP0]], [[TMP0]] : i4
+  // CHECK-NEXT:   arc.state_write [[STATE]] = [[TMP1]] : <i4>
+  // CHECK-NEXT: }
+
+  // COUNT:      [[COUNT:%.+]] = arc.alloc_state %arg0 {name = "arc_skip_count_0"} : (!arc.storage) -> !arc.state<i64>
+  // COUNT:      [[CHANGED:%.+]] = comb.or
+  // COUNT-NEXT: comb.and [[CLK:%.+]], [[CHANGED]] : i1
+  // COUNT-NEXT: arc.clock_tree
+  // COUNT:      }
+  // COUNT-NEXT: [[TRUE:%.+]] = hw.constant true
+  // COUNT-NEXT: [[UNCHANGED:%.+]] = comb.xor [[CHANGED]], [[TRUE]] : i1
+  // COUNT-NEXT: [[SKIP:%.+]] = comb.and [[CLK]], [[UNCHANGED]] : i1
+  // COUNT-NEXT: arc.clock_tree [[SKIP]] {
+  // COUNT-NEXT:   [[TMP0:%.+]] = arc.state_read [[COUNT]] : <i64>
+  // COUNT-NEXT:   [[ONE:%.+]] = hw.constant 1 : i64
+  // COUNT-NEXT:   [[TMP1:%.+]] = comb.add [[TMP0]], [[ONE]] : i64
+  // COUNT-NEXT:   arc.state_write [[COUNT]] = [[TMP1]] : <i64>
+  // COUNT-NEXT: }
+
+  // A single read for two ops does not pay off by default.
+  // SMALL-NOT: arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i1>
+  arc.clock_tree %clk {
+    %1 = arc.state_read %in_a : <i4>
+    %2 = comb.add %1, %1 : i4
+    arc.state_write %0 = %2 : <i4>
+  }
+
+  // CHECK-NEXT: [[VALID:%.+]] = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i1>
+  // CHECK-NEXT: [[SHADOW:%.+]] = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i4>
+  // CHECK-NEXT: arc.passthrough {
+  // CHECK-NEXT:   arc.state_read [[VALID]] : <i1>
+  // CHECK-NEXT:   hw.constant true
+  // CHECK-NEXT:   comb.xor
+  // CHECK-NEXT:   arc.state_read [[STATE]] : <i4>
+  // CHECK-NEXT:   arc.state_read [[SHADOW]] : <i4>
+  // CHECK-NEXT:   comb.icmp ne
+  // CHECK-NEXT:   [[CHANGED:%.+]] = comb.or
+  // CHECK-NEXT:   scf.if [[CHANGED]] {
+  // CHECK-NEXT:     [[TRUE:%.+]] = hw.constant true
+  // CHECK-NEXT:     arc.state_write [[VALID]] = [[TRUE]] : <i1>
+  // CHECK-NEXT:     [[TMP:%.+]] = arc.state_read [[STATE]] : <i4>
+  // CHECK-NEXT:     arc.state_write [[SHADOW]] = [[TMP]] : <i4>
+  // CHECK-NEXT:     [[TMP:%.+]] = arc.state_read [[STATE]] : <i4>
+  // CHECK-NEXT:     arc.state_write %out_b = [[TMP]] : <i4>
+  // CHECK-NEXT:   }
+  // CHECK-NEXT: }
+
+  // COUNT:      arc.passthrough {
+  // COUNT:        scf.if
+  // COUNT:        } else {
+  // COUNT-NEXT:     arc.state_read
+  // COUNT-NEXT:     hw.constant 1 : i64
+  // COUNT-NEXT:     comb.add
+  // COUNT-NEXT:     arc.state_write
+  // COUNT-NEXT:   }
+  // COUNT-NEXT: }
+  arc.passthrough {
+    %1 = arc.state_read %0 : <i4>
+    arc.state_write %out_b = %1 : <i4>
+  }
+}
+
+// Groups with side effects beyond state reads and writes, and groups that
+// share a written state with another group, are left untouched.
+// CHECK-LABEL: arc.model @Ineligible
+// CHECK-NOT:   arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i1>
+arc.model @Ineligible io !hw.modty<input a : i4> {
+^bb0(%arg0: !arc.storage):
+  %in_a = arc.root_input "a", %arg0 : (!arc.storage) -> !arc.state<i4>
+  %0 = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i4>
+  %mem = arc.alloc_memory %arg0 : (!arc.storage) -> !arc.memory<4 x i4, i2>
+  %clk = hw.constant true
+  arc.clock_tree %clk {
+    %1 = arc.state_read %in_a : <i4>
+    %addr = comb.extract %1 from 0 : (i4) -> i2
+    %true = hw.constant true
+    arc.memory_write %mem[%addr], %1 if %true : <4 x i4, i2>
+  }
+  arc.clock_tree %clk {
+    %1 = arc.state_read %in_a : <i4>
+    arc.state_write %0 = %1 : <i4>
+  }
+  arc.passthrough {
+    %1 = arc.state_read %in_a : <i4>
+    %2 = comb.add %1, %1 : i4
+    arc.state_write %0 = %2 : <i4>
+  }
+}
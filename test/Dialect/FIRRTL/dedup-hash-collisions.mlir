@@ -0,0 +1,42 @@
+// RUN: circt-opt --pass-pipeline='builtin.module(firrtl.circuit(firrtl-dedup{test-hash-collisions=true}))' %s | FileCheck %s
+
+// All modules get the same structural hash. Modules which only differ in the
+// value of a constant must still be kept apart by the equivalence check, while
+// equivalent modules are deduplicated into the first module they match.
+
+// CHECK-LABEL: firrtl.circuit "Collision"
+firrtl.circuit "Collision" {
+  // CHECK: firrtl.module private @A
+  // CHECK: firrtl.constant 1 : !firrtl.uint<2>
+  firrtl.module private @A(out %out: !firrtl.uint<2>) {
+    %c1_ui2 = firrtl.constant 1 : !firrtl.uint<2>
+    firrtl.matchingconnect %out, %c1_ui2 : !firrtl.uint<2>
+  }
+  // CHECK: firrtl.module private @B
+  // CHECK: firrtl.constant 2 : !firrtl.uint<2>
+  firrtl.module private @B(out %out: !firrtl.uint<2>) {
+    %c2_ui2 = firrtl.constant 2 : !firrtl.uint<2>
+    firrtl.matchingconnect %out, %c2_ui2 : !firrtl.uint<2>
+  }
+  // CHECK-NOT: firrtl.module private @C
+  firrtl.module private @C(out %out: !firrtl.uint<2>) {
+    %c1_ui2 = firrtl.constant 1 : !firrtl.uint<2>
+    firrtl.matchingconnect %out, %c1_ui2 : !firrtl.uint<2>
+  }
+  // CHECK-NOT: firrtl.module private @D
+  firrtl.module private @D(out %out: !firrtl.uint<2>) {
+    %c2_ui2 = firrtl.constant 2 : !firrtl.uint<2>
+    firrtl.matchingconnect %out, %c2_ui2 : !firrtl.uint<2>
+  }
+  // CHECK: firrtl.module @Collision
+  firrtl.module @Collision() {
+    // CHECK-NEXT: firrtl.instance a @A
+    // CHECK-NEXT: firrtl.instance b @B
+    // CHECK-NEXT: firrtl.instance c @A
+    // CHECK-NEXT: firrtl.instance d @B
+    %a_out = firrtl.instance a @A(out out: !firrtl.uint<2>)
+    %b_out = firrtl.instance b @B(out out: !firrtl.uint<2>)
+    %c_out = firrtl.instance c @C(out out: !firrtl.uint<2>)
+    %d_out = firrtl.instance d @D(out out: !firrtl.uint<2>)
+  }
+}
@@ -950,3 +950,29 @@ firrtl.circuit "OMIRRemoval" {
     firrtl.matchingconnect %d, %tmp_3 : !firrtl.uint<4>
   }
 }
+
+// -----
+
+// Constants which cross module boundaries several times are propagated through
+// every instance of a module.
+
+// CHECK-LABEL: firrtl.circuit "PortRoundTrip"
+firrtl.circuit "PortRoundTrip" {
+  // CHECK-LABEL: firrtl.module private @Identity
+  firrtl.module private @Identity(in %in: !firrtl.uint<4>, out %out: !firrtl.uint<4>) {
+    // CHECK: firrtl.matchingconnect %out, %c5_ui4
+    firrtl.matchingconnect %out, %in : !firrtl.uint<4>
+  }
+
+  // CHECK-LABEL: firrtl.module @PortRoundTrip
+  firrtl.module @PortRoundTrip(out %result: !firrtl.uint<4>) {
+    %c5_ui4 = firrtl.constant 5 : !firrtl.uint<4>
+    %a_in, %a_out = firrtl.instance a @Identity(in in: !firrtl.uint<4>, out out: !firrtl.uint<4>)
+    %b_in, %b_out = firrtl.instance b @Identity(in in: !firrtl.uint<4>, out out: !firrtl.uint<4>)
+    firrtl.matchingconnect %a_in, %c5_ui4 : !firrtl.uint<4>
+    // CHECK: firrtl.matchingconnect %b_in, %c5_ui4
+    firrtl.matchingconnect %b_in, %a_out : !firrtl.uint<4>
+    // CHECK: firrtl.matchingconnect %result, %c5_ui4
+    firrtl.matchingconnect %result, %b_out : !firrtl.uint<4>
+  }
+}
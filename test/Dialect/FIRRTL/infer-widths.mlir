@@ -540,6 +540,28 @@ firrtl.circuit "Foo" {
     firrtl.connect %1, %3 : !firrtl.uint, !firrtl.uint
   }
 
+  // Upper bounds on variables in a cycle are checked against the solution of
+  // the cycle. The probe of %r is bounded by %r, the resolved value by the
+  // probe, and %s by the width of a mux select.
+  // CHECK-LABEL: @RegCycleUpperBound
+  firrtl.module @RegCycleUpperBound(in %clk: !firrtl.clock, in %x: !firrtl.uint<3>) {
+    // CHECK: %r = firrtl.reg %clk : !firrtl.clock, !firrtl.uint<3>
+    // CHECK: %s = firrtl.reg %clk : !firrtl.clock, !firrtl.uint<1>
+    // CHECK: %0 = firrtl.ref.send %r : !firrtl.uint<3>
+    // CHECK: %1 = firrtl.ref.resolve %0 : !firrtl.probe<uint<3>>
+    // CHECK: %2 = firrtl.not %s : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %c1_ui1 = firrtl.constant 1 : !firrtl.uint<1>
+    %r = firrtl.reg %clk : !firrtl.clock, !firrtl.uint
+    %s = firrtl.reg %clk : !firrtl.clock, !firrtl.uint
+    %0 = firrtl.ref.send %r : !firrtl.uint
+    %1 = firrtl.ref.resolve %0 : !firrtl.probe<uint>
+    %2 = firrtl.not %s : (!firrtl.uint) -> !firrtl.uint
+    %3 = firrtl.mux(%s, %x, %1) : (!firrtl.uint, !firrtl.uint<3>, !firrtl.uint) -> !firrtl.uint
+    firrtl.connect %r, %3 : !firrtl.uint, !firrtl.uint
+    firrtl.connect %s, %c1_ui1 : !firrtl.uint, !firrtl.uint<1>
+    firrtl.connect %s, %2 : !firrtl.uint, !firrtl.uint
+  }
+
   // CHECK-LABEL: @RegShl
   firrtl.module @RegShl(in %clk: !firrtl.clock, in %x: !firrtl.uint<6>) {
     // CHECK: %0 = firrtl.reg %clk : !firrtl.clock, !firrtl.uint<6>
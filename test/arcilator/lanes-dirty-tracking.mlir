@@ -0,0 +1,7 @@
+// RUN: not arcilator %s --lanes=4 --dirty-tracking 2>&1 | FileCheck %s
+
+// CHECK: --dirty-tracking is not supported with --lanes > 1
+
+hw.module @Foo(in %a: i8, out b: i8) {
+  hw.output %a : i8
+}
@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 import argparse
+import hashlib
 import sys
 import json
 import re
@@ -46,10 +47,11 @@ class StateInfo:
   typ: StateType
   stride: Optional[int]
   depth: Optional[int]
+  dirtyOffset: Optional[int]
 
   def decode(d: dict) -> "StateInfo":
     return StateInfo(d["name"], d["offset"], d["numBits"], StateType(d["type"]),
-                     d.get("stride"), d.get("depth"))
+                     d.get("stride"), d.get("depth"), d.get("dirtyOffset"))
 
 
 @dataclass
@@ -66,16 +68,29 @@ class ModelInfo:
   states: List[StateInfo]
   io: List[StateInfo]
   hierarchy: List[StateHierarchy]
+  lanes: int
 
   def decode(d: dict) -> "ModelInfo":
     return ModelInfo(d["name"], d["numStateBytes"],
-                     [StateInfo.decode(d) for d in d["states"]], list(), list())
+                     [StateInfo.decode(d) for d in d["states"]], list(), list(),
+                     d.get("lanes", 1))
 
 
 with open(args.state_json, "r") as f:
   models = [ModelInfo.decode(d) for d in json.load(f)]
 
 
+# Fingerprint the state layout such that checkpoints taken from one model are
+# not restored into a model with a different layout.
+def layout_hash(model: ModelInfo) -> int:
+  layout = [model.name, model.numStateBytes]
+  for state in model.states:
+    layout.append((state.name, state.offset, state.numBits, state.typ.value,
+                   state.stride, state.depth, state.dirtyOffset))
+  digest = hashlib.sha256(repr(layout).encode()).digest()
+  return int.from_bytes(digest[:8], "little")
+
+
 # Organize the state by hierarchy.
 def group_state_by_hierarchy(
     states: List[StateInfo]) -> Tuple[List[StateInfo], List[StateHierarchy]]:
@@ -138,6 +153,10 @@ def format_signal(state: StateInfo) -> str:
   ]
   if state.typ == StateType.MEMORY:
     fields += [state.stride, state.depth]
+  if state.dirtyOffset is not None:
+    if state.typ != StateType.MEMORY:
+      fields += [0, 0]
+    fields += [state.dirtyOffset]
   fields = ", ".join((str(f) for f in fields))
   return f"Signal{{{fields}}}"
 
@@ -205,7 +224,17 @@ def format_view_hierarchy(hierarchy: StateHierarchy, depth: int) -> str:
   return f"struct {{{lines}}}"
 
 
+# Number of bytes between the copies of a state in consecutive lanes of a
+# batched model.
+def state_lane_size(state: StateInfo) -> int:
+  if state.typ == StateType.MEMORY:
+    return state.stride * state.depth
+  return (state.numBits + 7) // 8
+
+
 def state_cpp_ref(state: StateInfo) -> str:
+  if model.lanes > 1:
+    return f"*({state_cpp_type(state)}*)(state+{state.offset}+lane*{state_lane_size(state)})"
   return f"*({state_cpp_type(state)}*)(state+{state.offset})"
 
 
@@ -232,6 +261,7 @@ print("#include \"arcilator-runtime.h\"")
 
 for model in models:
   sys.stderr.write(f"Generating `{model.name}` model\n")
+  model_hash = layout_hash(model)
 
   reserved = {"state"}
 
@@ -250,6 +280,8 @@ for model in models:
   print(f"  static const char *name;")
   print(f"  static const unsigned numStates;")
   print(f"  static const unsigned numStateBytes;")
+  print(f"  static const uint64_t layoutHash;")
+  print(f"  static const unsigned numLanes;")
   print(f"  static const std::array<Signal, {len(model.io)}> io;")
   print(f"  static const Hierarchy hierarchy;")
   print("};")
@@ -259,6 +291,9 @@ for model in models:
   print(
       f"const unsigned {model.name}Layout::numStateBytes = {model.numStateBytes};"
   )
+  print(
+      f"const uint64_t {model.name}Layout::layoutHash = {model_hash:#x}ull;")
+  print(f"const unsigned {model.name}Layout::numLanes = {model.lanes};")
   print(
       f"const std::array<Signal, {len(model.io)}> {model.name}Layout::io = {{")
   for io in model.io:
@@ -280,7 +315,10 @@ for model in models:
   )
   print("  uint8_t *state;")
   print()
-  print(f"  {model.name}View(uint8_t *state) :")
+  if model.lanes > 1:
+    print(f"  {model.name}View(uint8_t *state, unsigned lane = 0) :")
+  else:
+    print(f"  {model.name}View(uint8_t *state) :")
   for io in model.io:
     print(f"    {io.name}({state_cpp_ref(io)}),")
   print(
@@ -300,13 +338,51 @@ for model in models:
       f"  {model.name}() : storage({model.name}Layout::numStateBytes, 0), view(&storage[0]) {{}}"
   )
   print(f"  void eval() {{ {model.name}_eval(&storage[0]); }}")
+  print("  void reset() { std::fill(storage.begin(), storage.end(), 0); }")
+  # The layout only describes the first lane of a batched model, so there is no
+  # tracing or dirty flag support for it. Its lanes are accessed through views.
+  if model.lanes > 1:
+    print(
+        f"  {model.name}View lane(unsigned i) {{ return {model.name}View(&storage[0], i); }}"
+    )
+  else:
+    print(
+        f"  void clearDirty() {{ clearDirtyFlags<{model.name}Layout>(&storage[0]); }}"
+    )
+    print(
+        f"  ValueChangeDump<{model.name}Layout> vcd(std::basic_ostream<char> &os) {{"
+    )
+    print(f"    ValueChangeDump<{model.name}Layout> vcd(os, &storage[0]);")
+    print("    vcd.writeHeader();")
+    print("    vcd.writeDumpvars();")
+    print("    return vcd;")
+    print("  }")
+    print(
+        f"  std::unique_ptr<BinaryTrace<{model.name}Layout>> trace(std::basic_ostream<char> &os) {{"
+    )
+    print(
+        f"    auto trace = std::make_unique<BinaryTrace<{model.name}Layout>>(os, &storage[0]);"
+    )
+    print("    trace->writeHeader();")
+    print("    return trace;")
+    print("  }")
+  print("  bool save(const char *path, uint64_t time = 0) const {")
+  print(
+      f"    return saveCheckpoint<{model.name}Layout>(path, &storage[0], time);"
+  )
+  print("  }")
+  print("  bool restore(const char *path, uint64_t *time = nullptr) {")
+  print(
+      f"    return restoreCheckpoint<{model.name}Layout>(path, &storage[0], time);"
+  )
+  print("  }")
+  print(
+      "  bool restore(const Checkpoint &checkpoint, uint64_t *time = nullptr) {"
+  )
   print(
-      f"  ValueChangeDump<{model.name}Layout> vcd(std::basic_ostream<char> &os) {{"
+      f"    return checkpoint.restore(&storage[0], {model.name}Layout::numStateBytes,"
   )
-  print(f"    ValueChangeDump<{model.name}Layout> vcd(os, &storage[0]);")
-  print("    vcd.writeHeader();")
-  print("    vcd.writeDumpvars();")
-  print("    return vcd;")
+  print(f"                              {model.name}Layout::layoutHash, time);")
   print("  }")
   print("};")
 
@@ -1,12 +1,30 @@
 // NOLINTBEGIN
 #pragma once
+#include <algorithm>
 #include <array>
+#include <cerrno>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <fstream>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 struct Signal {
   const char *name;
   unsigned offset;
@@ -15,6 +33,9 @@ struct Signal {
   // for memories:
   unsigned stride;
   unsigned depth;
+  // offset of a flag set by the model whenever the signal is written, or -1 if
+  // the model was compiled without dirty tracking
+  int dirtyOffset = -1;
 };
 
 struct Hierarchy {
@@ -37,10 +58,49 @@ struct Memory {
   } words[Depth];
 };
 
+/// Collect the dirty flag offsets of the given signals and of all signals in
+/// `hierarchy`, without duplicates.
+inline std::vector<int> collectDirtyFlags(const Signal *signals,
+                                          unsigned numSignals,
+                                          const Hierarchy &hierarchy) {
+  std::vector<int> offsets;
+  std::function<void(const Signal *, unsigned)> addSignals =
+      [&](const Signal *signals, unsigned numSignals) {
+        for (unsigned i = 0; i < numSignals; ++i)
+          if (signals[i].dirtyOffset >= 0)
+            offsets.push_back(signals[i].dirtyOffset);
+      };
+  std::function<void(const Hierarchy &)> addHierarchy =
+      [&](const Hierarchy &hierarchy) {
+        addSignals(hierarchy.states, hierarchy.numStates);
+        for (unsigned i = 0; i < hierarchy.numChildren; ++i)
+          addHierarchy(hierarchy.children[i]);
+      };
+  addSignals(signals, numSignals);
+  addHierarchy(hierarchy);
+  std::sort(offsets.begin(), offsets.end());
+  offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+  return offsets;
+}
+
+/// Clear the dirty flags of a model compiled with dirty tracking. The traces
+/// only read the flags, such that several of them can observe the same model.
+/// It is up to the driver to call this once all traces have recorded a
+/// timestep; flags which are never cleared merely make the traces compare
+/// every signal.
+template <class ModelLayout>
+void clearDirtyFlags(uint8_t *state) {
+  static const std::vector<int> offsets =
+      collectDirtyFlags(ModelLayout::io.data(), ModelLayout::io.size(),
+                        ModelLayout::hierarchy);
+  for (int offset : offsets)
+    state[offset] = 0;
+}
+
 template <class ModelLayout>
 class ValueChangeDump {
 public:
-  ValueChangeDump(std::basic_ostream<char> &os, const uint8_t *state)
+  ValueChangeDump(std::basic_ostream<char> &os, uint8_t *state)
       : os(os), state(state) {}
 
   void writeHeader(bool withHierarchy = true) {
@@ -98,6 +158,11 @@ public:
 
   void writeValues(bool includeUnchanged = false) {
     for (auto &signal : signals) {
+      // Signals with a clear dirty flag have not been written since the flags
+      // were last cleared and cannot have changed.
+      if (!includeUnchanged && signal.state.dirtyOffset >= 0 &&
+          !state[signal.state.dirtyOffset])
+        continue;
       const uint8_t *valNew = state + signal.offset;
       uint8_t *valOld = &previousValues[0] + signal.previousOffset;
       size_t numBytes = (signal.state.numBits + 7) / 8;
@@ -154,9 +219,574 @@ private:
   }
 
   std::basic_ostream<char> &os;
-  const uint8_t *state;
+  uint8_t *state;
   std::vector<VcdSignal> signals;
   std::vector<uint8_t> previousValues;
 };
 
+/// Compact binary alternative to `ValueChangeDump`. The simulation thread only
+/// copies the traced signals into one of a small set of snapshot buffers, while
+/// a dedicated writer thread compares snapshots, delta-encodes the changed
+/// signals, and writes the result in blocks. Use `arcilator-trace-to-vcd.py` to
+/// convert the resulting trace into a VCD file.
+///
+/// The trace starts with the magic `ARCTRACE` followed by definition records:
+/// `S <name>` opens a scope, `U` closes it, and `V <kind> <bits> <name>`
+/// declares the next signal, where kind is 0 for wires and 1 for registers.
+/// `E` ends the definitions. It is followed by `B <numSteps> <size> <data>`
+/// blocks and a final `Z`. Each step in a block consists of the time increment
+/// and a list of `<id delta> <value>` pairs terminated by a zero id delta.
+/// Values are XORed with the signal's previous value; signals up to 8 bytes
+/// store the result as a varint, wider ones as alternating zero and literal
+/// byte runs. Strings and all integers besides the kind are LEB128 varints.
+///
+/// If the model was compiled with dirty tracking, only signals whose dirty flag
+/// is set are copied and compared. The flags are left for the driver to clear,
+/// see `clearDirtyFlags`.
+template <class ModelLayout>
+class BinaryTrace {
+public:
+  BinaryTrace(std::basic_ostream<char> &os, uint8_t *state,
+              unsigned numBuffers = 4)
+      : os(os), state(state), snapshots(numBuffers < 2 ? 2 : numBuffers) {}
+  BinaryTrace(const BinaryTrace &) = delete;
+  BinaryTrace &operator=(const BinaryTrace &) = delete;
+  ~BinaryTrace() { finish(); }
+
+  /// Write the signal definitions and the initial values of all signals, and
+  /// start the writer thread.
+  void writeHeader(bool withHierarchy = true) {
+    std::string header = "ARCTRACE";
+
+    auto writeVar = [&](const Signal &state, unsigned offset,
+                        const std::string &name) {
+      header += 'V';
+      header += char(state.type == Signal::Register ||
+                     state.type == Signal::Memory);
+      appendVarint(header, state.numBits);
+      appendString(header, name);
+      unsigned numBytes = (state.numBits + 7) / 8;
+      unsigned id = signals.size();
+      signals.push_back(
+          TraceSignal{offset, numBytes, snapshotSize, state.dirtyOffset});
+      snapshotSize += numBytes;
+      if (state.dirtyOffset < 0) {
+        untrackedIds.push_back(id);
+        return;
+      }
+      trackedIds.push_back(id);
+    };
+
+    auto writeSignal = [&](const Signal &state) {
+      if (state.type != Signal::Memory) {
+        writeVar(state, state.offset, state.name);
+        return;
+      }
+      for (unsigned i = 0; i < state.depth; ++i)
+        writeVar(state, state.offset + i * state.stride,
+                 std::string(state.name) + "[" + std::to_string(i) + "]");
+    };
+
+    std::function<void(const Hierarchy &)> writeHierarchy =
+        [&](const Hierarchy &hierarchy) {
+          header += 'S';
+          appendString(header, hierarchy.name);
+          for (unsigned i = 0; i < hierarchy.numStates; ++i)
+            writeSignal(hierarchy.states[i]);
+          for (unsigned i = 0; i < hierarchy.numChildren; ++i)
+            writeHierarchy(hierarchy.children[i]);
+          header += 'U';
+        };
+
+    header += 'S';
+    appendString(header, ModelLayout::name);
+    for (auto &port : ModelLayout::io)
+      writeSignal(port);
+    if (withHierarchy)
+      writeHierarchy(ModelLayout::hierarchy);
+    header += 'U';
+    header += 'E';
+    os.write(header.data(), header.size());
+
+    // Merge untracked signals that are adjacent in the state into larger
+    // copies.
+    for (unsigned id : untrackedIds) {
+      auto &signal = signals[id];
+      if (!copies.empty() &&
+          copies.back().offset + copies.back().numBytes == signal.offset &&
+          copies.back().snapshotOffset + copies.back().numBytes ==
+              signal.snapshotOffset)
+        copies.back().numBytes += signal.numBytes;
+      else
+        copies.push_back(signal);
+    }
+
+    for (auto &snapshot : snapshots) {
+      snapshot.data.resize(snapshotSize);
+      freeSnapshots.push_back(&snapshot);
+    }
+    previous.resize(snapshotSize);
+    writer = std::thread([this] { runWriter(); });
+    writeTimestep(0);
+  }
+
+  /// Advance the time and record the current value of all signals.
+  void writeTimestep(size_t timeIncrement) {
+    time += timeIncrement;
+    Snapshot *snapshot;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      snapshotFreed.wait(lock, [&] { return !freeSnapshots.empty(); });
+      snapshot = freeSnapshots.back();
+      freeSnapshots.pop_back();
+    }
+    for (auto &copy : copies)
+      std::memcpy(&snapshot->data[copy.snapshotOffset], state + copy.offset,
+                  copy.numBytes);
+    snapshot->written.clear();
+    for (unsigned id : trackedIds) {
+      auto &signal = signals[id];
+      if (!state[signal.dirtyOffset] && !firstStep)
+        continue;
+      std::memcpy(&snapshot->data[signal.snapshotOffset],
+                  state + signal.offset, signal.numBytes);
+      snapshot->written.push_back(id);
+    }
+    snapshot->timeIncrement = timeIncrement;
+    snapshot->initial = firstStep;
+    firstStep = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      fullSnapshots.push_back(snapshot);
+    }
+    snapshotFilled.notify_one();
+  }
+
+  /// Wait for all pending snapshots to be written and terminate the trace.
+  void finish() {
+    if (!writer.joinable())
+      return;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+    }
+    snapshotFilled.notify_one();
+    writer.join();
+    os.put('Z');
+    os.flush();
+  }
+
+  size_t time = 0;
+
+private:
+  struct TraceSignal {
+    unsigned offset;
+    unsigned numBytes;
+    unsigned snapshotOffset;
+    int dirtyOffset;
+  };
+
+  struct Snapshot {
+    std::vector<uint8_t> data;
+    /// The tracked signals whose value was copied into `data`.
+    std::vector<unsigned> written;
+    size_t timeIncrement;
+    bool initial;
+  };
+
+  static void appendVarint(std::string &out, uint64_t value) {
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      out += char(value ? byte | 0x80 : byte);
+    } while (value);
+  }
+
+  static void appendString(std::string &out, const std::string &str) {
+    appendVarint(out, str.size());
+    out += str;
+  }
+
+  void runWriter() {
+    while (true) {
+      Snapshot *snapshot;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        snapshotFilled.wait(lock,
+                            [&] { return done || !fullSnapshots.empty(); });
+        if (fullSnapshots.empty())
+          break;
+        snapshot = fullSnapshots.front();
+        fullSnapshots.pop_front();
+      }
+      encodeStep(*snapshot);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSnapshots.push_back(snapshot);
+      }
+      snapshotFreed.notify_one();
+      if (block.size() >= blockSize)
+        flushBlock();
+    }
+    flushBlock();
+  }
+
+  void encodeStep(const Snapshot &snapshot) {
+    appendVarint(block, snapshot.timeIncrement);
+    unsigned lastId = 0;
+
+    // Visit the untracked signals and the written tracked signals in order of
+    // increasing ID, such that the ID deltas remain positive.
+    auto untracked = untrackedIds.begin();
+    auto written = snapshot.written.begin();
+    while (untracked != untrackedIds.end() ||
+           written != snapshot.written.end()) {
+      unsigned id;
+      if (written == snapshot.written.end() ||
+          (untracked != untrackedIds.end() && *untracked < *written))
+        id = *untracked++;
+      else
+        id = *written++;
+      auto &signal = signals[id];
+      const uint8_t *valNew = &snapshot.data[signal.snapshotOffset];
+      uint8_t *valOld = &previous[signal.snapshotOffset];
+      if (!snapshot.initial &&
+          std::memcmp(valNew, valOld, signal.numBytes) == 0)
+        continue;
+      appendVarint(block, id + 1 - lastId);
+      lastId = id + 1;
+      if (signal.numBytes <= 8) {
+        uint64_t delta = 0;
+        for (unsigned i = 0; i < signal.numBytes; ++i)
+          delta |= uint64_t(valNew[i] ^ valOld[i]) << (8 * i);
+        appendVarint(block, delta);
+      } else {
+        encodeWide(valNew, valOld, signal.numBytes);
+      }
+      std::memcpy(valOld, valNew, signal.numBytes);
+    }
+    appendVarint(block, 0);
+    ++blockSteps;
+  }
+
+  /// Encode the XOR of a wide value as alternating runs of zero bytes and
+  /// literal bytes, starting with a zero run.
+  void encodeWide(const uint8_t *valNew, const uint8_t *valOld,
+                  unsigned numBytes) {
+    unsigned i = 0;
+    while (i < numBytes) {
+      unsigned zeros = 0;
+      while (i + zeros < numBytes && valNew[i + zeros] == valOld[i + zeros])
+        ++zeros;
+      i += zeros;
+      unsigned literals = 0;
+      while (i + literals < numBytes &&
+             valNew[i + literals] != valOld[i + literals])
+        ++literals;
+      appendVarint(block, zeros);
+      appendVarint(block, literals);
+      for (unsigned j = 0; j < literals; ++j)
+        block += char(valNew[i + j] ^ valOld[i + j]);
+      i += literals;
+    }
+  }
+
+  void flushBlock() {
+    if (blockSteps == 0)
+      return;
+    std::string prefix = "B";
+    appendVarint(prefix, blockSteps);
+    appendVarint(prefix, block.size());
+    os.write(prefix.data(), prefix.size());
+    os.write(block.data(), block.size());
+    block.clear();
+    blockSteps = 0;
+  }
+
+  static constexpr size_t blockSize = 1 << 16;
+
+  std::basic_ostream<char> &os;
+  uint8_t *state;
+  std::vector<TraceSignal> signals;
+  std::vector<TraceSignal> copies;
+  std::vector<unsigned> untrackedIds;
+  std::vector<unsigned> trackedIds;
+  unsigned snapshotSize = 0;
+  bool firstStep = true;
+
+  std::vector<Snapshot> snapshots;
+  std::vector<Snapshot *> freeSnapshots;
+  std::deque<Snapshot *> fullSnapshots;
+  std::mutex mutex;
+  std::condition_variable snapshotFilled;
+  std::condition_variable snapshotFreed;
+  std::thread writer;
+  bool done = false;
+
+  // Only accessed by the writer thread.
+  std::vector<uint8_t> previous;
+  std::string block;
+  size_t blockSteps = 0;
+};
+
+/// Header of a checkpoint file written by `saveCheckpoint`. It is followed by
+/// the raw contents of the model's state buffer, which includes memories.
+struct CheckpointHeader {
+  char magic[8];
+  uint64_t layoutHash;
+  uint64_t numStateBytes;
+  uint64_t time;
+};
+
+static constexpr char checkpointMagic[8] = {'A', 'R', 'C', 'C',
+                                            'K', 'P', 'T', '1'};
+
+/// A checkpoint file mapped into memory. Restoring from the same mapping many
+/// times only costs a copy of the state buffer, which makes it cheap to fork
+/// many simulations off a single warmed-up state.
+class Checkpoint {
+public:
+  explicit Checkpoint(const char *path) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 &&
+        size_t(st.st_size) >= sizeof(CheckpointHeader)) {
+      void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        mapping = static_cast<const uint8_t *>(addr);
+        mappingSize = st.st_size;
+      }
+    }
+    ::close(fd);
+#else
+    std::ifstream is(path, std::ios::binary);
+    buffer.assign(std::istreambuf_iterator<char>(is),
+                  std::istreambuf_iterator<char>());
+    if (buffer.size() >= sizeof(CheckpointHeader)) {
+      mapping = buffer.data();
+      mappingSize = buffer.size();
+    }
+#endif
+    if (mapping && (std::memcmp(header().magic, checkpointMagic, 8) != 0 ||
+                    mappingSize - sizeof(CheckpointHeader) !=
+                        header().numStateBytes))
+      unmap();
+  }
+  Checkpoint(const Checkpoint &) = delete;
+  Checkpoint &operator=(const Checkpoint &) = delete;
+  ~Checkpoint() { unmap(); }
+
+  /// Whether the file could be mapped and looks like a checkpoint.
+  bool valid() const { return mapping != nullptr; }
+  const CheckpointHeader &header() const {
+    return *reinterpret_cast<const CheckpointHeader *>(mapping);
+  }
+  const uint8_t *data() const { return mapping + sizeof(CheckpointHeader); }
+
+  /// Copy the checkpointed state into `state`. Fails if the checkpoint was
+  /// taken from a model with a different state layout.
+  bool restore(uint8_t *state, size_t numStateBytes, uint64_t layoutHash,
+               uint64_t *time = nullptr) const {
+    if (!valid() || header().layoutHash != layoutHash ||
+        header().numStateBytes != numStateBytes)
+      return false;
+    std::memcpy(state, data(), numStateBytes);
+    if (time)
+      *time = header().time;
+    return true;
+  }
+
+private:
+  void unmap() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapping)
+      ::munmap(const_cast<uint8_t *>(mapping), mappingSize);
+#else
+    buffer.clear();
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+  }
+
+  const uint8_t *mapping = nullptr;
+  size_t mappingSize = 0;
+#if !defined(__unix__) && !defined(__APPLE__)
+  std::vector<uint8_t> buffer;
+#endif
+};
+
+/// Write the state buffer of a model to a checkpoint file. The `time` is
+/// stored alongside the state and returned again on restore.
+inline bool saveCheckpoint(const char *path, const uint8_t *state,
+                           size_t numStateBytes, uint64_t layoutHash,
+                           uint64_t time = 0) {
+  CheckpointHeader header;
+  std::memcpy(header.magic, checkpointMagic, 8);
+  header.layoutHash = layoutHash;
+  header.numStateBytes = numStateBytes;
+  header.time = time;
+  size_t size = sizeof(header) + numStateBytes;
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  if (::ftruncate(fd, size) != 0) {
+    ::close(fd);
+    return false;
+  }
+  void *addr = ::mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+  auto *bytes = static_cast<uint8_t *>(addr);
+  std::memcpy(bytes, &header, sizeof(header));
+  std::memcpy(bytes + sizeof(header), state, numStateBytes);
+  return ::munmap(addr, size) == 0;
+#else
+  std::ofstream os(path, std::ios::binary);
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  os.write(reinterpret_cast<const char *>(state), numStateBytes);
+  return bool(os);
+#endif
+}
+
+template <class ModelLayout>
+bool saveCheckpoint(const char *path, const uint8_t *state, uint64_t time = 0) {
+  return saveCheckpoint(path, state, ModelLayout::numStateBytes,
+                        ModelLayout::layoutHash, time);
+}
+
+template <class ModelLayout>
+bool restoreCheckpoint(const char *path, uint8_t *state,
+                       uint64_t *time = nullptr) {
+  return Checkpoint(path).restore(state, ModelLayout::numStateBytes,
+                                  ModelLayout::layoutHash, time);
+}
+
+/// Thread pool backing models compiled with `--parallel-clocks`. The model
+/// calls `arcRuntimeParallelFor` with a mask of independent clock functions to
+/// evaluate, and expects all of them to have completed once the call returns.
+/// The number of threads defaults to the hardware concurrency and can be
+/// overridden through the `ARC_NUM_THREADS` environment variable.
+class ParallelRuntime {
+public:
+  using TaskFn = void (*)(void *, uint32_t);
+
+  static ParallelRuntime &get() {
+    static ParallelRuntime runtime;
+    return runtime;
+  }
+
+  void run(TaskFn fn, void *state, uint64_t mask) {
+    // Evaluate single tasks directly on the calling thread.
+    if (workers.empty() || (mask & (mask - 1)) == 0) {
+      for (uint32_t i = 0; mask != 0; ++i, mask >>= 1)
+        if (mask & 1)
+          fn(state, i);
+      return;
+    }
+
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      taskFn = fn;
+      taskState = state;
+      pending = mask;
+      remaining = 0;
+      for (uint64_t m = mask; m != 0; m &= m - 1)
+        ++remaining;
+    }
+    wakeup.notify_all();
+
+    // Help with the work and then wait for the workers to finish theirs.
+    std::unique_lock<std::mutex> lock(mutex);
+    work(lock);
+    finished.wait(lock, [&] { return remaining == 0; });
+  }
+
+  ~ParallelRuntime() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      shutdown = true;
+    }
+    wakeup.notify_all();
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+private:
+  ParallelRuntime() {
+    // The dispatching thread participates in the work as well.
+    for (unsigned i = 1, e = getNumThreads(); i < e; ++i)
+      workers.emplace_back([this] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          wakeup.wait(lock, [&] { return shutdown || pending != 0; });
+          if (shutdown)
+            return;
+          work(lock);
+        }
+      });
+  }
+
+  /// Determine the number of threads from `ARC_NUM_THREADS`, falling back to
+  /// the hardware concurrency if it is unset or not a positive number. A
+  /// dispatch contains at most 64 tasks, so more threads than that are useless.
+  static unsigned getNumThreads() {
+    if (const char *env = std::getenv("ARC_NUM_THREADS")) {
+      char *end = nullptr;
+      errno = 0;
+      long value = std::strtol(env, &end, 10);
+      if (errno == 0 && end != env && *end == '\0' && value > 0)
+        return std::min<long>(value, 64);
+    }
+    return std::thread::hardware_concurrency();
+  }
+
+  /// Claim and evaluate pending tasks until none are left. Must be called with
+  /// the lock held, which is released while a task is being evaluated.
+  void work(std::unique_lock<std::mutex> &lock) {
+    while (pending != 0) {
+      uint32_t index = 0;
+      while (!(pending & (uint64_t(1) << index)))
+        ++index;
+      pending &= pending - 1;
+      TaskFn fn = taskFn;
+      void *state = taskState;
+      lock.unlock();
+      fn(state, index);
+      lock.lock();
+      if (--remaining == 0)
+        finished.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex dispatchMutex;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable finished;
+  TaskFn taskFn = nullptr;
+  void *taskState = nullptr;
+  uint64_t pending = 0;
+  unsigned remaining = 0;
+  bool shutdown = false;
+};
+
+// Every translation unit including this header provides a definition, which
+// the linker merges. It has to be emitted even if the translation unit itself
+// does not call it, since the references come from the compiled model.
+#if defined(__GNUC__)
+#define ARC_RUNTIME_USED __attribute__((used))
+#else
+#define ARC_RUNTIME_USED
+#endif
+extern "C" inline ARC_RUNTIME_USED void
+arcRuntimeParallelFor(ParallelRuntime::TaskFn fn, void *state, uint64_t mask) {
+  ParallelRuntime::get().run(fn, state, mask);
+}
+
 // NOLINTEND
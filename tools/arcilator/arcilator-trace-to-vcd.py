@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+import argparse
+import sys
+from typing import *
+
+# Parse command line arguments.
+parser = argparse.ArgumentParser(
+    description="Convert a binary Arc model trace into a VCD file")
+parser.add_argument("trace",
+                    metavar="TRACE",
+                    help="binary trace written by `BinaryTrace`")
+parser.add_argument("-o",
+                    metavar="VCD",
+                    dest="output",
+                    default="-",
+                    help="output VCD file (default: stdout)")
+args = parser.parse_args()
+
+
+class TraceReader:
+
+  def __init__(self, data: bytes):
+    self.data = data
+    self.pos = 0
+
+  def byte(self) -> int:
+    b = self.data[self.pos]
+    self.pos += 1
+    return b
+
+  def varint(self) -> int:
+    value = 0
+    shift = 0
+    while True:
+      b = self.byte()
+      value |= (b & 0x7f) << shift
+      shift += 7
+      if not b & 0x80:
+        return value
+
+  def string(self) -> str:
+    n = self.varint()
+    s = self.data[self.pos:self.pos + n].decode()
+    self.pos += n
+    return s
+
+  def raw(self, n: int) -> bytes:
+    b = self.data[self.pos:self.pos + n]
+    self.pos += n
+    return b
+
+
+# Same identifier scheme as `ValueChangeDump` in `arcilator-runtime.h`.
+def abbrev(index: int) -> str:
+  s = ""
+  rest = index + 1
+  while rest != 0:
+    c = (rest % 84) + 33
+    if c >= ord('0'):
+      c += 10
+    s += chr(c)
+    rest //= 84
+  return s
+
+
+with open(args.trace, "rb") as f:
+  reader = TraceReader(f.read())
+if reader.raw(8) != b"ARCTRACE":
+  sys.exit(f"error: `{args.trace}` is not an Arc trace")
+
+out = sys.stdout if args.output == "-" else open(args.output, "w")
+out.write("$date\n    October 21, 2015\n$end\n")
+out.write("$version\n    Some cryptic MLIR magic\n$end\n")
+out.write("$timescale 1ns $end\n")
+
+# Read the signal definitions.
+widths: List[int] = []
+while True:
+  tag = chr(reader.byte())
+  if tag == "S":
+    out.write(f"$scope module {reader.string()} $end\n")
+  elif tag == "U":
+    out.write("$upscope $end\n")
+  elif tag == "V":
+    kind = "reg" if reader.byte() else "wire"
+    bits = reader.varint()
+    name = reader.string()
+    out.write(f"$var {kind} {bits} {abbrev(len(widths))} {name}")
+    if bits > 1:
+      out.write(f" [{bits - 1}:0]")
+    out.write(" $end\n")
+    widths.append(bits)
+  elif tag == "E":
+    break
+  else:
+    sys.exit(f"error: unexpected definition record `{tag}`")
+out.write("$enddefinitions $end\n")
+
+# Replay the value changes.
+values = [0] * len(widths)
+time = 0
+first = True
+while True:
+  tag = chr(reader.byte())
+  if tag == "Z":
+    break
+  if tag != "B":
+    sys.exit(f"error: unexpected record `{tag}`")
+  num_steps = reader.varint()
+  reader.varint()  # block size
+  for _ in range(num_steps):
+    time += reader.varint()
+    out.write("$dumpvars\n" if first else f"#{time}\n")
+    first = False
+    id = 0
+    while True:
+      delta = reader.varint()
+      if delta == 0:
+        break
+      id += delta
+      bits = widths[id - 1]
+      num_bytes = (bits + 7) // 8
+      if num_bytes <= 8:
+        xor = reader.varint()
+      else:
+        xor_bytes = bytearray()
+        while len(xor_bytes) < num_bytes:
+          xor_bytes += bytes(reader.varint())
+          xor_bytes += reader.raw(reader.varint())
+        xor = int.from_bytes(xor_bytes, "little")
+      values[id - 1] ^= xor
+      value = format(values[id - 1] & ((1 << bits) - 1), f"0{bits}b")
+      if bits > 1:
+        out.write(f"b{value} {abbrev(id - 1)}\n")
+      else:
+        out.write(f"{value}{abbrev(id - 1)}\n")
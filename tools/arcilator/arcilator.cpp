@@ -52,15 +52,22 @@
 #include "mlir/Target/LLVMIR/Export.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Host.h"
 
 #include <optional>
 
@@ -170,6 +177,36 @@ static llvm::cl::opt<unsigned> splitFuncsThreshold(
         "Split large MLIR functions that occur above the given size threshold"),
     llvm::cl::ValueOptional, llvm::cl::cat(mainCategory));
 
+static llvm::cl::opt<bool> dirtyTracking(
+    "dirty-tracking",
+    llvm::cl::desc("Maintain a flag for each observable state that is set "
+                   "whenever the state is written, to speed up tracing"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<bool> parallelClocks(
+    "parallel-clocks",
+    llvm::cl::desc("Evaluate independent clock trees concurrently on the "
+                   "runtime's thread pool"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<bool> skipInactive(
+    "skip-inactive",
+    llvm::cl::desc("Skip clock trees and passthrough logic whose inputs did "
+                   "not change since they were last evaluated"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<bool> skipCounters(
+    "skip-counters",
+    llvm::cl::desc("Count how often each group is skipped by --skip-inactive "
+                   "in a named state of the model"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<unsigned> numLanes(
+    "lanes",
+    llvm::cl::desc("Simulate this many independent instances of the model "
+                   "with each call to its eval function"),
+    llvm::cl::init(1), llvm::cl::cat(mainCategory));
+
 // Options to control early-out from pipeline.
 enum Until {
   UntilPreprocessing,
@@ -196,11 +233,19 @@ static llvm::cl::opt<Until> runUntilAfter(
     runUntilValues, llvm::cl::init(UntilEnd), llvm::cl::cat(mainCategory));
 
 // Options to control the output format.
-enum OutputFormat { OutputMLIR, OutputLLVM, OutputRunJIT, OutputDisabled };
+enum OutputFormat {
+  OutputMLIR,
+  OutputLLVM,
+  OutputObject,
+  OutputRunJIT,
+  OutputDisabled
+};
 static llvm::cl::opt<OutputFormat> outputFormat(
     llvm::cl::desc("Specify output format"),
     llvm::cl::values(clEnumValN(OutputMLIR, "emit-mlir", "Emit MLIR dialects"),
                      clEnumValN(OutputLLVM, "emit-llvm", "Emit LLVM"),
+                     clEnumValN(OutputObject, "emit-object",
+                                "Emit a native object file for the host"),
                      clEnumValN(OutputRunJIT, "run",
                                 "Run the simulation and emit its output"),
                      clEnumValN(OutputDisabled, "disable-output",
@@ -213,6 +258,149 @@ static llvm::cl::opt<std::string>
                                  "simulation to run when output is set to run"),
                   llvm::cl::init("entry"), llvm::cl::cat(mainCategory));
 
+static llvm::cl::opt<std::string> cacheDir(
+    "cache-dir",
+    llvm::cl::desc("Cache object files emitted with --emit-object in this "
+                   "directory and reuse them if the input is unchanged"),
+    llvm::cl::value_desc("directory"), llvm::cl::init(""),
+    llvm::cl::cat(mainCategory));
+
+/// The key under which the output of the current run is cached, if any.
+static std::string cacheKey;
+
+//===----------------------------------------------------------------------===//
+// JIT Runtime Support
+//===----------------------------------------------------------------------===//
+
+#ifdef ARCILATOR_ENABLE_JIT
+/// Runtime entry point for `arc.parallel_dispatch` in JIT-compiled models.
+/// Models compiled ahead of time use the implementation in
+/// `arcilator-runtime.h` instead.
+static void arcRuntimeParallelFor(void (*fn)(void *, uint32_t), void *state,
+                                  uint64_t mask) {
+  SmallVector<uint32_t, 64> tasks;
+  for (uint32_t i = 0; i < 64; ++i)
+    if (mask & (uint64_t(1) << i))
+      tasks.push_back(i);
+  llvm::parallelFor(0, tasks.size(), [&](size_t i) { fn(state, tasks[i]); });
+}
+#endif // ARCILATOR_ENABLE_JIT
+
+//===----------------------------------------------------------------------===//
+// Ahead-of-Time Compilation
+//===----------------------------------------------------------------------===//
+
+#ifdef ARCILATOR_ENABLE_JIT
+/// Optimize an LLVM module for the host and compile it to an object file.
+static LogicalResult emitObjectFile(llvm::Module &llvmModule,
+                                    SmallVectorImpl<char> &object) {
+  auto tmBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!tmBuilder) {
+    llvm::errs() << "failed to detect host target: "
+                 << llvm::toString(tmBuilder.takeError()) << "\n";
+    return failure();
+  }
+  tmBuilder->setCodeGenOptLevel(llvm::CodeGenOptLevel::Aggressive);
+  tmBuilder->setRelocationModel(llvm::Reloc::PIC_);
+  auto tm = tmBuilder->createTargetMachine();
+  if (!tm) {
+    llvm::errs() << "failed to create target machine: "
+                 << llvm::toString(tm.takeError()) << "\n";
+    return failure();
+  }
+  mlir::ExecutionEngine::setupTargetTripleAndDataLayout(&llvmModule,
+                                                        tm->get());
+
+  auto optimize = mlir::makeOptimizingTransformer(
+      /*optLevel=*/3, /*sizeLevel=*/0, /*targetMachine=*/tm->get());
+  if (auto err = optimize(&llvmModule)) {
+    llvm::errs() << "failed to optimize LLVM module: "
+                 << llvm::toString(std::move(err)) << "\n";
+    return failure();
+  }
+
+  llvm::raw_svector_ostream os(object);
+  llvm::legacy::PassManager pm;
+  if ((*tm)->addPassesToEmitFile(pm, os, nullptr,
+                                 llvm::CodeGenFileType::ObjectFile)) {
+    llvm::errs() << "target does not support emitting object files\n";
+    return failure();
+  }
+  pm.run(llvmModule);
+  return success();
+}
+#endif // ARCILATOR_ENABLE_JIT
+
+/// Compute the key under which the object file for `input` is cached. Besides
+/// the input itself, this covers the tool version, the host, the input file
+/// name, which ends up in the locations of the generated code, and all options
+/// that affect the generated code.
+static std::string computeCacheKey(StringRef input) {
+  std::string options;
+  llvm::raw_string_ostream os(options);
+  os << getCirctVersion() << '\0' << llvm::sys::getProcessTriple() << '\0'
+     << llvm::sys::getHostCPUName() << '\0' << inputFilename << '\0';
+  for (bool flag :
+       {bool(observePorts), bool(observeWires), bool(observeNamedValues),
+        bool(observeRegisters), bool(observeMemories), bool(shouldInline),
+        bool(shouldDedup), bool(shouldDetectEnables), bool(shouldDetectResets),
+        bool(shouldMakeLUTs), bool(printDebugInfo), bool(dirtyTracking),
+        bool(parallelClocks), bool(skipInactive), bool(skipCounters)})
+    os << (flag ? '1' : '0');
+  os << ' ' << unsigned(numLanes) << ' '
+     << (splitFuncsThreshold.getNumOccurrences() ? unsigned(splitFuncsThreshold)
+                                                 : 0U)
+     << '\0';
+
+  llvm::SHA256 hasher;
+  hasher.update(options);
+  hasher.update(input);
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+/// Get the path of a file in the cache directory belonging to the current
+/// cache key.
+static SmallString<128> getCachePath(StringRef extension) {
+  SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, cacheKey + extension);
+  return path;
+}
+
+/// Write a cached object file to `os` and restore the state file next to it.
+/// Fails if there is no complete cache entry for the current cache key.
+static LogicalResult loadFromCache(raw_ostream &os) {
+  auto object = llvm::MemoryBuffer::getFile(getCachePath(".o"),
+                                            /*IsText=*/false);
+  if (!object)
+    return failure();
+  if (!stateFile.empty() &&
+      llvm::sys::fs::copy_file(getCachePath(".json"), stateFile))
+    return failure();
+  os << (*object)->getBuffer();
+  return success();
+}
+
+#ifdef ARCILATOR_ENABLE_JIT
+/// Store an object file and the state file written alongside it in the cache.
+/// Failures only produce a warning, since the output itself is still valid.
+static void storeInCache(StringRef object) {
+  auto warn = [](const Twine &message) {
+    llvm::errs() << "warning: unable to cache object file: " << message
+                 << "\n";
+  };
+  if (auto ec = llvm::sys::fs::create_directories(cacheDir))
+    return warn(ec.message());
+  if (!stateFile.empty())
+    if (auto ec = llvm::sys::fs::copy_file(stateFile, getCachePath(".json")))
+      return warn(ec.message());
+  if (auto err = llvm::writeToOutput(getCachePath(".o"), [&](raw_ostream &os) {
+        os << object;
+        return llvm::Error::success();
+      }))
+    return warn(llvm::toString(std::move(err)));
+}
+#endif // ARCILATOR_ENABLE_JIT
+
 //===----------------------------------------------------------------------===//
 // Main Tool Logic
 //===----------------------------------------------------------------------===//
@@ -319,6 +507,11 @@ static void populateHwModuleToArcPipeline(PassManager &pm) {
   }
 
   pm.addPass(arc::createGroupResetsAndEnablesPass());
+  if (skipInactive) {
+    arc::SkipInactiveGroupsOptions opts;
+    opts.skipCounters = skipCounters;
+    pm.addPass(arc::createSkipInactiveGroups(opts));
+  }
   pm.addPass(arc::createLegalizeStateUpdatePass());
   pm.addPass(createCSEPass());
   pm.addPass(arc::createArcCanonicalizerPass());
@@ -327,9 +520,17 @@ static void populateHwModuleToArcPipeline(PassManager &pm) {
   if (untilReached(UntilStateAlloc))
     return;
   pm.addPass(arc::createLowerArcsToFuncsPass());
-  pm.nest<arc::ModelOp>().addPass(arc::createAllocateStatePass());
+  {
+    arc::AllocateStateOptions opts;
+    opts.dirtyTracking = dirtyTracking;
+    pm.nest<arc::ModelOp>().addPass(arc::createAllocateStatePass(opts));
+  }
   pm.addPass(arc::createLowerClocksToFuncsPass()); // no CSE between state alloc
                                                    // and clock func lowering
+  if (parallelClocks)
+    pm.addPass(arc::createParallelizeClocks());
+  if (numLanes > 1)
+    pm.addPass(arc::createBatchInstances({numLanes}));
   if (splitFuncsThreshold.getNumOccurrences()) {
     pm.addPass(arc::createSplitFuncs({splitFuncsThreshold}));
   }
@@ -447,6 +648,15 @@ static LogicalResult processBuffer(
       return failure();
     }
 
+    (*executionEngine)->registerSymbols(
+        [](llvm::orc::MangleAndInterner interner) {
+          llvm::orc::SymbolMap symbolMap;
+          symbolMap[interner("arcRuntimeParallelFor")] = {
+              llvm::orc::ExecutorAddr::fromPtr(&arcRuntimeParallelFor),
+              llvm::JITSymbolFlags::Exported};
+          return symbolMap;
+        });
+
     auto expectedFunc = (*executionEngine)->lookupPacked(jitEntryPoint);
     if (!expectedFunc) {
       llvm::handleAllErrors(
@@ -462,6 +672,24 @@ static LogicalResult processBuffer(
 
     return success();
   }
+
+  // Handle object file output.
+  if (outputFormat == OutputObject && runUntilBefore == UntilEnd &&
+      runUntilAfter == UntilEnd) {
+    auto outputTimer = ts.nest("Emit object file");
+    llvm::LLVMContext llvmContext;
+    auto llvmModule = mlir::translateModuleToLLVMIR(module.get(), llvmContext);
+    if (!llvmModule)
+      return failure();
+    SmallVector<char, 0> object;
+    if (failed(emitObjectFile(*llvmModule, object)))
+      return failure();
+    StringRef objectRef(object.data(), object.size());
+    if (!cacheKey.empty())
+      storeInCache(objectRef);
+    outputFile.value()->os() << objectRef;
+    return success();
+  }
 #endif // ARCILATOR_ENABLE_JIT
 
   // Handle MLIR output.
@@ -534,6 +762,13 @@ static LogicalResult executeArcilator(MLIRContext &context) {
   applyDefaultTimingManagerCLOptions(tm);
   auto ts = tm.getRootScope();
 
+  // The dirty flags, and the tracing built on them, only describe the first
+  // lane of a batched model.
+  if (numLanes > 1 && dirtyTracking) {
+    llvm::errs() << "--dirty-tracking is not supported with --lanes > 1\n";
+    return failure();
+  }
+
   // Set up the input file.
   std::string errorMessage;
   auto input = openInputFile(inputFilename, &errorMessage);
@@ -551,6 +786,18 @@ static LogicalResult executeArcilator(MLIRContext &context) {
     return failure();
   }
 
+  // Reuse a previously compiled object file if neither the input nor any
+  // relevant option changed since. Runs which stop early do not produce an
+  // object file and bypass the cache.
+  if (outputFormat == OutputObject && !cacheDir.empty() && !splitInputFile &&
+      runUntilBefore == UntilEnd && runUntilAfter == UntilEnd) {
+    cacheKey = computeCacheKey(input->getBuffer());
+    if (succeeded(loadFromCache(outputFile.value()->os()))) {
+      outputFile.value()->keep();
+      return success();
+    }
+  }
+
   // Register our dialects.
   DialectRegistry registry;
   // clang-format off
@@ -626,12 +873,13 @@ int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv,
                                     "MLIR-based circuit simulator\n");
 
-  if (outputFormat == OutputRunJIT) {
+  if (outputFormat == OutputRunJIT || outputFormat == OutputObject) {
 #ifdef ARCILATOR_ENABLE_JIT
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
 #else
-    llvm::errs() << "This arcilator binary was not built with JIT support.\n";
+    llvm::errs() << "This arcilator binary was not built with JIT support, "
+                    "which is required to run models and emit object files.\n";
     llvm::errs() << "To enable JIT features, build arcilator with MLIR's "
                     "execution engine.\n";
     llvm::errs() << "This can be achieved by building arcilator with the "
@@ -0,0 +1,417 @@
+//===- ArcSimulation.cpp - Cycle-accurate handshake simulation ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Lowers a handshake function through the same pipeline as hlstool's dynamic
+// flow and adds a testbench driving the resulting module with valid/ready
+// handshakes. The testbench is a `func.func` built from `arc.sim.*` operations,
+// which arcilator compiles together with the design and executes in its JIT.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ArcSimulation.h"
+
+#include "circt/Conversion/HandshakeToHW.h"
+#include "circt/Dialect/Arc/ArcDialect.h"
+#include "circt/Dialect/Arc/ArcOps.h"
+#include "circt/Dialect/Arc/ArcTypes.h"
+#include "circt/Dialect/Comb/CombDialect.h"
+#include "circt/Dialect/ESI/ESIDialect.h"
+#include "circt/Dialect/ESI/ESIPasses.h"
+#include "circt/Dialect/ESI/ESITypes.h"
+#include "circt/Dialect/HW/HWDialect.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/HW/HWTypes.h"
+#include "circt/Dialect/Handshake/HandshakeOps.h"
+#include "circt/Dialect/Handshake/HandshakePasses.h"
+#include "circt/Dialect/Seq/SeqDialect.h"
+#include "circt/Dialect/Seq/SeqOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/ImplicitLocOpBuilder.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "mlir/Transforms/Passes.h"
+
+using namespace mlir;
+using namespace circt;
+using namespace circt::handshake;
+
+namespace {
+/// A channel port of the lowered top-level module. After ESI lowering, the
+/// channel `name` turns into a `name` data port plus `name_valid` and
+/// `name_ready` handshake ports.
+struct ChannelPort {
+  std::string name;
+  IntegerType dataType;
+
+  bool hasData() const { return dataType.getWidth() != 0; }
+  std::string validName() const { return name + "_valid"; }
+  std::string readyName() const { return name + "_ready"; }
+};
+
+/// Builds a testbench function for a lowered handshake function. The state
+/// carried from cycle to cycle is laid out as the cycle count, followed by the
+/// number of tokens accepted on each input, the number of tokens produced on
+/// each output, and the last value of each output which carries data.
+class TestbenchBuilder {
+public:
+  TestbenchBuilder(hw::HWModuleOp top, ArrayRef<ChannelPort> inputs,
+                   ArrayRef<ChannelPort> outputs, ArrayRef<APInt> inputValues,
+                   const ArcSimulationOptions &options)
+      : top(top), inputs(inputs), outputs(outputs), inputValues(inputValues),
+        options(options) {}
+
+  void build(StringRef name);
+
+  /// The name of the C library's `exit` function, which the testbench calls
+  /// when it gives up waiting for results.
+  static constexpr StringLiteral exitName = "exit";
+
+private:
+  void buildCondition(ImplicitLocOpBuilder &b, ValueRange state);
+  void buildCycle(ImplicitLocOpBuilder &b, ValueRange state);
+  void buildReport(ImplicitLocOpBuilder &b, ValueRange state);
+  Value buildPending(ImplicitLocOpBuilder &b, ValueRange state);
+
+  Value getConstant(ImplicitLocOpBuilder &b, Type type, uint64_t value) {
+    return b.create<arith::ConstantOp>(b.getIntegerAttr(type, value));
+  }
+  void setInput(ImplicitLocOpBuilder &b, StringRef port, Value value) {
+    b.create<arc::SimSetInputOp>(model, b.getStringAttr(port), value);
+  }
+  Value getPort(ImplicitLocOpBuilder &b, StringRef port, Type type) {
+    return b.create<arc::SimGetPortOp>(type, model, b.getStringAttr(port));
+  }
+  /// Drive the clock to `high` and evaluate the model.
+  void setClock(ImplicitLocOpBuilder &b, bool high) {
+    Value level = getConstant(b, b.getI1Type(), high);
+    setInput(b, "clock",
+             b.create<seq::ToClockOp>(seq::ClockType::get(b.getContext()),
+                                      level));
+    b.create<arc::SimStepOp>(model);
+  }
+
+  unsigned getNumDataOutputs() const {
+    return llvm::count_if(outputs, [](auto &port) { return port.hasData(); });
+  }
+
+  hw::HWModuleOp top;
+  ArrayRef<ChannelPort> inputs;
+  ArrayRef<ChannelPort> outputs;
+  ArrayRef<APInt> inputValues;
+  const ArcSimulationOptions &options;
+  Value model;
+};
+} // namespace
+
+void TestbenchBuilder::build(StringRef name) {
+  auto *ctx = top.getContext();
+  auto b = ImplicitLocOpBuilder::atBlockEnd(
+      top.getLoc(), top->getParentOfType<ModuleOp>().getBody());
+
+  b.create<func::FuncOp>(exitName, b.getFunctionType({b.getI32Type()}, {}))
+      .setPrivate();
+
+  auto func = b.create<func::FuncOp>(name, b.getFunctionType({}, {}));
+  b.setInsertionPointToStart(func.addEntryBlock());
+  auto instantiate = b.create<arc::SimInstantiateOp>();
+  b.create<func::ReturnOp>();
+
+  auto modelType = arc::SimModelInstanceType::get(
+      ctx, FlatSymbolRefAttr::get(top.getSymNameAttr()));
+  Region &body = instantiate.getBody();
+  b.createBlock(&body, body.end(), {modelType}, {top.getLoc()});
+  model = body.getArgument(0);
+
+  // Present the arguments, which never change, and hold the circuit in reset
+  // for two cycles without offering or accepting any tokens.
+  Value zero = getConstant(b, b.getI1Type(), 0);
+  Value one = getConstant(b, b.getI1Type(), 1);
+  for (auto [port, value] : llvm::zip(inputs, inputValues)) {
+    if (port.hasData())
+      setInput(b, port.name, b.create<arith::ConstantOp>(
+                                 b.getIntegerAttr(port.dataType, value)));
+    setInput(b, port.validName(), zero);
+  }
+  for (auto &port : outputs)
+    setInput(b, port.readyName(), one);
+  setInput(b, "reset", one);
+  for (unsigned i = 0; i < 2; ++i) {
+    setClock(b, false);
+    setClock(b, true);
+  }
+  setInput(b, "reset", zero);
+
+  // Run cycles until every output has produced a token per iteration.
+  Type i64 = b.getI64Type();
+  SmallVector<Value> initState(1 + inputs.size() + outputs.size(),
+                               getConstant(b, i64, 0));
+  for (auto &port : outputs)
+    if (port.hasData())
+      initState.push_back(getConstant(b, port.dataType, 0));
+
+  auto loop = b.create<scf::WhileOp>(
+      ValueRange(initState).getTypes(), initState,
+      [&](OpBuilder &builder, Location loc, ValueRange state) {
+        ImplicitLocOpBuilder nested(loc, builder);
+        buildCondition(nested, state);
+      },
+      [&](OpBuilder &builder, Location loc, ValueRange state) {
+        ImplicitLocOpBuilder nested(loc, builder);
+        buildCycle(nested, state);
+      });
+  buildReport(b, loop.getResults());
+}
+
+/// Return whether some output has not yet produced a token per iteration.
+Value TestbenchBuilder::buildPending(ImplicitLocOpBuilder &b,
+                                     ValueRange state) {
+  Value iterations = getConstant(b, b.getI64Type(), options.iterations);
+  Value pending = getConstant(b, b.getI1Type(), 0);
+  for (Value produced : state.slice(1 + inputs.size(), outputs.size()))
+    pending = b.create<arith::OrIOp>(
+        pending, b.create<arith::CmpIOp>(arith::CmpIPredicate::ult, produced,
+                                         iterations));
+  return pending;
+}
+
+void TestbenchBuilder::buildCondition(ImplicitLocOpBuilder &b,
+                                      ValueRange state) {
+  Value maxCycles = getConstant(b, b.getI64Type(), options.maxCycles);
+  Value inTime =
+      b.create<arith::CmpIOp>(arith::CmpIPredicate::ult, state[0], maxCycles);
+  b.create<scf::ConditionOp>(
+      b.create<arith::AndIOp>(buildPending(b, state), inTime), state);
+}
+
+void TestbenchBuilder::buildCycle(ImplicitLocOpBuilder &b, ValueRange state) {
+  Type i1 = b.getI1Type();
+  Type i64 = b.getI64Type();
+  Value iterations = getConstant(b, i64, options.iterations);
+  auto accepted = state.slice(1, inputs.size());
+  auto produced = state.slice(1 + inputs.size(), outputs.size());
+  auto lastValues = state.drop_front(1 + inputs.size() + outputs.size());
+
+  // Offer a token on every input which has not yet been accepted for all
+  // iterations, and let the combinational logic settle with the clock low.
+  SmallVector<Value> valids;
+  for (auto [port, count] : llvm::zip(inputs, accepted)) {
+    Value valid =
+        b.create<arith::CmpIOp>(arith::CmpIPredicate::ult, count, iterations);
+    setInput(b, port.validName(), valid);
+    valids.push_back(valid);
+  }
+  setClock(b, false);
+
+  // Sample the handshakes which complete on the upcoming rising edge. Outputs
+  // are always ready, so every valid output transfers a token.
+  SmallVector<Value> nextState;
+  nextState.push_back(
+      b.create<arith::AddIOp>(state[0], getConstant(b, i64, 1)));
+  for (auto [port, count, valid] : llvm::zip(inputs, accepted, valids)) {
+    Value transfer =
+        b.create<arith::AndIOp>(valid, getPort(b, port.readyName(), i1));
+    nextState.push_back(b.create<arith::AddIOp>(
+        count, b.create<arith::ExtUIOp>(i64, transfer)));
+  }
+  SmallVector<Value> nextValues;
+  for (auto [port, count] : llvm::zip(outputs, produced)) {
+    Value transfer = getPort(b, port.validName(), i1);
+    nextState.push_back(b.create<arith::AddIOp>(
+        count, b.create<arith::ExtUIOp>(i64, transfer)));
+    if (!port.hasData())
+      continue;
+    Value data = getPort(b, port.name, port.dataType);
+    Value last = lastValues[nextValues.size()];
+    nextValues.push_back(b.create<arith::SelectOp>(transfer, data, last));
+  }
+  nextState.append(nextValues);
+
+  setClock(b, true);
+  b.create<scf::YieldOp>(nextState);
+}
+
+void TestbenchBuilder::buildReport(ImplicitLocOpBuilder &b, ValueRange state) {
+  // If the cycle limit was reached before all results were produced, the
+  // output values are incomplete. Report the limit instead and exit with a
+  // failure code.
+  auto ifOp = b.create<scf::IfOp>(buildPending(b, state),
+                                  /*withElseRegion=*/true);
+  OpBuilder::InsertionGuard guard(b);
+  b.setInsertionPoint(ifOp.thenBlock()->getTerminator());
+  b.create<arc::SimEmitValueOp>(b.getStringAttr("cycle_limit_reached"),
+                                state[0]);
+  b.create<func::CallOp>(exitName, TypeRange{},
+                         ValueRange{getConstant(b, b.getI32Type(), 1)});
+  b.setInsertionPoint(ifOp.elseBlock()->getTerminator());
+
+  Type i64 = b.getI64Type();
+  auto produced = state.slice(1 + inputs.size(), outputs.size());
+  auto lastValues = state.drop_front(1 + inputs.size() + outputs.size());
+  assert(lastValues.size() == getNumDataOutputs());
+
+  unsigned dataIdx = 0;
+  for (auto &port : outputs)
+    if (port.hasData())
+      b.create<arc::SimEmitValueOp>(b.getStringAttr(port.name),
+                                    lastValues[dataIdx++]);
+
+  // A set of results is complete once every output has produced its token.
+  Value results = produced.front();
+  for (Value count : produced.drop_front())
+    results = b.create<arith::MinUIOp>(results, count);
+  Value cycles = state[0];
+  Value divisor = b.create<arith::MaxUIOp>(results, getConstant(b, i64, 1));
+  b.create<arc::SimEmitValueOp>(b.getStringAttr("cycles"), cycles);
+  b.create<arc::SimEmitValueOp>(b.getStringAttr("results"), results);
+  b.create<arc::SimEmitValueOp>(b.getStringAttr("cycles_per_result"),
+                                b.create<arith::DivUIOp>(cycles, divisor));
+}
+
+/// Create a simple canonicalizer pass.
+static std::unique_ptr<Pass> createSimpleCanonicalizerPass() {
+  mlir::GreedyRewriteConfig config;
+  config.useTopDownTraversal = true;
+  config.enableRegionSimplification = false;
+  return mlir::createCanonicalizerPass(config);
+}
+
+/// Check that `func` only uses types which map to plain integer ports, and
+/// that no function in `module` uses memories.
+static LogicalResult checkSupported(handshake::FuncOp func, ModuleOp module) {
+  if (func.isExternal())
+    return func.emitError("cannot simulate an external function");
+  auto isSupported = [](Type type) {
+    return isa<IntegerType, IndexType, NoneType>(type);
+  };
+  for (Type type : func.getArgumentTypes())
+    if (!isSupported(type))
+      return func.emitError("cycle-accurate simulation does not support "
+                            "arguments of type ")
+             << type;
+  for (Type type : func.getResultTypes())
+    if (!isSupported(type))
+      return func.emitError("cycle-accurate simulation does not support "
+                            "results of type ")
+             << type;
+
+  auto result = module.walk([](Operation *op) {
+    if (!isa<handshake::MemoryOp, handshake::ExternalMemoryOp>(op))
+      return WalkResult::advance();
+    op->emitError("cycle-accurate simulation does not support memories");
+    return WalkResult::interrupt();
+  });
+  return failure(result.wasInterrupted());
+}
+
+/// Parse a decimal, possibly negative, integer argument of the given width.
+static FailureOr<APInt> parseArgument(Location loc, StringRef arg,
+                                      unsigned width) {
+  StringRef digits = arg.trim();
+  bool negative = digits.consume_front("-");
+  APInt value;
+  if (digits.getAsInteger(10, value))
+    return emitError(loc) << "invalid integer argument '" << arg << "'";
+  value = value.zextOrTrunc(width);
+  if (negative)
+    value.negate();
+  return value;
+}
+
+LogicalResult
+circt::handshake::buildArcSimulation(StringRef toplevelFunction,
+                                     ArrayRef<std::string> inputArgs,
+                                     ModuleOp module,
+                                     const ArcSimulationOptions &options) {
+  auto *ctx = module.getContext();
+  ctx->loadDialect<arc::ArcDialect, arith::ArithDialect, comb::CombDialect,
+                   esi::ESIDialect, func::FuncDialect, hw::HWDialect,
+                   scf::SCFDialect, seq::SeqDialect>();
+
+  auto func = module.lookupSymbol<handshake::FuncOp>(toplevelFunction);
+  if (!func)
+    return module.emitError("cycle-accurate simulation requires a handshake "
+                            "function '")
+           << toplevelFunction << "'";
+  if (failed(checkSupported(func, module)))
+    return failure();
+
+  // The last argument is the control input, which carries no value.
+  unsigned realInputs = func.getNumArguments() - 1;
+  if (inputArgs.size() != realInputs)
+    return func.emitError("expected ")
+           << realInputs << " arguments, but " << inputArgs.size()
+           << " were provided on the command line";
+  SmallVector<APInt> inputValues;
+  for (auto [type, arg] : llvm::zip(func.getArgumentTypes(), inputArgs)) {
+    unsigned width = 0;
+    if (type.isIndex())
+      width = 64;
+    else if (auto intType = dyn_cast<IntegerType>(type))
+      width = intType.getWidth();
+    auto value = parseArgument(func.getLoc(), arg, width);
+    if (failed(value))
+      return failure();
+    inputValues.push_back(*value);
+  }
+  inputValues.resize(func.getNumArguments(), APInt());
+
+  std::string testbenchName = (toplevelFunction + "_tb").str();
+  for (StringRef reserved :
+       {StringRef(testbenchName), StringRef(TestbenchBuilder::exitName)})
+    if (module.lookupSymbol(reserved))
+      return module.emitError("symbol '")
+             << reserved << "' is reserved for the testbench";
+
+  // Buffer every channel and lower to hardware, as hlstool does.
+  PassManager pm(ctx);
+  pm.nest<handshake::FuncOp>().addPass(createSimpleCanonicalizerPass());
+  pm.nest<handshake::FuncOp>().addPass(
+      handshake::createHandshakeMaterializeForksSinksPass());
+  pm.nest<handshake::FuncOp>().addPass(createSimpleCanonicalizerPass());
+  pm.nest<handshake::FuncOp>().addPass(
+      handshake::createHandshakeInsertBuffersPass());
+  pm.nest<handshake::FuncOp>().addPass(createSimpleCanonicalizerPass());
+  pm.addPass(createHandshakeToHWPass());
+  pm.addPass(createSimpleCanonicalizerPass());
+  if (failed(pm.run(module)))
+    return failure();
+
+  // Record the channels of the top-level module before ESI lowering splits
+  // them into data and handshake ports.
+  auto top = module.lookupSymbol<hw::HWModuleOp>(toplevelFunction);
+  if (!top)
+    return module.emitError("lowering did not produce a module '")
+           << toplevelFunction << "'";
+  SmallVector<ChannelPort> inputs, outputs;
+  for (hw::PortInfo &port : top.getPortList()) {
+    auto channel = dyn_cast<esi::ChannelType>(port.type);
+    if (!channel)
+      continue;
+    auto dataType = dyn_cast<IntegerType>(channel.getInner());
+    if (!dataType)
+      return top.emitError("unexpected channel type ") << channel;
+    (port.isOutput() ? outputs : inputs)
+        .push_back({port.getName().str(), dataType});
+  }
+  assert(inputs.size() == inputValues.size());
+
+  PassManager esiPM(ctx);
+  esiPM.addPass(esi::createESIPortLoweringPass());
+  esiPM.addPass(esi::createESIPhysicalLoweringPass());
+  esiPM.addPass(esi::createESItoHWPass());
+  esiPM.addPass(createSimpleCanonicalizerPass());
+  if (failed(esiPM.run(module)))
+    return failure();
+  top = module.lookupSymbol<hw::HWModuleOp>(toplevelFunction);
+
+  TestbenchBuilder(top, inputs, outputs, inputValues, options)
+      .build(testbenchName);
+  return success();
+}
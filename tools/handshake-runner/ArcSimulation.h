@@ -0,0 +1,54 @@
+//===- ArcSimulation.h - Cycle-accurate handshake simulation ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the lowering of a handshake function to hardware together
+// with a testbench which drives it cycle by cycle, such that the result can be
+// compiled and executed with `arcilator --run`.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HANDSHAKE_RUNNER_ARCSIMULATION_H
+#define HANDSHAKE_RUNNER_ARCSIMULATION_H
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+
+namespace circt {
+namespace handshake {
+
+struct ArcSimulationOptions {
+  /// The number of times the arguments are fed into the circuit. Each input
+  /// channel offers a new token as soon as the previous one was accepted.
+  unsigned iterations = 1;
+  /// The number of cycles after which the testbench gives up waiting for
+  /// results. It then emits `cycle_limit_reached` and exits with a failure
+  /// code.
+  uint64_t maxCycles = 100000;
+};
+
+/// Lower the handshake function `toplevelFunction` in `module` to hardware and
+/// add a `<toplevelFunction>_tb` function which instantiates it as an arcilator
+/// model, resets it, and drives `inputArgs` into its argument channels while
+/// accepting every result. Once all results have been produced, the testbench
+/// emits the last value of each result port, the number of `cycles` this took,
+/// the number of complete sets of `results` and the `cycles_per_result`. The
+/// symbol `exit` is reserved for the C library function the testbench calls
+/// on failure.
+mlir::LogicalResult
+buildArcSimulation(llvm::StringRef toplevelFunction,
+                   llvm::ArrayRef<std::string> inputArgs, mlir::ModuleOp module,
+                   const ArcSimulationOptions &options);
+
+} // namespace handshake
+} // namespace circt
+
+#endif // HANDSHAKE_RUNNER_ARCSIMULATION_H
@@ -0,0 +1,1234 @@
+//===- CompiledSimulation.cpp - Compiled handshake execution --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains an execution engine for handshake functions which
+// resolves all SSA values to indices into a dense value table ahead of time.
+// Values of up to 64 bits are stored as raw bits, wider integers fall back to
+// APInt. Each op is lowered to a function pointer and its operand and result
+// slots, and ops are only re-run when one of their inputs is produced or one
+// of their outputs is consumed.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CompiledSimulation.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "llvm/ADT/bit.h"
+#include "llvm/Support/MathExtras.h"
+
+#define DEBUG_TYPE "runner"
+
+STATISTIC(compiledOpsExecuted, "Operations executed by the compiled engine");
+
+using namespace llvm;
+using namespace mlir;
+using namespace circt;
+using namespace circt::handshake;
+
+//===----------------------------------------------------------------------===//
+// Value representation
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// How the value of a slot is stored.
+enum class SlotKind : uint8_t {
+  /// An integer or index of at most 64 bits, zero-extended.
+  Int,
+  /// An integer of more than 64 bits, stored as an APInt.
+  WideInt,
+  /// A float, stored as its IEEE bits.
+  F32,
+  /// A double, stored as its IEEE bits.
+  F64,
+  /// A control-only token.
+  None,
+  /// A memref function argument, stored as its index in the store.
+  MemRef,
+};
+
+/// A memory. Integers are stored zero-extended, floats as double bits since
+/// the interpreter allocates memories with double elements regardless of type.
+struct Buffer {
+  std::vector<uint64_t> data;
+  unsigned width = 0;
+  bool isFloat = false;
+  bool isF32 = false;
+};
+} // namespace
+
+static uint64_t truncBits(uint64_t value, unsigned width) {
+  return width >= 64 ? value : value & maskTrailingOnes<uint64_t>(width);
+}
+
+static int64_t sextBits(uint64_t value, unsigned width) {
+  return width == 0 ? 0 : SignExtend64(value, width);
+}
+
+static float toFloat(uint64_t bits) { return bit_cast<float>(uint32_t(bits)); }
+static double toDouble(uint64_t bits) { return bit_cast<double>(bits); }
+static uint64_t fromFloat(float value) { return bit_cast<uint32_t>(value); }
+static uint64_t fromDouble(double value) { return bit_cast<uint64_t>(value); }
+
+/// Determine how values of `type` are stored, or return `std::nullopt` if the
+/// engine does not support the type. Index values use the full internal
+/// storage width.
+static std::optional<std::pair<SlotKind, unsigned>> getSlotKind(Type type) {
+  if (isa<IndexType>(type))
+    return {{SlotKind::Int, IndexType::kInternalStorageBitWidth}};
+  if (auto intType = dyn_cast<IntegerType>(type)) {
+    unsigned width = intType.getWidth();
+    return {{width > 64 ? SlotKind::WideInt : SlotKind::Int, width}};
+  }
+  if (type.isF32())
+    return {{SlotKind::F32, 32}};
+  if (type.isF64())
+    return {{SlotKind::F64, 64}};
+  if (isa<NoneType>(type))
+    return {{SlotKind::None, 0}};
+  return std::nullopt;
+}
+
+/// Memories are supported if their elements fit the fast path.
+static bool isSupportedMemRef(Type type) {
+  auto memrefType = dyn_cast<MemRefType>(type);
+  if (!memrefType)
+    return false;
+  auto kind = getSlotKind(memrefType.getElementType());
+  return kind && (kind->first == SlotKind::Int || kind->first == SlotKind::F32 ||
+                  kind->first == SlotKind::F64);
+}
+
+//===----------------------------------------------------------------------===//
+// Compiled executer
+//===----------------------------------------------------------------------===//
+
+namespace {
+class CompiledExecuter;
+struct CompiledOp;
+
+using ExecuteFn = void (*)(CompiledExecuter &, const CompiledOp &);
+
+/// An operation lowered to its handler and the slots it reads and writes.
+struct CompiledOp {
+  ExecuteFn execute;
+  Operation *op;
+  /// The operand and result slots, as ranges in `CompiledExecuter::slotLists`.
+  unsigned operandBegin;
+  unsigned numOperands;
+  unsigned resultBegin;
+  unsigned numResults;
+  /// An op-specific immediate, e.g. the value of a constant, the predicate of
+  /// a comparison or the buffer of a memory.
+  uint64_t imm = 0;
+  /// The latency added to the time of the inputs.
+  double latency = 0;
+  /// The number of store and load ports of a memory.
+  unsigned numStores = 0;
+  unsigned numLoads = 0;
+};
+
+class CompiledExecuter {
+public:
+  /// Lower `func` into the op and slot tables. Fails if the function contains
+  /// ops or types which are not supported.
+  LogicalResult compile(handshake::FuncOp func);
+
+  /// Load the arguments and memories, run until the function returns, and
+  /// write back the results and memories.
+  bool run(handshake::FuncOp func, DenseMap<Value, Any> &valueMap,
+           DenseMap<Value, double> &timeMap, std::vector<Any> &results,
+           std::vector<double> &resultTimes,
+           std::vector<std::vector<Any>> &store,
+           std::vector<double> &storeTimes);
+
+private:
+  unsigned addSlot(Value value);
+  LogicalResult compileOp(Operation *op);
+  void addOp(ExecuteFn fn, Operation *op, uint64_t imm = 0,
+             double latency = 0);
+
+  void loadStore(std::vector<std::vector<Any>> &store);
+  void saveStore(std::vector<std::vector<Any>> &store);
+  void loadValue(unsigned slot, const Any &value);
+  Any saveValue(unsigned slot);
+
+  //===--------------------------------------------------------------------===//
+  // Helpers used by the op handlers
+  //===--------------------------------------------------------------------===//
+
+  unsigned operand(const CompiledOp &op, unsigned i) const {
+    return slotLists[op.operandBegin + i];
+  }
+  unsigned result(const CompiledOp &op, unsigned i) const {
+    return slotLists[op.resultBegin + i];
+  }
+
+  void schedule(unsigned opIndex) {
+    if (scheduled[opIndex])
+      return;
+    scheduled[opIndex] = true;
+    readyQueue[(readyHead + readySize++) & readyMask] = opIndex;
+  }
+
+  /// Mark a slot as full and wake up its users.
+  void produce(unsigned slot, double time) {
+    valid[slot] = true;
+    times[slot] = time;
+    for (unsigned i = userBegin[slot], e = userBegin[slot + 1]; i != e; ++i)
+      schedule(users[i]);
+  }
+  void produce(unsigned slot, uint64_t value, double time) {
+    bits[slot] = value;
+    produce(slot, time);
+  }
+  /// Copy the value of `src` into `dst`, which must be of the same type.
+  void produceCopy(unsigned dst, unsigned src, double time) {
+    bits[dst] = bits[src];
+    if (kinds[dst] == SlotKind::WideInt)
+      wide[dst] = wide[src];
+    produce(dst, time);
+  }
+  void produceAPInt(unsigned slot, const APInt &value, double time) {
+    if (kinds[slot] == SlotKind::WideInt)
+      wide[slot] = value;
+    else
+      bits[slot] = value.getZExtValue();
+    produce(slot, time);
+  }
+
+  /// Mark a slot as empty and wake up its producer, which may be waiting for
+  /// the slot to be consumed.
+  void consume(unsigned slot) {
+    valid[slot] = false;
+    if (producers[slot] != noProducer)
+      schedule(producers[slot]);
+  }
+
+  APInt getAPInt(unsigned slot) const {
+    if (kinds[slot] == SlotKind::WideInt)
+      return wide[slot];
+    return APInt(widths[slot], bits[slot]);
+  }
+
+  /// Whether all operands are full and all results are empty.
+  bool canFire(const CompiledOp &op) const {
+    for (unsigned i = 0; i < op.numOperands; ++i)
+      if (!valid[operand(op, i)])
+        return false;
+    for (unsigned i = 0; i < op.numResults; ++i)
+      if (valid[result(op, i)])
+        return false;
+    return true;
+  }
+
+  /// Consume all operands and return the time at which the results are
+  /// available.
+  double consumeOperands(const CompiledOp &op) {
+    double time = 0;
+    for (unsigned i = 0; i < op.numOperands; ++i) {
+      unsigned slot = operand(op, i);
+      time = std::max(time, times[slot]);
+      consume(slot);
+    }
+    return time + op.latency;
+  }
+
+  /// Report an error and stop execution.
+  void fail(const CompiledOp &op, const Twine &message) {
+    op.op->emitOpError() << message;
+    hasFailed = true;
+    done = true;
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Op handlers
+  //===--------------------------------------------------------------------===//
+
+  static void executeFork(CompiledExecuter &e, const CompiledOp &op);
+  static void executeForward(CompiledExecuter &e, const CompiledOp &op);
+  static void executeJoin(CompiledExecuter &e, const CompiledOp &op);
+  static void executeStore(CompiledExecuter &e, const CompiledOp &op);
+  static void executeConstant(CompiledExecuter &e, const CompiledOp &op);
+  static void executeSink(CompiledExecuter &e, const CompiledOp &op);
+  static void executeMerge(CompiledExecuter &e, const CompiledOp &op);
+  static void executeMux(CompiledExecuter &e, const CompiledOp &op);
+  static void executeControlMerge(CompiledExecuter &e, const CompiledOp &op);
+  static void executeCondBranch(CompiledExecuter &e, const CompiledOp &op);
+  static void executeLoad(CompiledExecuter &e, const CompiledOp &op);
+  template <bool IsExternal>
+  static void executeMemory(CompiledExecuter &e, const CompiledOp &op);
+  static void executeReturn(CompiledExecuter &e, const CompiledOp &op);
+
+  template <typename Fn>
+  static void executeIntBinary(CompiledExecuter &e, const CompiledOp &op);
+  template <typename Fn>
+  static void executeWideIntBinary(CompiledExecuter &e, const CompiledOp &op);
+  static void executeCmpI(CompiledExecuter &e, const CompiledOp &op);
+  static void executeWideCmpI(CompiledExecuter &e, const CompiledOp &op);
+  template <typename T, typename Fn>
+  static void executeFloatBinary(CompiledExecuter &e, const CompiledOp &op);
+  template <typename T>
+  static void executeCmpF(CompiledExecuter &e, const CompiledOp &op);
+  template <bool IsSigned>
+  static void executeIntCast(CompiledExecuter &e, const CompiledOp &op);
+  template <bool IsSigned>
+  static void executeWideIntCast(CompiledExecuter &e, const CompiledOp &op);
+
+  //===--------------------------------------------------------------------===//
+  // Tables
+  //===--------------------------------------------------------------------===//
+
+  static constexpr unsigned noProducer = ~0u;
+
+  /// The compiled ops and their operand and result slots.
+  std::vector<CompiledOp> ops;
+  std::vector<unsigned> slotLists;
+  /// The memory ops, whose buffers are only known once memories are
+  /// allocated.
+  std::vector<unsigned> memoryOps;
+
+  /// The slot of each SSA value. Only used during compilation.
+  DenseMap<Value, unsigned> slotIndex;
+  std::vector<Value> slotValues;
+
+  /// Static information about each slot.
+  std::vector<SlotKind> kinds;
+  std::vector<unsigned> widths;
+  std::vector<unsigned> producers;
+  /// The ops using each slot, indexed by `userBegin`.
+  std::vector<unsigned> userBegin;
+  std::vector<unsigned> users;
+
+  /// The state of each slot.
+  std::vector<uint64_t> bits;
+  std::vector<APInt> wide;
+  std::vector<uint8_t> valid;
+  std::vector<double> times;
+
+  /// A ring buffer of ops to run, with at most one entry per op.
+  std::vector<unsigned> readyQueue;
+  std::vector<uint8_t> scheduled;
+  unsigned readyHead = 0;
+  unsigned readySize = 0;
+  unsigned readyMask = 0;
+
+  std::vector<Buffer> buffers;
+
+  /// The index of the return op.
+  unsigned returnOp = noProducer;
+  bool done = false;
+  bool hasFailed = false;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// Compilation
+//===----------------------------------------------------------------------===//
+
+unsigned CompiledExecuter::addSlot(Value value) {
+  auto [it, inserted] = slotIndex.insert({value, slotValues.size()});
+  if (inserted)
+    slotValues.push_back(value);
+  return it->second;
+}
+
+void CompiledExecuter::addOp(ExecuteFn fn, Operation *op, uint64_t imm,
+                             double latency) {
+  CompiledOp compiled;
+  compiled.execute = fn;
+  compiled.op = op;
+  compiled.operandBegin = slotLists.size();
+  compiled.numOperands = op->getNumOperands();
+  for (Value value : op->getOperands())
+    slotLists.push_back(addSlot(value));
+  compiled.resultBegin = slotLists.size();
+  compiled.numResults = op->getNumResults();
+  for (Value value : op->getResults())
+    slotLists.push_back(addSlot(value));
+  compiled.imm = imm;
+  compiled.latency = latency;
+  ops.push_back(compiled);
+}
+
+namespace {
+struct AddIFn {
+  static constexpr bool checkZero = false;
+  static uint64_t apply(uint64_t a, uint64_t b, unsigned) { return a + b; }
+  static APInt apply(const APInt &a, const APInt &b) { return a + b; }
+};
+struct SubIFn {
+  static constexpr bool checkZero = false;
+  static uint64_t apply(uint64_t a, uint64_t b, unsigned) { return a - b; }
+  static APInt apply(const APInt &a, const APInt &b) { return a - b; }
+};
+struct MulIFn {
+  static constexpr bool checkZero = false;
+  static uint64_t apply(uint64_t a, uint64_t b, unsigned) { return a * b; }
+  static APInt apply(const APInt &a, const APInt &b) { return a * b; }
+};
+struct XOrIFn {
+  static constexpr bool checkZero = false;
+  static uint64_t apply(uint64_t a, uint64_t b, unsigned) { return a ^ b; }
+  static APInt apply(const APInt &a, const APInt &b) { return a ^ b; }
+};
+struct DivSIFn {
+  static constexpr bool checkZero = true;
+  static uint64_t apply(uint64_t a, uint64_t b, unsigned width) {
+    int64_t lhs = sextBits(a, width), rhs = sextBits(b, width);
+    // Avoid the overflow of INT64_MIN / -1, which wraps like APInt::sdiv.
+    if (rhs == -1)
+      return 0 - uint64_t(lhs);
+    return uint64_t(lhs / rhs);
+  }
+  static APInt apply(const APInt &a, const APInt &b) { return a.sdiv(b); }
+};
+struct DivUIFn {
+  static constexpr bool checkZero = true;
+  static uint64_t apply(uint64_t a, uint64_t b, unsigned) { return a / b; }
+  static APInt apply(const APInt &a, const APInt &b) { return a.udiv(b); }
+};
+struct AddFFn {
+  template <typename T>
+  static T apply(T a, T b) {
+    return a + b;
+  }
+};
+struct SubFFn {
+  template <typename T>
+  static T apply(T a, T b) {
+    return a - b;
+  }
+};
+struct MulFFn {
+  template <typename T>
+  static T apply(T a, T b) {
+    return a * b;
+  }
+};
+struct DivFFn {
+  template <typename T>
+  static T apply(T a, T b) {
+    return a / b;
+  }
+};
+
+} // namespace
+
+LogicalResult CompiledExecuter::compileOp(Operation *op) {
+  for (Value value : op->getOperands())
+    if (!getSlotKind(value.getType()) &&
+        !(isa<BlockArgument>(value) && isSupportedMemRef(value.getType())))
+      return failure();
+  for (Value value : op->getResults())
+    if (!getSlotKind(value.getType()))
+      return failure();
+
+  // Ops on integers wider than 64 bits use the APInt handlers.
+  auto isWideType = [](Type type) {
+    auto kind = getSlotKind(type);
+    return kind && kind->first == SlotKind::WideInt;
+  };
+  bool isWide = llvm::any_of(op->getOperandTypes(), isWideType) ||
+                llvm::any_of(op->getResultTypes(), isWideType);
+
+  // Pick the float handler for the type of the operands.
+  auto addFloatOp = [&](auto fn) {
+    using Fn = decltype(fn);
+    Type type = op->getOperand(0).getType();
+    addOp(type.isF32() ? executeFloatBinary<float, Fn>
+                       : executeFloatBinary<double, Fn>,
+          op, 0, 1);
+    return success();
+  };
+  auto addIntOp = [&](auto fn) {
+    using Fn = decltype(fn);
+    addOp(isWide ? executeWideIntBinary<Fn> : executeIntBinary<Fn>, op, 0, 1);
+    return success();
+  };
+
+  return TypeSwitch<Operation *, LogicalResult>(op)
+      .Case<handshake::ForkOp>([&](auto) {
+        addOp(executeFork, op, 0, 1);
+        return success();
+      })
+      .Case<handshake::BranchOp>([&](auto) {
+        addOp(executeForward, op);
+        return success();
+      })
+      .Case<handshake::BufferOp>([&](auto bufferOp) {
+        addOp(executeForward, op, 0, bufferOp.getNumSlots());
+        return success();
+      })
+      .Case<handshake::SyncOp>([&](auto) {
+        addOp(executeForward, op, 0, 1);
+        return success();
+      })
+      .Case<handshake::JoinOp>([&](auto) {
+        addOp(executeJoin, op, 0, 1);
+        return success();
+      })
+      .Case<handshake::StoreOp>([&](auto storeOp) {
+        if (storeOp.getAddresses().size() != 1)
+          return failure();
+        addOp(executeStore, op, 0, 1);
+        return success();
+      })
+      .Case<handshake::LoadOp>([&](auto loadOp) {
+        if (loadOp.getAddresses().size() != 1)
+          return failure();
+        addOp(executeLoad, op);
+        return success();
+      })
+      .Case<handshake::ConstantOp>([&](auto constantOp) {
+        auto attr = constantOp->template getAttrOfType<IntegerAttr>("value");
+        if (!attr || isWide)
+          return failure();
+        addOp(executeConstant, op,
+              truncBits(attr.getValue().getZExtValue(),
+                        getSlotKind(constantOp.getType())->second));
+        return success();
+      })
+      .Case<handshake::SinkOp>([&](auto) {
+        addOp(executeSink, op);
+        return success();
+      })
+      .Case<handshake::MergeOp>([&](auto) {
+        addOp(executeMerge, op);
+        return success();
+      })
+      .Case<handshake::MuxOp>([&](auto) {
+        addOp(executeMux, op);
+        return success();
+      })
+      .Case<handshake::ControlMergeOp>([&](auto) {
+        addOp(executeControlMerge, op);
+        return success();
+      })
+      .Case<handshake::ConditionalBranchOp>([&](auto) {
+        addOp(executeCondBranch, op);
+        return success();
+      })
+      .Case<handshake::MemoryOp>([&](auto memOp) {
+        if (!isSupportedMemRef(memOp.getMemRefType()))
+          return failure();
+        memoryOps.push_back(ops.size());
+        addOp(executeMemory<false>, op);
+        ops.back().numStores = memOp.getStCount();
+        ops.back().numLoads = memOp.getLdCount();
+        return success();
+      })
+      .Case<handshake::ExternalMemoryOp>([&](auto memOp) {
+        addOp(executeMemory<true>, op);
+        ops.back().numStores = memOp.getStCount();
+        ops.back().numLoads = memOp.getLdCount();
+        return success();
+      })
+      .Case<handshake::ReturnOp>([&](auto) {
+        returnOp = ops.size();
+        addOp(executeReturn, op);
+        return success();
+      })
+      .Case<arith::AddIOp>([&](auto) { return addIntOp(AddIFn()); })
+      .Case<arith::SubIOp>([&](auto) { return addIntOp(SubIFn()); })
+      .Case<arith::MulIOp>([&](auto) { return addIntOp(MulIFn()); })
+      .Case<arith::XOrIOp>([&](auto) { return addIntOp(XOrIFn()); })
+      .Case<arith::DivSIOp>([&](auto) { return addIntOp(DivSIFn()); })
+      .Case<arith::DivUIOp>([&](auto) { return addIntOp(DivUIFn()); })
+      .Case<arith::CmpIOp>([&](auto cmpOp) {
+        addOp(isWide ? executeWideCmpI : executeCmpI, op,
+              uint64_t(cmpOp.getPredicate()), 1);
+        return success();
+      })
+      .Case<arith::AddFOp>([&](auto) { return addFloatOp(AddFFn()); })
+      .Case<arith::SubFOp>([&](auto) { return addFloatOp(SubFFn()); })
+      .Case<arith::MulFOp>([&](auto) { return addFloatOp(MulFFn()); })
+      .Case<arith::DivFOp>([&](auto) { return addFloatOp(DivFFn()); })
+      .Case<arith::CmpFOp>([&](auto cmpOp) {
+        addOp(cmpOp.getLhs().getType().isF32() ? executeCmpF<float>
+                                               : executeCmpF<double>,
+              op, uint64_t(cmpOp.getPredicate()), 1);
+        return success();
+      })
+      .Case<arith::IndexCastOp, arith::ExtUIOp>([&](auto) {
+        addOp(isWide ? executeWideIntCast<false> : executeIntCast<false>, op, 0,
+              1);
+        return success();
+      })
+      .Case<arith::ExtSIOp>([&](auto) {
+        addOp(isWide ? executeWideIntCast<true> : executeIntCast<true>, op, 0,
+              1);
+        return success();
+      })
+      .Default([](auto) { return failure(); });
+}
+
+LogicalResult CompiledExecuter::compile(handshake::FuncOp func) {
+  Block &entryBlock = func.getBody().front();
+  for (BlockArgument arg : entryBlock.getArguments()) {
+    if (!getSlotKind(arg.getType()) && !isSupportedMemRef(arg.getType()))
+      return func.emitError("argument type ")
+             << arg.getType() << " is not supported by the compiled engine";
+    addSlot(arg);
+  }
+
+  for (Operation &op : entryBlock)
+    if (failed(compileOp(&op)))
+      return op.emitError("operation is not supported by the compiled engine");
+  if (returnOp == noProducer)
+    return func.emitError("function has no return operation");
+
+  // Compute the static information about each slot.
+  unsigned numSlots = slotValues.size();
+  kinds.resize(numSlots);
+  widths.resize(numSlots);
+  producers.assign(numSlots, noProducer);
+  for (unsigned slot = 0; slot < numSlots; ++slot) {
+    Type type = slotValues[slot].getType();
+    if (auto kind = getSlotKind(type)) {
+      kinds[slot] = kind->first;
+      widths[slot] = kind->second;
+    } else {
+      kinds[slot] = SlotKind::MemRef;
+      widths[slot] = 64;
+    }
+  }
+
+  std::vector<unsigned> numUsers(numSlots, 0);
+  for (unsigned i = 0, e = ops.size(); i < e; ++i) {
+    const CompiledOp &op = ops[i];
+    for (unsigned j = 0; j < op.numOperands; ++j)
+      ++numUsers[operand(op, j)];
+    for (unsigned j = 0; j < op.numResults; ++j)
+      producers[result(op, j)] = i;
+  }
+  userBegin.assign(numSlots + 1, 0);
+  for (unsigned slot = 0; slot < numSlots; ++slot)
+    userBegin[slot + 1] = userBegin[slot] + numUsers[slot];
+  users.resize(userBegin[numSlots]);
+  std::vector<unsigned> next(userBegin.begin(), userBegin.end() - 1);
+  for (unsigned i = 0, e = ops.size(); i < e; ++i)
+    for (unsigned j = 0; j < ops[i].numOperands; ++j)
+      users[next[operand(ops[i], j)]++] = i;
+
+  slotIndex.clear();
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Interpreter state conversion
+//===----------------------------------------------------------------------===//
+
+void CompiledExecuter::loadValue(unsigned slot, const Any &value) {
+  switch (kinds[slot]) {
+  case SlotKind::Int: {
+    const APInt &apint = *any_cast<APInt>(&value);
+    bits[slot] = truncBits(apint.sextOrTrunc(64).getZExtValue(), widths[slot]);
+    break;
+  }
+  case SlotKind::WideInt:
+    wide[slot] = any_cast<APInt>(&value)->sextOrTrunc(widths[slot]);
+    break;
+  case SlotKind::F32:
+    bits[slot] = fromFloat(any_cast<APFloat>(&value)->convertToFloat());
+    break;
+  case SlotKind::F64:
+    bits[slot] = fromDouble(any_cast<APFloat>(&value)->convertToDouble());
+    break;
+  case SlotKind::None:
+    bits[slot] = 0;
+    break;
+  case SlotKind::MemRef:
+    bits[slot] = any_cast<unsigned>(value);
+    break;
+  }
+}
+
+Any CompiledExecuter::saveValue(unsigned slot) {
+  switch (kinds[slot]) {
+  case SlotKind::Int:
+    return APInt(widths[slot], bits[slot]);
+  case SlotKind::WideInt:
+    return wide[slot];
+  case SlotKind::F32:
+    return APFloat(toFloat(bits[slot]));
+  case SlotKind::F64:
+    return APFloat(toDouble(bits[slot]));
+  case SlotKind::None:
+    return APInt(1, 0);
+  case SlotKind::MemRef:
+    return unsigned(bits[slot]);
+  }
+  llvm_unreachable("unknown slot kind");
+}
+
+void CompiledExecuter::loadStore(std::vector<std::vector<Any>> &store) {
+  buffers.resize(store.size());
+  for (auto [buffer, elements] : llvm::zip(buffers, store)) {
+    buffer.data.resize(elements.size());
+    for (auto [data, element] : llvm::zip(buffer.data, elements)) {
+      if (auto *apint = any_cast<APInt>(&element)) {
+        buffer.width = apint->getBitWidth();
+        data = apint->getZExtValue();
+      } else {
+        const APFloat &apfloat = *any_cast<APFloat>(&element);
+        buffer.isFloat = true;
+        buffer.isF32 = &apfloat.getSemantics() == &APFloat::IEEEsingle();
+        data = fromDouble(buffer.isF32 ? apfloat.convertToFloat()
+                                       : apfloat.convertToDouble());
+      }
+    }
+  }
+}
+
+void CompiledExecuter::saveStore(std::vector<std::vector<Any>> &store) {
+  for (auto [buffer, elements] : llvm::zip(buffers, store)) {
+    for (auto [data, element] : llvm::zip(buffer.data, elements)) {
+      if (!buffer.isFloat)
+        element = APInt(buffer.width, data);
+      else if (buffer.isF32)
+        element = APFloat(float(toDouble(data)));
+      else
+        element = APFloat(toDouble(data));
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Execution
+//===----------------------------------------------------------------------===//
+
+bool CompiledExecuter::run(handshake::FuncOp func,
+                           DenseMap<Value, Any> &valueMap,
+                           DenseMap<Value, double> &timeMap,
+                           std::vector<Any> &results,
+                           std::vector<double> &resultTimes,
+                           std::vector<std::vector<Any>> &store,
+                           std::vector<double> &storeTimes) {
+  // Allocate memories just like the interpreter does.
+  DenseMap<unsigned, unsigned> memoryMap;
+  func.walk([&](handshake::MemoryOpInterface memOp) {
+    if (!memOp.allocateMemory(memoryMap, store, storeTimes))
+      llvm_unreachable("Memory op does not have unique ID!\n");
+  });
+  for (unsigned i : memoryOps)
+    ops[i].imm = memoryMap[cast<handshake::MemoryOp>(ops[i].op).getId()];
+  loadStore(store);
+
+  unsigned numSlots = slotValues.size();
+  bits.assign(numSlots, 0);
+  wide.assign(numSlots, APInt());
+  valid.assign(numSlots, false);
+  times.assign(numSlots, 0.0);
+  for (unsigned slot = 0; slot < numSlots; ++slot)
+    if (kinds[slot] == SlotKind::WideInt)
+      wide[slot] = APInt(widths[slot], 0);
+
+  unsigned capacity = PowerOf2Ceil(ops.size() + 1);
+  readyQueue.assign(capacity, 0);
+  readyMask = capacity - 1;
+  scheduled.assign(ops.size(), false);
+
+  // Load the arguments and initial buffer values.
+  Block &entryBlock = func.getBody().front();
+  for (BlockArgument arg : entryBlock.getArguments()) {
+    auto it = valueMap.find(arg);
+    if (it == valueMap.end())
+      continue;
+    unsigned slot = arg.getArgNumber();
+    loadValue(slot, it->second);
+    produce(slot, timeMap.lookup(arg));
+  }
+  for (const CompiledOp &op : ops) {
+    auto bufferOp = dyn_cast<handshake::BufferOp>(op.op);
+    if (!bufferOp || !bufferOp.getInitValues().has_value())
+      continue;
+    auto initValues = bufferOp.getInitValueArray();
+    assert(initValues.size() == 1 &&
+           "Handshake-runner only supports buffer initialization with a "
+           "single buffer value.");
+    unsigned slot = result(op, 0);
+    produceAPInt(slot, APInt(widths[slot], initValues.front()), 0.0);
+  }
+
+  while (!done) {
+    if (readySize == 0) {
+      func.emitError() << "no operation can execute before the function "
+                          "returns";
+      return false;
+    }
+    unsigned opIndex = readyQueue[readyHead];
+    readyHead = (readyHead + 1) & readyMask;
+    --readySize;
+    scheduled[opIndex] = false;
+    const CompiledOp &op = ops[opIndex];
+    op.execute(*this, op);
+  }
+  if (hasFailed)
+    return false;
+
+  const CompiledOp &ret = ops[returnOp];
+  for (unsigned i = 0, e = results.size(); i < e; ++i) {
+    results[i] = saveValue(operand(ret, i));
+    resultTimes[i] = times[operand(ret, i)];
+  }
+  saveStore(store);
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Handshake op handlers
+//===----------------------------------------------------------------------===//
+
+void CompiledExecuter::executeFork(CompiledExecuter &e, const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  unsigned in = e.operand(op, 0);
+  double time = e.consumeOperands(op);
+  for (unsigned i = 0; i < op.numResults; ++i)
+    e.produceCopy(e.result(op, i), in, time);
+  ++compiledOpsExecuted;
+}
+
+/// Forward each operand to the result of the same index.
+void CompiledExecuter::executeForward(CompiledExecuter &e,
+                                      const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  double time = e.consumeOperands(op);
+  for (unsigned i = 0; i < op.numResults; ++i)
+    e.produceCopy(e.result(op, i), e.operand(op, i), time);
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeJoin(CompiledExecuter &e, const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  e.produce(e.result(op, 0), 0, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+/// Forward the data and address of a store to the memory.
+void CompiledExecuter::executeStore(CompiledExecuter &e, const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  double time = e.consumeOperands(op);
+  e.produceCopy(e.result(op, 0), e.operand(op, 1), time);
+  e.produceCopy(e.result(op, 1), e.operand(op, 0), time);
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeConstant(CompiledExecuter &e,
+                                       const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  e.produce(e.result(op, 0), op.imm, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeSink(CompiledExecuter &e, const CompiledOp &op) {
+  unsigned in = e.operand(op, 0);
+  if (!e.valid[in])
+    return;
+  e.consume(in);
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeMerge(CompiledExecuter &e, const CompiledOp &op) {
+  unsigned out = e.result(op, 0);
+  if (e.valid[out])
+    return;
+  for (unsigned i = 0; i < op.numOperands; ++i) {
+    unsigned in = e.operand(op, i);
+    if (!e.valid[in])
+      continue;
+    e.consume(in);
+    e.produceCopy(out, in, e.times[in]);
+    ++compiledOpsExecuted;
+    return;
+  }
+}
+
+void CompiledExecuter::executeMux(CompiledExecuter &e, const CompiledOp &op) {
+  unsigned select = e.operand(op, 0);
+  unsigned out = e.result(op, 0);
+  if (!e.valid[select] || e.valid[out])
+    return;
+  uint64_t index = e.bits[select];
+  if (index >= op.numOperands - 1) {
+    e.fail(op, "trying to select a non-existing mux operand");
+    return;
+  }
+  unsigned in = e.operand(op, index + 1);
+  if (!e.valid[in])
+    return;
+  e.consume(select);
+  e.consume(in);
+  e.produceCopy(out, in, std::max(e.times[select], e.times[in]));
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeControlMerge(CompiledExecuter &e,
+                                           const CompiledOp &op) {
+  unsigned out = e.result(op, 0);
+  unsigned index = e.result(op, 1);
+  if (e.valid[out] || e.valid[index])
+    return;
+  for (unsigned i = 0; i < op.numOperands; ++i) {
+    unsigned in = e.operand(op, i);
+    if (!e.valid[in])
+      continue;
+    e.consume(in);
+    e.produceCopy(out, in, e.times[in]);
+    e.produce(index, truncBits(i, e.widths[index]), e.times[in]);
+    ++compiledOpsExecuted;
+    return;
+  }
+}
+
+void CompiledExecuter::executeCondBranch(CompiledExecuter &e,
+                                         const CompiledOp &op) {
+  unsigned cond = e.operand(op, 0);
+  unsigned in = e.operand(op, 1);
+  if (!e.valid[cond] || !e.valid[in])
+    return;
+  unsigned out = e.result(op, e.bits[cond] != 0 ? 0 : 1);
+  if (e.valid[out])
+    return;
+  e.consume(cond);
+  e.consume(in);
+  e.produceCopy(out, in, std::max(e.times[cond], e.times[in]));
+  ++compiledOpsExecuted;
+}
+
+/// Forward an address to the memory once the ordering token has arrived, and
+/// the data returned by the memory to the successor.
+void CompiledExecuter::executeLoad(CompiledExecuter &e, const CompiledOp &op) {
+  unsigned address = e.operand(op, 0);
+  unsigned data = e.operand(op, 1);
+  unsigned nonce = e.operand(op, 2);
+  unsigned dataOut = e.result(op, 0);
+  unsigned addressOut = e.result(op, 1);
+  if (e.valid[address] && e.valid[nonce] && !e.valid[addressOut]) {
+    e.consume(address);
+    e.consume(nonce);
+    e.produceCopy(addressOut, address,
+                  std::max(e.times[address], e.times[nonce]));
+    ++compiledOpsExecuted;
+  }
+  if (e.valid[data] && !e.valid[dataOut]) {
+    e.consume(data);
+    e.produceCopy(dataOut, data, e.times[data]);
+    ++compiledOpsExecuted;
+  }
+}
+
+/// Serve all store and load ports of a memory whose requests have arrived.
+template <bool IsExternal>
+void CompiledExecuter::executeMemory(CompiledExecuter &e,
+                                     const CompiledOp &op) {
+  unsigned opIndex = IsExternal ? 1 : 0;
+  Buffer &buffer =
+      e.buffers[IsExternal ? e.bits[e.operand(op, 0)] : unsigned(op.imm)];
+  // Stores take data and address and produce a token, loads take an address
+  // and produce data and a token.
+  unsigned numStores = op.numStores;
+  unsigned numLoads = op.numLoads;
+
+  auto checkOffset = [&](uint64_t offset) {
+    if (offset < buffer.data.size())
+      return true;
+    e.fail(op, "out-of-bounds memory access at offset " + Twine(offset));
+    return false;
+  };
+
+  for (unsigned i = 0; i < numStores; ++i) {
+    unsigned data = e.operand(op, opIndex++);
+    unsigned address = e.operand(op, opIndex++);
+    unsigned nonceOut = e.result(op, numLoads + i);
+    if (!e.valid[data] || !e.valid[address] || e.valid[nonceOut])
+      continue;
+    uint64_t offset = e.bits[address];
+    if (!checkOffset(offset))
+      return;
+    uint64_t value = e.bits[data];
+    if (e.kinds[data] == SlotKind::F32)
+      value = fromDouble(toFloat(value));
+    else if (!buffer.isFloat)
+      value = truncBits(value, buffer.width);
+    buffer.data[offset] = value;
+    e.consume(data);
+    e.consume(address);
+    e.produce(nonceOut, 0, std::max(e.times[data], e.times[address]));
+    ++compiledOpsExecuted;
+  }
+
+  for (unsigned i = 0; i < numLoads; ++i) {
+    unsigned address = e.operand(op, opIndex++);
+    unsigned dataOut = e.result(op, i);
+    unsigned nonceOut = e.result(op, numLoads + numStores + i);
+    if (!e.valid[address] || e.valid[dataOut] || e.valid[nonceOut])
+      continue;
+    uint64_t offset = e.bits[address];
+    if (!checkOffset(offset))
+      return;
+    uint64_t value = buffer.data[offset];
+    if (e.kinds[dataOut] == SlotKind::F32)
+      value = fromFloat(float(toDouble(value)));
+    else if (!buffer.isFloat)
+      value = truncBits(sextBits(value, buffer.width), e.widths[dataOut]);
+    double time = e.times[address];
+    e.consume(address);
+    e.produce(dataOut, value, time);
+    e.produce(nonceOut, 0, time);
+    ++compiledOpsExecuted;
+  }
+}
+
+void CompiledExecuter::executeReturn(CompiledExecuter &e,
+                                     const CompiledOp &op) {
+  for (unsigned i = 0; i < op.numOperands; ++i)
+    if (!e.valid[e.operand(op, i)])
+      return;
+  e.done = true;
+  ++compiledOpsExecuted;
+}
+
+//===----------------------------------------------------------------------===//
+// Arith op handlers
+//===----------------------------------------------------------------------===//
+
+template <typename Fn>
+void CompiledExecuter::executeIntBinary(CompiledExecuter &e,
+                                        const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  uint64_t lhs = e.bits[e.operand(op, 0)];
+  uint64_t rhs = e.bits[e.operand(op, 1)];
+  unsigned out = e.result(op, 0);
+  if constexpr (Fn::checkZero) {
+    if (rhs == 0) {
+      e.fail(op, "Division By Zero!");
+      return;
+    }
+  }
+  double time = e.consumeOperands(op);
+  e.produce(out, truncBits(Fn::apply(lhs, rhs, e.widths[out]), e.widths[out]),
+            time);
+  ++compiledOpsExecuted;
+}
+
+template <typename Fn>
+void CompiledExecuter::executeWideIntBinary(CompiledExecuter &e,
+                                            const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  APInt lhs = e.getAPInt(e.operand(op, 0));
+  APInt rhs = e.getAPInt(e.operand(op, 1));
+  if constexpr (Fn::checkZero) {
+    if (rhs.isZero()) {
+      e.fail(op, "Division By Zero!");
+      return;
+    }
+  }
+  double time = e.consumeOperands(op);
+  e.produceAPInt(e.result(op, 0), Fn::apply(lhs, rhs), time);
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeCmpI(CompiledExecuter &e, const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  unsigned lhsSlot = e.operand(op, 0);
+  unsigned width = e.widths[lhsSlot];
+  uint64_t lhs = e.bits[lhsSlot];
+  uint64_t rhs = e.bits[e.operand(op, 1)];
+  int64_t slhs = sextBits(lhs, width), srhs = sextBits(rhs, width);
+  bool value = false;
+  switch (arith::CmpIPredicate(op.imm)) {
+  case arith::CmpIPredicate::eq:
+    value = lhs == rhs;
+    break;
+  case arith::CmpIPredicate::ne:
+    value = lhs != rhs;
+    break;
+  case arith::CmpIPredicate::slt:
+    value = slhs < srhs;
+    break;
+  case arith::CmpIPredicate::sle:
+    value = slhs <= srhs;
+    break;
+  case arith::CmpIPredicate::sgt:
+    value = slhs > srhs;
+    break;
+  case arith::CmpIPredicate::sge:
+    value = slhs >= srhs;
+    break;
+  case arith::CmpIPredicate::ult:
+    value = lhs < rhs;
+    break;
+  case arith::CmpIPredicate::ule:
+    value = lhs <= rhs;
+    break;
+  case arith::CmpIPredicate::ugt:
+    value = lhs > rhs;
+    break;
+  case arith::CmpIPredicate::uge:
+    value = lhs >= rhs;
+    break;
+  }
+  e.produce(e.result(op, 0), value, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+void CompiledExecuter::executeWideCmpI(CompiledExecuter &e,
+                                       const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  bool value = arith::applyCmpPredicate(arith::CmpIPredicate(op.imm),
+                                        e.getAPInt(e.operand(op, 0)),
+                                        e.getAPInt(e.operand(op, 1)));
+  e.produce(e.result(op, 0), value, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+template <typename T, typename Fn>
+void CompiledExecuter::executeFloatBinary(CompiledExecuter &e,
+                                          const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  auto get = [&](unsigned slot) -> T {
+    if constexpr (std::is_same_v<T, float>)
+      return toFloat(e.bits[slot]);
+    else
+      return toDouble(e.bits[slot]);
+  };
+  T value = Fn::apply(get(e.operand(op, 0)), get(e.operand(op, 1)));
+  uint64_t bits;
+  if constexpr (std::is_same_v<T, float>)
+    bits = fromFloat(value);
+  else
+    bits = fromDouble(value);
+  e.produce(e.result(op, 0), bits, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+template <typename T>
+void CompiledExecuter::executeCmpF(CompiledExecuter &e, const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  auto get = [&](unsigned slot) -> T {
+    if constexpr (std::is_same_v<T, float>)
+      return toFloat(e.bits[slot]);
+    else
+      return toDouble(e.bits[slot]);
+  };
+  T lhs = get(e.operand(op, 0));
+  T rhs = get(e.operand(op, 1));
+  bool unordered = std::isnan(lhs) || std::isnan(rhs);
+  bool value = false;
+  switch (arith::CmpFPredicate(op.imm)) {
+  case arith::CmpFPredicate::AlwaysFalse:
+    value = false;
+    break;
+  case arith::CmpFPredicate::OEQ:
+    value = !unordered && lhs == rhs;
+    break;
+  case arith::CmpFPredicate::OGT:
+    value = !unordered && lhs > rhs;
+    break;
+  case arith::CmpFPredicate::OGE:
+    value = !unordered && lhs >= rhs;
+    break;
+  case arith::CmpFPredicate::OLT:
+    value = !unordered && lhs < rhs;
+    break;
+  case arith::CmpFPredicate::OLE:
+    value = !unordered && lhs <= rhs;
+    break;
+  case arith::CmpFPredicate::ONE:
+    value = !unordered && lhs != rhs;
+    break;
+  case arith::CmpFPredicate::ORD:
+    value = !unordered;
+    break;
+  case arith::CmpFPredicate::UEQ:
+    value = unordered || lhs == rhs;
+    break;
+  case arith::CmpFPredicate::UGT:
+    value = unordered || lhs > rhs;
+    break;
+  case arith::CmpFPredicate::UGE:
+    value = unordered || lhs >= rhs;
+    break;
+  case arith::CmpFPredicate::ULT:
+    value = unordered || lhs < rhs;
+    break;
+  case arith::CmpFPredicate::ULE:
+    value = unordered || lhs <= rhs;
+    break;
+  case arith::CmpFPredicate::UNE:
+    value = unordered || lhs != rhs;
+    break;
+  case arith::CmpFPredicate::UNO:
+    value = unordered;
+    break;
+  case arith::CmpFPredicate::AlwaysTrue:
+    value = true;
+    break;
+  }
+  e.produce(e.result(op, 0), value, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+/// Index casts and extensions. Index casts zero-extend like the interpreter.
+template <bool IsSigned>
+void CompiledExecuter::executeIntCast(CompiledExecuter &e,
+                                      const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  unsigned in = e.operand(op, 0);
+  unsigned out = e.result(op, 0);
+  uint64_t value = e.bits[in];
+  if (IsSigned)
+    value = uint64_t(sextBits(value, e.widths[in]));
+  e.produce(out, truncBits(value, e.widths[out]), e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+template <bool IsSigned>
+void CompiledExecuter::executeWideIntCast(CompiledExecuter &e,
+                                          const CompiledOp &op) {
+  if (!e.canFire(op))
+    return;
+  APInt value = e.getAPInt(e.operand(op, 0));
+  unsigned out = e.result(op, 0);
+  value = IsSigned ? value.sextOrTrunc(e.widths[out])
+                   : value.zextOrTrunc(e.widths[out]);
+  e.produceAPInt(out, value, e.consumeOperands(op));
+  ++compiledOpsExecuted;
+}
+
+//===----------------------------------------------------------------------===//
+// Entry point
+//===----------------------------------------------------------------------===//
+
+bool circt::handshake::executeCompiled(handshake::FuncOp func,
+                                       DenseMap<Value, Any> &valueMap,
+                                       DenseMap<Value, double> &timeMap,
+                                       std::vector<Any> &results,
+                                       std::vector<double> &resultTimes,
+                                       std::vector<std::vector<Any>> &store,
+                                       std::vector<double> &storeTimes) {
+  CompiledExecuter executer;
+  if (failed(executer.compile(func)))
+    return false;
+  return executer.run(func, valueMap, timeMap, results, resultTimes, store,
+                      storeTimes);
+}
@@ -0,0 +1,43 @@
+//===- CompiledSimulation.h - Compiled handshake execution ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares an execution engine which pre-compiles a handshake
+// function into a dense, slot-indexed value table and a per-op dispatch table,
+// instead of interpreting each op on dynamically typed values.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HANDSHAKE_RUNNER_COMPILEDSIMULATION_H
+#define HANDSHAKE_RUNNER_COMPILEDSIMULATION_H
+
+#include "circt/Dialect/Handshake/HandshakeOps.h"
+#include "llvm/ADT/Any.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <vector>
+
+namespace circt {
+namespace handshake {
+
+/// Execute `func` with the compiled engine. `valueMap`, `timeMap`, `store` and
+/// `storeTimes` hold the function arguments and memories as set up for the
+/// interpreter, and `store` is updated with the final memory contents. Emits an
+/// error and returns false if `func` uses ops or types which the engine does
+/// not support. Otherwise returns whether execution succeeded.
+bool executeCompiled(handshake::FuncOp func,
+                     llvm::DenseMap<mlir::Value, llvm::Any> &valueMap,
+                     llvm::DenseMap<mlir::Value, double> &timeMap,
+                     std::vector<llvm::Any> &results,
+                     std::vector<double> &resultTimes,
+                     std::vector<std::vector<llvm::Any>> &store,
+                     std::vector<double> &storeTimes);
+
+} // namespace handshake
+} // namespace circt
+
+#endif // HANDSHAKE_RUNNER_COMPILEDSIMULATION_H
@@ -13,6 +13,7 @@
 
 #include <list>
 
+#include "CompiledSimulation.h"
 #include "circt/Dialect/Handshake/HandshakeOps.h"
 #include "circt/Dialect/Handshake/Simulation.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
@@ -373,7 +374,7 @@ LogicalResult HandshakeExecuter::execute(mlir::arith::SubIOp,
 LogicalResult HandshakeExecuter::execute(mlir::arith::SubFOp,
                                          std::vector<Any> &in,
                                          std::vector<Any> &out) {
-  out[0] = any_cast<APFloat>(in[0]) + any_cast<APFloat>(in[1]);
+  out[0] = any_cast<APFloat>(in[0]) - any_cast<APFloat>(in[1]);
   return success();
 }
 
@@ -914,7 +915,8 @@ HandshakeExecuter::HandshakeExecuter(
 //===----------------------------------------------------------------------===//
 
 bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
-              mlir::OwningOpRef<mlir::ModuleOp> &module, mlir::MLIRContext &) {
+              mlir::OwningOpRef<mlir::ModuleOp> &module, mlir::MLIRContext &,
+              SimulationEngine engine) {
   // The store associates each allocation in the program
   // (represented by a int) with a vector of values which can be
   // accessed by it.  Currently values are assumed to be an integer.
@@ -1018,14 +1020,23 @@ bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
   bool succeeded = false;
   if (mlir::func::FuncOp toplevel =
           module->lookupSymbol<mlir::func::FuncOp>(toplevelFunction)) {
+    if (engine == SimulationEngine::Compiled) {
+      toplevel.emitError("the compiled engine only supports handshake "
+                         "functions; lower this function to handshake first");
+      return 1;
+    }
     succeeded = HandshakeExecuter(toplevel, valueMap, timeMap, results,
                                   resultTimes, store, storeTimes)
                     .succeeded();
   } else if (handshake::FuncOp toplevel =
                  module->lookupSymbol<handshake::FuncOp>(toplevelFunction)) {
-    succeeded = HandshakeExecuter(toplevel, valueMap, timeMap, results,
-                                  resultTimes, store, storeTimes, module)
-                    .succeeded();
+    if (engine == SimulationEngine::Compiled)
+      succeeded = executeCompiled(toplevel, valueMap, timeMap, results,
+                                  resultTimes, store, storeTimes);
+    else
+      succeeded = HandshakeExecuter(toplevel, valueMap, timeMap, results,
+                                    resultTimes, store, storeTimes, module)
+                      .succeeded();
   }
 
   if (!succeeded)
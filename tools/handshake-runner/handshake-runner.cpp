@@ -25,6 +25,8 @@
 #include "circt/Dialect/Handshake/HandshakeOps.h"
 #include "circt/Dialect/Handshake/Simulation.h"
 
+#include "ArcSimulation.h"
+
 using namespace llvm;
 using namespace mlir;
 using namespace circt;
@@ -43,6 +45,36 @@ static cl::opt<std::string>
                      cl::desc("The top-level function to execute"),
                      cl::init("main"), cl::cat(mainCategory));
 
+static cl::opt<handshake::SimulationEngine> engine(
+    "engine", cl::desc("The engine used to execute the top-level function"),
+    cl::values(clEnumValN(handshake::SimulationEngine::Interpreter,
+                          "interpreter",
+                          "Interpret operations on dynamically typed values"),
+               clEnumValN(handshake::SimulationEngine::Compiled, "compiled",
+                          "Pre-compile handshake functions into value and "
+                          "dispatch tables")),
+    cl::init(handshake::SimulationEngine::Interpreter), cl::cat(mainCategory));
+
+static cl::opt<bool> emitArcSim(
+    "emit-arc-sim",
+    cl::desc("Instead of executing the top-level handshake function, lower it "
+             "to hardware and print it together with a cycle-accurate "
+             "testbench to be run with `arcilator --run "
+             "--jit-entry=<top-level-function>_tb`"),
+    cl::init(false), cl::cat(mainCategory));
+
+static cl::opt<unsigned> arcSimIterations(
+    "arc-sim-iterations",
+    cl::desc("Number of times the testbench feeds the arguments into the "
+             "circuit, to measure its throughput"),
+    cl::init(1), cl::cat(mainCategory));
+
+static cl::opt<uint64_t>
+    arcSimMaxCycles("arc-sim-max-cycles",
+                    cl::desc("Number of cycles after which the testbench stops "
+                             "waiting for results"),
+                    cl::init(100000), cl::cat(mainCategory));
+
 int main(int argc, char **argv) {
   InitLLVM y(argc, argv);
 
@@ -90,5 +122,17 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  return handshake::simulate(toplevelFunction, inputArgs, module, context);
+  if (emitArcSim) {
+    handshake::ArcSimulationOptions options;
+    options.iterations = arcSimIterations;
+    options.maxCycles = arcSimMaxCycles;
+    if (failed(handshake::buildArcSimulation(toplevelFunction, inputArgs,
+                                             *module, options)))
+      return 1;
+    module->print(outs());
+    return 0;
+  }
+
+  return handshake::simulate(toplevelFunction, inputArgs, module, context,
+                             engine);
 }
@@ -117,6 +117,12 @@ static cl::opt<TraceMode> traceMode(
         clEnumValN(TraceMode::None, "none", "Don't dump a signal trace")),
     cl::cat(mainCategory));
 
+static cl::opt<bool> parallel(
+    "parallel",
+    cl::desc("Evaluate the instances woken up in the same delta cycle in "
+             "parallel"),
+    cl::cat(mainCategory));
+
 static cl::list<std::string>
     sharedLibs("shared-libs",
                cl::desc("Libraries to link dynamically. Specify absolute path "
@@ -225,6 +231,7 @@ int main(int argc, char **argv) {
     return 0;
   }
 
+  engine.setParallel(parallel);
   engine.simulate(nSteps, maxTime);
 
   output->keep();
@@ -0,0 +1,89 @@
+//===- UpdateQueueTest.cpp - LLHD simulator event queue tests -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/LLHD/Simulator/State.h"
+#include "gtest/gtest.h"
+
+using namespace circt::llhd::sim;
+
+namespace {
+
+TEST(UpdateQueueTest, PopsInTimeOrder) {
+  UpdateQueue queue;
+  queue.insertOrUpdate(Time(2, 0, 0), 0);
+  queue.insertOrUpdate(Time(1, 1, 0), 1);
+  queue.insertOrUpdate(Time(1, 0, 1), 2);
+  queue.insertOrUpdate(Time(1, 1, 0), 3);
+  ASSERT_EQ(queue.size(), 3U);
+
+  ASSERT_EQ(queue.top().time, Time(1, 0, 1));
+  ASSERT_EQ(queue.top().scheduled.size(), 1U);
+  queue.pop();
+
+  ASSERT_EQ(queue.top().time, Time(1, 1, 0));
+  ASSERT_EQ(queue.top().scheduled.size(), 2U);
+  queue.pop();
+
+  // Events scheduled while draining the queue land in reused slots.
+  queue.insertOrUpdate(Time(1, 2, 0), 4);
+  ASSERT_EQ(queue.top().time, Time(1, 2, 0));
+  ASSERT_EQ(queue.top().scheduled[0], 4U);
+  queue.pop();
+
+  ASSERT_EQ(queue.top().time, Time(2, 0, 0));
+  queue.pop();
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(UpdateQueueTest, SortsChangesBySignal) {
+  UpdateQueue queue;
+  uint8_t bytes[] = {1, 2, 3};
+  queue.insertOrUpdate(Time(1, 0, 0), 2, 0, &bytes[0], 8);
+  queue.insertOrUpdate(Time(1, 0, 0), 0, 0, &bytes[1], 8);
+  queue.insertOrUpdate(Time(1, 0, 0), 2, 0, &bytes[2], 8);
+
+  const auto &slot = queue.top();
+  ASSERT_EQ(slot.changesSize, 3U);
+  ASSERT_EQ(slot.changes[0].first, 0U);
+  ASSERT_EQ(slot.changes[1].first, 2U);
+  ASSERT_EQ(slot.changes[2].first, 2U);
+
+  // Changes to the same signal keep the order in which they were driven.
+  ASSERT_EQ(*slot.getDriveData(slot.buffers[slot.changes[1].second]), 1U);
+  ASSERT_EQ(*slot.getDriveData(slot.buffers[slot.changes[2].second]), 3U);
+}
+
+TEST(UpdateQueueTest, MasksDriveData) {
+  UpdateQueue queue;
+  uint8_t bytes[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  queue.insertOrUpdate(Time(), 0, 3, bytes, 5);
+  queue.insertOrUpdate(Time(), 1, 0, bytes, 68);
+
+  const auto &slot = queue.top();
+  ASSERT_EQ(slot.buffers[0].offset, 3U);
+  ASSERT_EQ(slot.buffers[0].width, 5U);
+  ASSERT_EQ(slot.getDriveData(slot.buffers[0])[0], 0x1fU);
+  ASSERT_EQ(slot.getDriveData(slot.buffers[1])[0], ~uint64_t(0));
+  ASSERT_EQ(slot.getDriveData(slot.buffers[1])[1], 0xfU);
+}
+
+TEST(UpdateQueueTest, ManyPendingEvents) {
+  UpdateQueue queue;
+  const unsigned numEvents = 100000;
+  for (unsigned i = 0; i < numEvents; ++i)
+    queue.insertOrUpdate(Time((i * 7919) % numEvents, 0, 0), i);
+  ASSERT_EQ(queue.size(), numEvents);
+
+  for (unsigned i = 0; i < numEvents; ++i) {
+    ASSERT_EQ(queue.top().time, Time(i, 0, 0));
+    queue.pop();
+  }
+  ASSERT_TRUE(queue.empty());
+}
+
+} // namespace
@@ -919,4 +919,268 @@ TEST(EvaluatorTests, IntegerBinaryArithmeticWidthMismatch) {
                    .getValue());
 }
 
+TEST(EvaluatorTests, InstantiateHierarchyMemoized) {
+  // Every node instantiates the previous level twice with the same parameter.
+  // Identical instantiations copy the fields of the first one rather than
+  // evaluating the class body again, but must still be distinct objects.
+  constexpr unsigned depth = 10;
+  std::string mod = "om.class @Node0(%p: !om.integer) {"
+                    "  om.class.field @value, %p : !om.integer"
+                    "}";
+  for (unsigned i = 1; i <= depth; ++i) {
+    std::string prev = "Node" + std::to_string(i - 1);
+    std::string type = "!om.class.type<@" + prev + ">";
+    mod += "om.class @Node" + std::to_string(i) + "(%p: !om.integer) {";
+    mod += "  %0 = om.object @" + prev + "(%p) : (!om.integer) -> " + type;
+    mod += "  %1 = om.object @" + prev + "(%p) : (!om.integer) -> " + type;
+    mod += "  om.class.field @a, %0 : " + type;
+    mod += "  om.class.field @b, %1 : " + type;
+    mod += "}";
+  }
+  std::string top = "Node" + std::to_string(depth);
+  std::string topType = "!om.class.type<@" + top + ">";
+  mod += "om.class @Root() {";
+  mod += "  %0 = om.constant #om.integer<42 : si7> : !om.integer";
+  mod += "  %1 = om.object @" + top + "(%0) : (!om.integer) -> " + topType;
+  mod += "  om.class.field @node, %1 : " + topType;
+  mod += "}";
+
+  DialectRegistry registry;
+  registry.insert<OMDialect>();
+
+  MLIRContext context(registry);
+  context.getOrLoadDialect<OMDialect>();
+
+  OwningOpRef<ModuleOp> owning =
+      parseSourceString<ModuleOp>(mod, ParserConfig(&context));
+
+  Evaluator evaluator(owning.release());
+
+  auto result = evaluator.instantiate(StringAttr::get(&context, "Root"), {});
+
+  ASSERT_TRUE(succeeded(result));
+
+  auto getObjectField = [](evaluator::EvaluatorValue *object, StringRef name) {
+    return llvm::cast<evaluator::ObjectValue>(object)
+        ->getField(name)
+        .value()
+        .get();
+  };
+
+  auto *node = getObjectField(result.value().get(), "node");
+  auto *a = getObjectField(node, "a");
+  auto *b = getObjectField(node, "b");
+
+  // Each instantiation creates its own objects, including nested ones.
+  ASSERT_NE(a, b);
+  ASSERT_NE(getObjectField(a, "a"), getObjectField(b, "a"));
+  ASSERT_NE(getObjectField(a, "b"), getObjectField(b, "b"));
+
+  // Walk two different paths down to the leaves. They are distinct objects,
+  // which both hold the parameter of the root.
+  auto *left = node;
+  auto *right = node;
+  for (unsigned i = 0; i < depth; ++i) {
+    left = getObjectField(left, i % 2 ? "a" : "b");
+    right = getObjectField(right, i % 2 ? "b" : "a");
+  }
+  ASSERT_NE(left, right);
+  ASSERT_EQ(getObjectField(left, "value"), getObjectField(right, "value"));
+  ASSERT_EQ(42, llvm::cast<evaluator::AttributeValue>(
+                    getObjectField(left, "value"))
+                    ->getAs<circt::om::IntegerAttr>()
+                    .getValue()
+                    .getValue());
+}
+
+TEST(EvaluatorTests, InstantiateEqualConstantsLocations) {
+  // Two distinct constants with the same value are passed to the same object.
+  // They must stay distinct values, each with the location of its own field.
+  StringRef module =
+      "om.class @Child(%a: !om.integer, %b: !om.integer) {"
+      "  om.class.field @a, %a : !om.integer loc(\"a\")"
+      "  om.class.field @b, %b : !om.integer loc(\"b\")"
+      "}"
+      "om.class @Root() {"
+      "  %0 = om.constant #om.integer<1 : si3> : !om.integer"
+      "  %1 = om.constant #om.integer<1 : si3> : !om.integer"
+      "  %2 = om.object @Child(%0, %1) : (!om.integer, !om.integer) -> "
+      "!om.class.type<@Child>"
+      "  om.class.field @child, %2 : !om.class.type<@Child>"
+      "}";
+
+  DialectRegistry registry;
+  registry.insert<OMDialect>();
+
+  MLIRContext context(registry);
+  context.getOrLoadDialect<OMDialect>();
+
+  OwningOpRef<ModuleOp> owning =
+      parseSourceString<ModuleOp>(module, ParserConfig(&context));
+
+  Evaluator evaluator(owning.release());
+
+  auto result = evaluator.instantiate(StringAttr::get(&context, "Root"), {});
+
+  ASSERT_TRUE(succeeded(result));
+
+  auto *child = llvm::cast<evaluator::ObjectValue>(
+      llvm::cast<evaluator::ObjectValue>(result.value().get())
+          ->getField("child")
+          .value()
+          .get());
+  auto a = child->getField("a").value();
+  auto b = child->getField("b").value();
+
+  ASSERT_NE(a, b);
+  ASSERT_EQ(NameLoc::get(StringAttr::get(&context, "a")), a->getLoc());
+  ASSERT_EQ(NameLoc::get(StringAttr::get(&context, "b")), b->getLoc());
+}
+
+TEST(EvaluatorTests, InstantiateParallel) {
+  // The leaves only depend on constants and are evaluated concurrently. The
+  // sum depends on the fields of all of them.
+  constexpr unsigned numLeaves = 16;
+  std::string mod = "om.class @Inner(%p: !om.integer) {"
+                    "  om.class.field @value, %p : !om.integer"
+                    "}"
+                    "om.class @Leaf(%p: !om.integer) {"
+                    "  %0 = om.object @Inner(%p) : (!om.integer) -> "
+                    "!om.class.type<@Inner>"
+                    "  %1 = om.object.field %0, [@value] : "
+                    "(!om.class.type<@Inner>) -> !om.integer"
+                    "  %2 = om.integer.add %1, %p : !om.integer"
+                    "  om.class.field @value, %2 : !om.integer"
+                    "}"
+                    "om.class @Root() {";
+  std::string sum;
+  for (unsigned i = 0; i < numLeaves; ++i) {
+    std::string n = std::to_string(i);
+    mod += "  %c" + n + " = om.constant #om.integer<" + n +
+           " : si32> : !om.integer";
+    mod += "  %o" + n + " = om.object @Leaf(%c" + n +
+           ") : (!om.integer) -> !om.class.type<@Leaf>";
+    mod += "  %v" + n + " = om.object.field %o" + n +
+           ", [@value] : (!om.class.type<@Leaf>) -> !om.integer";
+    if (i == 0) {
+      sum = "%v0";
+      continue;
+    }
+    mod += "  %s" + n + " = om.integer.add " + sum + ", %v" + n +
+           " : !om.integer";
+    sum = "%s" + n;
+  }
+  mod += "  om.class.field @sum, " + sum + " : !om.integer";
+  mod += "  om.class.field @leaf, %o3 : !om.class.type<@Leaf>";
+  mod += "}";
+
+  DialectRegistry registry;
+  registry.insert<OMDialect>();
+
+  MLIRContext context(registry);
+  context.getOrLoadDialect<OMDialect>();
+
+  OwningOpRef<ModuleOp> owning =
+      parseSourceString<ModuleOp>(mod, ParserConfig(&context));
+
+  Evaluator evaluator(owning.release(), /*parallel=*/true);
+
+  auto result = evaluator.instantiate(StringAttr::get(&context, "Root"), {});
+
+  ASSERT_TRUE(succeeded(result));
+
+  auto getIntField = [](evaluator::EvaluatorValue *object, StringRef name) {
+    return llvm::cast<evaluator::AttributeValue>(
+               llvm::cast<evaluator::ObjectValue>(object)
+                   ->getField(name)
+                   .value()
+                   .get())
+        ->getAs<circt::om::IntegerAttr>()
+        .getValue()
+        .getValue();
+  };
+
+  // Every leaf contributes twice its index.
+  ASSERT_EQ(numLeaves * (numLeaves - 1),
+            getIntField(result.value().get(), "sum"));
+
+  auto *leaf = llvm::cast<evaluator::ObjectValue>(result.value().get())
+                   ->getField("leaf")
+                   .value()
+                   .get();
+  ASSERT_EQ(6, getIntField(leaf, "value"));
+}
+
+TEST(EvaluatorTests, InstantiateParallelLocations) {
+  // Evaluating objects in parallel must leave the same locations on values as
+  // sequential evaluation, and must not change which values are shared.
+  StringRef module =
+      "om.class @Leaf(%p: !om.integer) {"
+      "  om.class.field @value, %p : !om.integer loc(\"value\")"
+      "}"
+      "om.class @Root(%p: !om.integer) {"
+      "  %0 = om.constant #om.integer<1 : si32> : !om.integer"
+      "  %1 = om.object @Leaf(%0) : (!om.integer) -> !om.class.type<@Leaf> "
+      "loc(\"object\")"
+      "  %2 = om.object @Leaf(%p) : (!om.integer) -> !om.class.type<@Leaf> "
+      "loc(\"object\")"
+      "  om.class.field @param, %p : !om.integer loc(\"param\")"
+      "  om.class.field @a, %1 : !om.class.type<@Leaf>"
+      "  om.class.field @b, %2 : !om.class.type<@Leaf>"
+      "}";
+
+  DialectRegistry registry;
+  registry.insert<OMDialect>();
+
+  MLIRContext context(registry);
+  context.getOrLoadDialect<OMDialect>();
+
+  OwningOpRef<ModuleOp> owning =
+      parseSourceString<ModuleOp>(module, ParserConfig(&context));
+
+  Builder builder(&context);
+  auto getField = [](evaluator::EvaluatorValue *object, StringRef name) {
+    return llvm::cast<evaluator::ObjectValue>(object)
+        ->getField(name)
+        .value()
+        .get();
+  };
+  auto getInt = [](evaluator::EvaluatorValue *value) {
+    return llvm::cast<evaluator::AttributeValue>(value)
+        ->getAs<circt::om::IntegerAttr>()
+        .getValue()
+        .getValue();
+  };
+
+  // Return the values of the fields, their locations, and whether the
+  // parameter is shared with the leaf.
+  auto evaluate = [&](bool parallel) {
+    Evaluator evaluator(owning.get(), parallel);
+    auto result = evaluator.instantiate(
+        StringAttr::get(&context, "Root"),
+        getEvaluatorValuesFromAttributes(
+            &context, {circt::om::IntegerAttr::get(
+                          &context, builder.getI32IntegerAttr(42))}));
+    EXPECT_TRUE(succeeded(result));
+    auto *param = getField(result.value().get(), "param");
+    auto *a = getField(getField(result.value().get(), "a"), "value");
+    auto *b = getField(getField(result.value().get(), "b"), "value");
+    return std::make_tuple(getInt(param), getInt(a), getInt(b),
+                           param->getLoc(), a->getLoc(), b->getLoc(),
+                           param == b);
+  };
+
+  auto sequential = evaluate(/*parallel=*/false);
+  auto parallel = evaluate(/*parallel=*/true);
+
+  auto valueLoc = NameLoc::get(StringAttr::get(&context, "value"));
+  ASSERT_EQ(42, std::get<0>(sequential));
+  ASSERT_EQ(1, std::get<1>(sequential));
+  ASSERT_EQ(42, std::get<2>(sequential));
+  ASSERT_EQ(valueLoc, std::get<3>(sequential));
+  ASSERT_EQ(valueLoc, std::get<4>(sequential));
+  ASSERT_TRUE(std::get<6>(sequential));
+  ASSERT_EQ(sequential, parallel);
+}
+
 } // namespace
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+##===- utils/fir-parse-benchmark.py - FIRRTL parser throughput -*- python -*-===##
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+##===----------------------------------------------------------------------===##
+#
+# This script generates a synthetic FIRRTL circuit, optionally with an
+# annotation file, and reports the throughput of the FIRRTL parser in firtool on
+# it, as measured by `-mlir-timing`, together with the peak memory use.
+#
+# Usage fir-parse-benchmark.py [--modules N] [--statements N] [--annotations N]
+#                              [--firtool PATH]
+#
+##===----------------------------------------------------------------------===##
+
+import argparse
+import os
+import re
+import resource
+import subprocess
+import sys
+import tempfile
+
+
+def write_circuit(out, num_modules, num_statements):
+  out.write("FIRRTL version 4.0.0\ncircuit Top :\n")
+  for index in range(num_modules):
+    out.write(f"  module Leaf{index} :\n")
+    out.write("    input clock : Clock\n")
+    out.write("    input a : UInt<32>\n")
+    out.write("    input b : UInt<32>\n")
+    out.write("    output c : UInt<32>\n\n")
+    out.write("    reg r : UInt<32>, clock\n")
+    out.write("    node n0 = add(a, b)\n")
+    for stmt in range(1, num_statements):
+      out.write(f"    node n{stmt} = xor(tail(add(n{stmt - 1}, a), 1), b) " +
+                f"@[Leaf.scala {stmt}:4]\n")
+    out.write(f"    connect r, n{num_statements - 1}\n")
+    out.write("    when eq(a, b) :\n      connect c, r\n")
+    out.write("    else :\n      connect c, a\n")
+
+  out.write("  public module Top :\n")
+  out.write("    input clock : Clock\n")
+  out.write("    input a : UInt<32>\n")
+  out.write("    output c : UInt<32>\n\n")
+  previous = "a"
+  for index in range(num_modules):
+    out.write(f"    inst leaf{index} of Leaf{index}\n")
+    out.write(f"    connect leaf{index}.clock, clock\n")
+    out.write(f"    connect leaf{index}.a, {previous}\n")
+    out.write(f"    connect leaf{index}.b, a\n")
+    previous = f"leaf{index}.c"
+  out.write(f"    connect c, {previous}\n")
+
+
+def write_annotations(out, num_modules, num_statements, num_annotations):
+  out.write("[\n")
+  for index in range(num_annotations):
+    module = index % num_modules
+    node = index // num_modules % num_statements
+    out.write(f'  {{"class": "firrtl.transforms.DontTouchAnnotation", ' +
+              f'"target": "~Top|Leaf{module}>n{node}"}}')
+    out.write(",\n" if index + 1 < num_annotations else "\n")
+  out.write("]\n")
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument("--modules", type=int, default=2000)
+  parser.add_argument("--statements", type=int, default=200)
+  parser.add_argument("--annotations",
+                      type=int,
+                      default=0,
+                      help="number of annotations in the annotation file")
+  parser.add_argument("--firtool", default="firtool")
+  parser.add_argument("--keep",
+                      help="write the generated circuit to this file",
+                      default=None)
+  args = parser.parse_args()
+
+  if args.keep:
+    path = args.keep
+    out = open(path, "w")
+  else:
+    out = tempfile.NamedTemporaryFile("w", suffix=".fir", delete=False)
+    path = out.name
+  with out:
+    write_circuit(out, args.modules, args.statements)
+  command = [
+      args.firtool, path, "--parse-only", "-mlir-timing",
+      "-mlir-timing-display=list", "-o", os.devnull
+  ]
+  annotation_path = None
+  if args.annotations:
+    with tempfile.NamedTemporaryFile("w", suffix=".anno.json",
+                                     delete=False) as out:
+      annotation_path = out.name
+      write_annotations(out, args.modules, args.statements, args.annotations)
+    command.append(f"--annotation-file={annotation_path}")
+
+  try:
+    size = os.path.getsize(path)
+    if annotation_path:
+      size += os.path.getsize(annotation_path)
+    result = subprocess.run(command, stderr=subprocess.PIPE, text=True)
+    if result.returncode != 0:
+      sys.stderr.write(result.stderr)
+      return result.returncode
+    match = re.search(r"^\s*([0-9.]+)\s.*FIR Parser$", result.stderr,
+                      re.MULTILINE)
+    if not match:
+      sys.stderr.write("could not find the parser time in the output\n")
+      return 1
+    seconds = float(match.group(1))
+    megabytes = size / (1024 * 1024)
+    print(f"parsed {megabytes:.1f} MB in {seconds:.3f} s: " +
+          f"{megabytes / seconds:.1f} MB/s")
+    # On Linux, `ru_maxrss` is reported in kilobytes.
+    peak = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss / 1024
+    print(f"peak memory use: {peak:.1f} MB")
+  finally:
+    if not args.keep:
+      os.unlink(path)
+    if annotation_path:
+      os.unlink(annotation_path)
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())